@@ -194,6 +194,80 @@ void DrawTGA_2D(SpringSys *sys, TGA *tga, float lPixel, int margin) {
   VecFree(&q);
 }
 
+// Record the trajectory of a chain of 8 masses forming two islands 
+// whose masses alternate in the list of masses, with sleeping islands
+// so that the packed masses are reordered, and check the positions 
+// read back from the trajectory against the positions of the masses
+// Return true if they match, else false
+bool CheckTrajectory(void) {
+  // Create the system, masses of even and odd ids are connected in 
+  // two separate chains fixed at one extremity
+  SpringSys *sys = SpringSysCreate(1);
+  SpringSysMass *mass = SpringSysCreateMass();
+  SpringSysSpring *spring = SpringSysCreateSpring();
+  if (sys == NULL || mass == NULL || spring == NULL) {
+    SpringSysFree(&sys);
+    SpringSysMassFree(&mass);
+    SpringSysSpringFree(&spring);
+    return false;
+  }
+  mass->_mass = 1.0;
+  for (int iMass = 0; iMass < 8; ++iMass) {
+    mass->_id = iMass;
+    mass->_pos[0] = (float)iMass;
+    mass->_fixed = (iMass < 2);
+    SpringSysAddMass(sys, mass);
+  }
+  spring->_k = 1.0;
+  spring->_restLength = 1.5;
+  for (int iMass = 0; iMass < 6; ++iMass) {
+    spring->_id = iMass;
+    spring->_mass[0] = iMass;
+    spring->_mass[1] = iMass + 2;
+    SpringSysAddSpring(sys, spring);
+  }
+  SpringSysCompile(sys);
+  SpringSysSetSleep(sys, 1e-6, 1e-6);
+  // Record the initial state and 5 steps
+  bool ok = false;
+  FILE *stream = fopen("./springsys_check.traj", "wb");
+  SpringSysRecorder *recorder = NULL;
+  if (stream != NULL)
+    recorder = SpringSysRecorderCreate(sys, stream, 
+      springSysRecordPos, 1, 8);
+  if (recorder != NULL) {
+    SpringSysRecorderRecord(recorder, 0.0);
+    for (int iStep = 1; iStep <= 5; ++iStep) {
+      SpringSysStep(sys, 0.1);
+      SpringSysRecorderRecord(recorder, 0.1 * (float)iStep);
+    }
+    ok = SpringSysRecorderFlush(recorder);
+    SpringSysRecorderFree(&recorder);
+  }
+  if (stream != NULL)
+    fclose(stream);
+  // Read back the last frame and compare the positions by id
+  stream = (ok ? fopen("./springsys_check.traj", "rb") : NULL);
+  SpringSysFrame *frame = SpringSysFrameCreate();
+  int nbFrame = 0;
+  if (stream != NULL && frame != NULL)
+    while (SpringSysFrameRead(frame, stream) == 0)
+      ++nbFrame;
+  ok = (frame != NULL && nbFrame == 6 && frame->_nbMass == 8);
+  for (int iMass = 0; ok && iMass < frame->_nbMass; ++iMass) {
+    SpringSysMass *m = SpringSysGetMass(sys, frame->_massId[iMass]);
+    ok = (m != NULL && fabs(m->_pos[0] - frame->_pos[iMass]) < 1e-3);
+  }
+  if (stream != NULL)
+    fclose(stream);
+  // Free memory
+  SpringSysFrameFree(&frame);
+  SpringSysFree(&sys);
+  SpringSysMassFree(&mass);
+  SpringSysSpringFree(&spring);
+  return ok;
+}
+
 int main(int argc, char **argv) {
   // Create a first example in one dimension, 
   // a chain of spring aligned and fixed at one extermity,
@@ -450,6 +524,12 @@ simulation with current state\n");
   float v[2];
   v[0] = -1.0 * slope / sqrt(1.0 + pow(slope, 2.0));
   v[1] = 1.0 / sqrt(1.0 + pow(slope, 2.0));
+  // Record the trajectory of the masses and the stress of the springs
+  FILE *trajStream = fopen("./springsys.traj", "wb");
+  SpringSysRecorder *recorder = NULL;
+  if (trajStream != NULL)
+    recorder = SpringSysRecorderCreate(theSpringSys, trajStream, 
+      springSysRecordPos | springSysRecordStress, 1, 16);
   // Run the simulation
   t = 0.0;
   tMax = 30.0;
@@ -493,6 +573,8 @@ simulation with current state\n");
         }
       }
     }
+    // Record the new state
+    SpringSysRecorderRecord(recorder, t);
     // Draw the SpringSys
     DrawTGA_2D(theSpringSys, tga, lPixel, margin);
     // Save the frame for animation
@@ -510,6 +592,15 @@ simulation with current state\n");
     t += dt;
     iFrame++;
   }
+  // Stop recording the trajectory
+  SpringSysRecorderFree(&recorder);
+  if (trajStream != NULL)
+    fclose(trajStream);
+  // Check the trajectory of a system whose packed masses are reordered
+  if (CheckTrajectory())
+    printf("Trajectory check: OK\n");
+  else
+    fprintf(stderr, "Trajectory check: mismatch\n");
   // Save the TGA
   TGASave(tga, "./springSys2D.tga");
   // Free the TGA
@@ -547,6 +638,23 @@ simulation with current state\n");
     }
     fclose(stream);
   }
+  // Save the SpringSys in binary format and load it back
+  stream = fopen("./springsys.bin", "wb");
+  ret = SpringSysSaveBinary(theSpringSys, stream);
+  fclose(stream);
+  if (ret != 0) {
+    fprintf(stderr, "Couldn't save the SpringSys (%d)\n", ret);
+  } else {
+    SpringSys *loadSys = NULL;
+    ret = SpringSysLoadFile(&loadSys, "./springsys.bin");
+    if (ret != 0) {
+      fprintf(stderr, "Couldn't load the SpringSys (%d)\n", ret);
+    } else {
+      printf("Loaded SpringSys (binary):\n");
+      SpringSysPrint(loadSys, stdout);
+      SpringSysFree(&loadSys);
+    }
+  }
   // Remove one spring 
   printf("Remove spring #4:\n");
   SpringSysRemoveSpring(theSpringSys, 4);
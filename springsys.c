@@ -4,6 +4,1061 @@
 
 // ================= Include =================
 
+#include <pthread.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Vectorized kernels are available with GCC compatible compilers on 
+// x86 processors, they are compiled for their own instruction set and
+// selected at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define SPRINGSYS_X86_KERNEL
+  #include <immintrin.h>
+#endif
+
+// ================= Define ==================
+
+// Initial size of the hash table of an index (must be a power of 2)
+#define SPRINGSYS_INDEX_INITSIZE 64
+
+// Control of the adaptive steps: safety factor on the predicted step,
+// bounds of the ratio between two consecutive steps
+#define SPRINGSYS_ADAPT_SAFETY 0.9
+#define SPRINGSYS_ADAPT_MINSCALE 0.2
+#define SPRINGSYS_ADAPT_MAXSCALE 5.0
+
+// Parameters of the FIRE minimization (cf SpringSysSolveEquilibrium):
+// number of steps with positive power before increasing the step, 
+// ratios increasing and decreasing the step, initial mixing of speed 
+// and force and its decay
+#define SPRINGSYS_FIRE_NMIN 5
+#define SPRINGSYS_FIRE_FINC 1.1
+#define SPRINGSYS_FIRE_FDEC 0.5
+#define SPRINGSYS_FIRE_ALPHA 0.1
+#define SPRINGSYS_FIRE_FALPHA 0.99
+
+// Average number of masses per cell of the grid used to search masses
+// by position, and smallest batch of searches shared between threads
+// (cf SpringSysGetMassesByPos)
+#define SPRINGSYS_GRID_DENSITY 2.0
+#define SPRINGSYS_NEAREST_MINBATCH 256
+
+// Largest number of springs in a leaf of the hierarchy used to search
+// springs by position, and number of refits of the hierarchy after 
+// which it's built again (cf SpringSysGetSpringByPos)
+#define SPRINGSYS_BVH_LEAF 4
+#define SPRINGSYS_BVH_MAXREFIT 32
+
+// Smallest number of masses for which the collision pass is shared 
+// between the threads of the SpringSys (cf SpringSysSetCollision)
+#define SPRINGSYS_COLLIDE_MINMASS 1024
+
+// Smallest number of masses or springs removed at once for which the 
+// GSet holding them is rebuilt rather than updated element by element
+// (cf SpringSysRemoveMasses)
+#define SPRINGSYS_REBUILD_MINREMOVE 16
+
+// Number of records of the first slab of a pool, and largest number of
+// records of the following slabs whose size doubles (cf SpringSysPool)
+#define SPRINGSYS_POOL_MINSLAB 64
+#define SPRINGSYS_POOL_MAXSLAB 65536
+
+// Binary format (cf SpringSysSaveBinary): magic number, version, size
+// in bytes of the header, of a mass and of a spring record, and of the
+// trailer, and number of records encoded at once when saving
+#define SPRINGSYS_BINARY_MAGIC "SPRSYSBN"
+#define SPRINGSYS_BINARY_VERSION 1
+#define SPRINGSYS_BINARY_HEADER 48
+#define SPRINGSYS_BINARY_MASS 48
+#define SPRINGSYS_BINARY_SPRING 40
+#define SPRINGSYS_BINARY_TRAILER 16
+#define SPRINGSYS_BINARY_CHUNK 1024
+
+// Trajectory format (cf SpringSysRecorder): magic number, version, 
+// size in bytes of the header of the stream and of the header of a 
+// frame, and flag of key frames in the header of a frame
+#define SPRINGSYS_TRAJ_MAGIC "SPRSYSTR"
+#define SPRINGSYS_TRAJ_VERSION 1
+#define SPRINGSYS_TRAJ_HEADER 16
+#define SPRINGSYS_TRAJ_FRAME 44
+#define SPRINGSYS_TRAJ_KEY 0x100
+
+// Qualifier of the generic kernels, which are inlined into their 
+// specializations for 1, 2 and 3 dimensions so that the compiler can 
+// unroll and vectorize the loops on dimensions
+#ifdef __GNUC__
+  #define SPRINGSYS_KERNEL static inline __attribute__((always_inline))
+#else
+  #define SPRINGSYS_KERNEL static inline
+#endif
+
+// Specialized kernels only available on x86 processors
+#ifdef SPRINGSYS_X86_KERNEL
+  #define SPRINGSYS_X86_ONLY(f) f
+#else
+  #define SPRINGSYS_X86_ONLY(f) NULL
+#endif
+
+// Pool of threads executing jobs for a SpringSys
+typedef struct SpringSysThreadPool {
+  // Number of threads, including the calling thread
+  int _nbThread;
+  // Worker threads (_nbThread - 1)
+  pthread_t *_threads;
+  // Synchronisation of the workers with the calling thread
+  pthread_mutex_t _mutex;
+  pthread_cond_t _condStart;
+  pthread_cond_t _condDone;
+  // Barrier usable by the jobs to synchronise all the threads
+  pthread_barrier_t _barrier;
+  // Number of jobs submitted so far
+  int _nbJob;
+  // Number of workers started so far, used to give them their index
+  int _nbStarted;
+  // Number of workers which haven't completed the current job
+  int _nbRunning;
+  // Flag to stop the workers
+  bool _quit;
+  // Current job, called by each thread with its index in 
+  // [0, _nbThread[ and the number of threads
+  void (*_job)(void *arg, int iThread, int nbThread);
+  void *_arg;
+} SpringSysThreadPool;
+
+// Frame waiting in the queue of a recorder (cf SpringSysRecorder)
+typedef struct SpringSysRecorderSlot {
+  // Index of the call which recorded the frame, and its time
+  int _step;
+  float _time;
+  // Contents, key flag and quantization steps of the frame
+  int _content;
+  bool _key;
+  float _precision[3];
+  // Number of masses and springs, their ids (key frames only), 
+  // position and speed of masses (_nbMass * _nbDim values) and stress
+  // of springs
+  int _nbMass;
+  int _nbSpring;
+  int *_massId;
+  int *_springId;
+  float *_pos;
+  float *_speed;
+  float *_stress;
+  // Number of masses and springs the arrays can hold
+  int _massSize;
+  int _springSize;
+} SpringSysRecorderSlot;
+
+// Queue of frames of a recorder and thread writing them
+typedef struct SpringSysRecorderQueue {
+  // Number of dimensions of the recorded SpringSys and stream
+  int _nbDim;
+  FILE *_stream;
+  // Circular buffer of frames, position of the first frame waiting to
+  // be written and number of frames waiting
+  SpringSysRecorderSlot *_slots;
+  int _nbSlot;
+  int _first;
+  int _nbWaiting;
+  // Writing thread and its synchronisation with the recording thread
+  pthread_t _thread;
+  pthread_mutex_t _mutex;
+  pthread_cond_t _condQueued;
+  pthread_cond_t _condWritten;
+  // Flag to stop the writing thread once the queue is empty
+  bool _quit;
+  // Flag telling if an error occured while writing
+  bool _error;
+  // Quantized values of the last frame written and their number, and 
+  // buffer of the encoded frame and its size in bytes, used by the 
+  // writing thread only
+  int64_t *_quant;
+  int _nbQuant;
+  unsigned char *_buffer;
+  size_t _bufferSize;
+} SpringSysRecorderQueue;
+
+// Argument of the ensemble step job
+typedef struct SpringSysEnsembleStepArg {
+  // The ensemble
+  SpringSysEnsemble *_ens;
+  // The delta of time
+  float _dt;
+} SpringSysEnsembleStepArg;
+
+// Argument of the parallel step job
+typedef struct SpringSysParallelStep {
+  // The SpringSys
+  SpringSys *_sys;
+  // The delta of time, if null the masses are not stepped
+  float _dt;
+  // Number of ruptures detected by each thread
+  int *_nbRupture;
+  // Observables calculated by each thread
+  SpringSysStats *_stats;
+} SpringSysParallelStep;
+
+// Group of islands connected through fixed masses, which are stepped 
+// by the same thread (cf SpringSysSoAAssignIslands)
+typedef struct SpringSysIslandGroup {
+  // Lowest island of the group
+  int _root;
+  // Number of masses and springs of the group
+  long _work;
+} SpringSysIslandGroup;
+
+// Argument of the job searching the nearest masses of a batch of 
+// positions (cf SpringSysGetMassesByPos)
+typedef struct SpringSysNearestBatch {
+  // The SpringSys
+  SpringSys *_sys;
+  // The positions, and their number
+  const float *_pos;
+  int _nb;
+  // Positions of the nearest masses in the packed arrays
+  int *_nearest;
+} SpringSysNearestBatch;
+
+// Region of a range query: a box, and if _sphere is true the ball 
+// inside it of center _center and squared radius _sqRadius
+typedef struct SpringSysRange {
+  float _min[3];
+  float _max[3];
+  bool _sphere;
+  float _center[3];
+  float _sqRadius;
+} SpringSysRange;
+
+// Growable array of ids, result of a range query
+typedef struct SpringSysIdList {
+  int *_id;
+  int _nb;
+  int _size;
+} SpringSysIdList;
+
+// Argument of the job applying the forces of contacts between masses
+// (cf SpringSysSoACollide)
+typedef struct SpringSysCollision {
+  // The SpringSys
+  SpringSys *_sys;
+  // Number of contacts found by each thread
+  int *_nbContact;
+} SpringSysCollision;
+
+// Apply the forces of the springs at positions [first, last[ in the 
+// compiled snapshot of the SpringSys 'sys' to the masses. Broken 
+// springs apply no force and are released if 'release' is true. The 
+// sum of the absolute stress of the other springs is added to 
+// 'stress'.
+// Return the number of ruptures
+typedef int (*SpringSysSpringPass)(SpringSys *sys, int first, int last,
+  bool release, float *stress);
+
+// Set of kernels specialized for a number of dimensions
+typedef struct SpringSysDimKernels {
+  // Step in time by 'dt' the SpringSys 'sys' on its packed arrays
+  void (*_stepSoA)(SpringSys *sys, float dt);
+  // Spring passes of each kernel
+  SpringSysSpringPass _springPassScalar;
+  SpringSysSpringPass _springPassAVX2;
+  SpringSysSpringPass _springPassAVX512;
+  // Apply the forces to the unfixed masses at positions [first, last[
+  // of the compiled snapshot of the SpringSys 'sys' and step them in 
+  // time by 'dt', adding the observables of masses to 'stats'
+  void (*_integrate)(SpringSys *sys, float dt, int first, int last, 
+    SpringSysStats *stats);
+  // Step in time the compiled snapshot of a SpringSys on several 
+  // threads, job of the thread pool with a SpringSysParallelStep
+  void (*_stepParallel)(void *arg, int iThread, int nbThread);
+  // Return the sum of the norm of the speed of masses in 'soa'
+  float (*_momentum)(const SpringSysSoA *soa);
+  // Return the position of the nearest mass from 'pos' in 'soa', or -1
+  // if there is no mass
+  int (*_nearestMass)(const SpringSysSoA *soa, const float *pos);
+  // Return the position of the nearest spring from 'pos' in 'soa', or
+  // -1 if there is no spring
+  int (*_nearestSpring)(const SpringSysSoA *soa, const float *pos);
+  // Apply the forces of contacts between masses of the compiled 
+  // snapshot of a SpringSys, job of the thread pool with a 
+  // SpringSysCollision
+  void (*_collide)(void *arg, int iThread, int nbThread);
+} SpringSysDimKernels;
+
+// ================ Functions declaration ====================
+
+// Create a new empty index
+// Return NULL if memory allocation failed
+static SpringSysIndex* SpringSysIndexCreate(void);
+
+// Free the memory used by the index 'index'
+static void SpringSysIndexFree(SpringSysIndex **index);
+
+// Get the element identified by 'id' in the index 'index'
+// Return NULL if there is no element with this id
+static void* SpringSysIndexGet(SpringSysIndex *index, int id);
+
+// Get the entry of the element identified by 'id' in the index 'index'
+// Return NULL if there is no element with this id
+static SpringSysIndexEntry* SpringSysIndexGetEntry(SpringSysIndex *index,
+  int id);
+
+// Add the element 'elem' identified by 'id' to the index 'index'
+// If there is already an element with this id the index is unchanged
+// Return false if memory allocation failed, else return true
+static bool SpringSysIndexAdd(SpringSysIndex *index, int id, void *elem);
+
+// Remove the element identified by 'id' from the index 'index'
+static void SpringSysIndexRemove(SpringSysIndex *index, int id);
+
+// Enlarge if necessary the hash table of the index 'index' so that 
+// 'nb' more elements can be added without resizing it
+// Return false if memory allocation failed, else return true
+static bool SpringSysIndexReserve(SpringSysIndex *index, int nb);
+
+// Initialize the empty pool 'pool' of records of 'size' bytes
+static void SpringSysPoolInit(SpringSysPool *pool, size_t size);
+
+// Release all the slabs of the pool 'pool', and the records in them,
+// leaving the pool empty
+static void SpringSysPoolFree(SpringSysPool *pool);
+
+// Get a record from the pool 'pool', released or never used
+// Return NULL if memory allocation failed
+static void* SpringSysPoolAlloc(SpringSysPool *pool);
+
+// Release the record 'rec' of the pool 'pool' for reuse
+static void SpringSysPoolRelease(SpringSysPool *pool, void *rec);
+
+// Allocate if necessary a slab in the pool 'pool' so that 'nb' 
+// records can be got without further allocation
+// Return false if memory allocation failed, else return true
+static bool SpringSysPoolReserve(SpringSysPool *pool, int nb);
+
+// Allocate a new slab of 'nb' records in the pool 'pool', the records
+// never used of the previous slab are released
+// Return false if memory allocation failed, else return true
+static bool SpringSysPoolAddSlab(SpringSysPool *pool, int nb);
+
+// Add the spring 's' to the springs connected to its masses in the 
+// index of masses of the SpringSys 'sys'
+// Return false if memory allocation failed, else return true
+static bool SpringSysAttachSpring(SpringSys *sys, SpringSysSpring *s);
+
+// Remove the spring 's' from the springs connected to its masses in 
+// the index of masses of the SpringSys 'sys'
+static void SpringSysDetachSpring(SpringSys *sys, SpringSysSpring *s);
+
+// Get the 'iSpring'-th spring connected to the mass identified by 'id'
+// in the SpringSys 'sys'
+// Return NULL if arguments are invalid or if there is no mass with 
+// this id
+static SpringSysSpring* SpringSysGetIncident(SpringSys *sys, int id,
+  int iSpring);
+
+// Return true if the properties of the mass 'm' are valid, else false
+static bool SpringSysIsValidMass(const SpringSysMass *m);
+
+// Return true if the properties of the spring 's' are valid and its 
+// masses exist in the SpringSys 'sys', else false
+static bool SpringSysIsValidSpring(SpringSys *sys, 
+  const SpringSysSpring *s);
+
+// Add a copy of the valid mass 'm' to the unpacked SpringSys 'sys'
+// Return false if memory allocation failed, else return true
+static bool SpringSysInsertMass(SpringSys *sys, const SpringSysMass *m);
+
+// Add a copy of the valid spring 's' to the unpacked SpringSys 'sys'
+// Return false if memory allocation failed, else return true
+static bool SpringSysInsertSpring(SpringSys *sys, 
+  const SpringSysSpring *s);
+
+// Read the little-endian unsigned integer of 32 bits at 'p'
+static inline uint32_t SpringSysGetU32(const unsigned char *p);
+
+// Read the little-endian unsigned integer of 64 bits at 'p'
+static inline uint64_t SpringSysGetU64(const unsigned char *p);
+
+// Read the little-endian float of 32 bits at 'p'
+static inline float SpringSysGetF32(const unsigned char *p);
+
+// Write 'v' as a little-endian unsigned integer of 32 bits at 'p'
+static inline void SpringSysPutU32(unsigned char *p, uint32_t v);
+
+// Write 'v' as a little-endian unsigned integer of 64 bits at 'p'
+static inline void SpringSysPutU64(unsigned char *p, uint64_t v);
+
+// Write 'v' as a little-endian float of 32 bits at 'p'
+static inline void SpringSysPutF32(unsigned char *p, float v);
+
+// Add the 'size' bytes at 'data' to the Fletcher-64 checksum whose
+// running sums are 'sum', 'size' must be a multiple of 4
+// The sums must be initialized to 0 and the checksum is 
+// (sum[1] << 32) | sum[0]
+static void SpringSysChecksumAdd(uint64_t *sum, 
+  const unsigned char *data, size_t size);
+
+// Return the Fletcher-64 checksum of the 'size' bytes at 'data'
+static uint64_t SpringSysChecksum(const unsigned char *data, 
+  size_t size);
+
+// Check the header of binary format at 'header' and set 'size' to the
+// size in bytes of the whole data
+// Return false if the header is invalid, else return true
+static bool SpringSysBinarySize(const unsigned char *header, 
+  uint64_t *size);
+
+// Create the SpringSys 'sys' from the 'size' bytes of binary format 
+// at 'data'
+// Return 0 in case of success, or 2 if memory allocation failed, or 3
+// if the data are invalid
+static int SpringSysLoadBinary(SpringSys **sys, 
+  const unsigned char *data, size_t size);
+
+// Create the SpringSys 'sys' from the binary format in the stream 
+// 'stream'
+// Return 0 in case of success, or 2 if memory allocation failed, or 3
+// if the data are invalid
+static int SpringSysLoadBinaryStream(SpringSys **sys, FILE *stream);
+
+// Create the packed arrays for 'nbMass' masses and 'nbSpring' springs
+// in 'nbDim' dimensions
+// Return NULL if memory allocation failed
+static SpringSysSoA* SpringSysSoACreate(int nbDim, int nbMass, 
+  int nbSpring);
+
+// Free the memory used by the packed arrays 'soa'
+static void SpringSysSoAFree(SpringSysSoA **soa);
+
+// Copy the state of the mass at position 'iMass' in the packed arrays
+// 'soa' of a SpringSys with 'nbDim' dimensions from its record
+static inline void SpringSysSoAReadMass(SpringSysSoA *soa, int nbDim,
+  int iMass);
+
+// Copy the state of the spring at position 'iSpring' in the packed 
+// arrays 'soa' from its record
+static inline void SpringSysSoAReadSpring(SpringSysSoA *soa, 
+  int iSpring);
+
+// Pack the masses and springs of the SpringSys 'sys' into new arrays
+// Return false if memory allocation failed or the springs refer to 
+// unknown masses, else return true
+static bool SpringSysSoAPack(SpringSys *sys);
+
+// Update the records of the SpringSys 'sys' from its packed arrays and
+// release the packed arrays
+static void SpringSysSoAUnpack(SpringSys *sys);
+
+// Update the record of the mass at position 'iMass' in the packed
+// arrays of the SpringSys 'sys' and flag it as handed out
+static void SpringSysSoAPullMass(SpringSys *sys, int iMass);
+
+// Update the record of the spring at position 'iSpring' in the packed
+// arrays of the SpringSys 'sys' and flag it as handed out
+static void SpringSysSoAPullSpring(SpringSys *sys, int iSpring);
+
+// Update all the records of the SpringSys 'sys' from its packed arrays
+static void SpringSysSoAPullAll(SpringSys *sys);
+
+// Copy the records handed out of the SpringSys 'sys' into its packed 
+// arrays
+static void SpringSysSoAPush(SpringSys *sys);
+
+// Make the packed arrays of the SpringSys 'sys' ready for stepping, 
+// packing them if necessary
+// Return false if the SpringSys couldn't be packed, else return true
+static bool SpringSysSoAPrepare(SpringSys *sys);
+
+// Step in time by 'dt' the SpringSys 'sys' on its GSets
+static void SpringSysStepGSet(SpringSys *sys, float dt);
+
+// Step in time by 'dt' the SpringSys 'sys' with 'nbDim' dimensions on
+// its packed arrays
+SPRINGSYS_KERNEL void SpringSysStepSoADim(SpringSys *sys, float dt,
+  int nbDim);
+
+// Step in time by 'dt' the SpringSys 'sys' on its compiled snapshot 
+static void SpringSysStepCompiled(SpringSys *sys, float dt);
+
+// Apply the forces of the springs of the compiled snapshot of the 
+// SpringSys 'sys' to its masses (into _force), on its threads if it 
+// has several, then if 'dt' is not null step the unfixed masses in 
+// time by 'dt' with the Euler scheme. Broken springs are removed from
+// the snapshot, or only flagged if ruptures are deferred.
+static void SpringSysApplyForces(SpringSys *sys, float dt);
+
+// Add the forces of contacts between the masses of the compiled 
+// snapshot of the SpringSys 'sys' to their _force, on its threads if 
+// it has several and there are enough masses, and memorize the number
+// of contacts in _nbContact
+// Return false if memory allocation failed, in which case no force is
+// applied, else true
+static bool SpringSysSoACollide(SpringSys *sys);
+
+// Sort the masses of the compiled snapshot of the SpringSys 'sys' into
+// the buckets of its spatial hash, with cells of size 'cell'
+// Return false if memory allocation failed, else true
+static bool SpringSysSoABuildHash(SpringSys *sys, float cell);
+
+// Get the masses connected by a spring to each mass of the packed 
+// arrays 'soa'
+// Return false if memory allocation failed, else true
+static bool SpringSysSoABuildAdjacency(SpringSysSoA *soa);
+
+// Return the coordinate of the cell of the spatial hash of 'soa' 
+// containing the coordinate 'x', clamped to keep it in the range of 
+// integers
+static inline int SpringSysSoAHashCoord(const SpringSysSoA *soa, 
+  float x);
+
+// Return the bucket of the spatial hash of 'soa' of the cell at 
+// coordinates 'x', 'y', 'z'
+static inline int SpringSysSoAHashBucket(const SpringSysSoA *soa, 
+  int x, int y, int z);
+
+// Apply the forces of contacts with other masses to the unfixed masses
+// of the compiled snapshot of a SpringSys with 'nbDim' dimensions, the
+// part of the thread 'iThread' among 'nbThread', 'arg' is a 
+// SpringSysCollision
+SPRINGSYS_KERNEL void SpringSysCollideDim(void *arg, int iThread, 
+  int nbThread, int nbDim);
+
+// Return true if the stress of the spring at position 'iSpring' in 
+// the compiled packed arrays 'soa' is over its limits, else false
+static inline bool SpringSysSoAIsBroken(const SpringSysSoA *soa, 
+  int iSpring);
+
+// Set the stress of the unfixed masses of the compiled snapshot of the
+// SpringSys 'sys' to their acceleration from the forces of springs
+static void SpringSysSoAUpdateStress(SpringSys *sys);
+
+// Step in time by 'dt' the SpringSys 'sys' on its compiled snapshot 
+// with the Velocity Verlet integrator
+static void SpringSysStepVerlet(SpringSys *sys, float dt);
+
+// Step in time by 'dt' the SpringSys 'sys' on its compiled snapshot 
+// with the RK4 integrator
+// Return false if memory allocation failed, else return true
+static bool SpringSysStepRK4(SpringSys *sys, float dt);
+
+// Get the buffers of the integrators of the compiled packed arrays 
+// 'soa', with at least 'size' values
+// Return NULL if memory allocation failed
+static float* SpringSysSoAGetIntegBuf(SpringSysSoA *soa, int size);
+
+// Step in time the compiled SpringSys 'sys' by a step of at most 
+// 'dtMax' whose length is adapted to keep its local error, estimated
+// by step doubling, below 'tol'
+// Return the length of the step, or 0.0 if memory allocation failed
+static float SpringSysStepAdaptive(SpringSys *sys, float dtMax, 
+  float tol);
+
+// Save the state of the masses of the compiled packed arrays 'soa' 
+// with 'nbDim' dimensions into 'state', or restore it from 'state' 
+// if 'restore' is true
+static void SpringSysSoASaveState(SpringSysSoA *soa, int nbDim, 
+  float *state, bool restore);
+
+// Step in time by 'dt' the SpringSys 'sys' on its compiled snapshot 
+// with the implicit integrator
+// Return false if memory allocation failed, else return true
+static bool SpringSysStepImplicit(SpringSys *sys, float dt);
+
+// Apply the system (M + dt^2.H) of the implicit integrator for the 
+// compiled snapshot of the SpringSys 'sys', whose springs' axis are in
+// 'axis' and stiffness coefficients in 'coef', to 'w' and store the 
+// result in 'out', null for fixed masses (cf SpringSysStepImplicit)
+static void SpringSysImplicitProduct(SpringSys *sys, 
+  const float *axis, const float *coef, const float *w, float dt,
+  float *out);
+
+// Apply the stiffness of the springs of the compiled snapshot of the 
+// SpringSys 'sys', whose axis are in 'axis' and coefficients in 
+// 'coef', to 'w', and add the result multiplied by 'scale' to 'out'
+// (cf SpringSysStepImplicit)
+static void SpringSysImplicitStiffness(SpringSys *sys, 
+  const float *axis, const float *coef, const float *w, float scale,
+  float *out);
+
+// Apply the force of the spring at position 'iSpring' in the compiled
+// snapshot of the SpringSys 'sys' with 'nbDim' dimensions to the 
+// masses at its extremities
+// Return true if the spring broke (in which case it applies no force,
+// and must be released with SpringSysSoABreakSpring), else false
+SPRINGSYS_KERNEL bool SpringSysSpringForceDim(SpringSys *sys, 
+  int iSpring, int nbDim);
+
+// Break the spring at position 'iSpring' in the packed arrays of the 
+// SpringSys 'sys' (cf SpringSysBreakSpring) and release its record, 
+// the packed arrays are updated later by SpringSysSoARemoveBroken
+static void SpringSysSoABreakSpring(SpringSys *sys, int iSpring);
+
+// Record the rupture of the spring 's' of the SpringSys 'sys' under 
+// the stress 'stress', and tombstone it (cf SpringSysTombstoneSpring)
+static void SpringSysBreakSpring(SpringSys *sys, SpringSysSpring *s, 
+  float stress);
+
+// Disconnect the spring 's' of the SpringSys 'sys' from its masses and
+// add it to the tombstones removed from _springs by 
+// SpringSysRemoveTombstones, or if memory allocation failed remove it
+// and release it now
+static void SpringSysTombstoneSpring(SpringSys *sys, SpringSysSpring *s);
+
+// Remove in one pass the springs tombstoned by 
+// SpringSysTombstoneSpring from the set of springs of the SpringSys 
+// 'sys', keeping the order of the other springs, and release them
+static void SpringSysRemoveTombstones(SpringSys *sys);
+
+// Compare the pointers pointed to by 'a' and 'b' (for qsort)
+static int SpringSysComparePtr(const void *a, const void *b);
+
+// Compare the ints pointed to by 'a' and 'b' (for qsort)
+static int SpringSysCompareInt(const void *a, const void *b);
+
+// Apply the forces of the springs at positions [first, last[ in the 
+// compiled snapshot of the SpringSys 'sys' with 'nbDim' dimensions to
+// the masses with the scalar kernel. Broken springs are released if 
+// 'release' is true. The sum of the absolute stress of the other 
+// springs is added to 'stress'.
+// Return the number of ruptures
+SPRINGSYS_KERNEL int SpringSysSpringPassScalarDim(SpringSys *sys, 
+  int first, int last, bool release, float *stress, int nbDim);
+
+#ifdef SPRINGSYS_X86_KERNEL
+// Apply the forces of the springs at positions [first, last[ in the 
+// compiled snapshot of the SpringSys 'sys' with 'nbDim' dimensions to
+// the masses with the AVX2 kernel. Broken springs are released if 
+// 'release' is true. The sum of the absolute stress of the other 
+// springs is added to 'stress'.
+// Return the number of ruptures
+SPRINGSYS_KERNEL int SpringSysSpringPassAVX2Dim(SpringSys *sys, 
+  int first, int last, bool release, float *stress, int nbDim);
+
+// Apply the forces of the springs at positions [first, last[ in the 
+// compiled snapshot of the SpringSys 'sys' with 'nbDim' dimensions to
+// the masses with the AVX-512 kernel. Broken springs are released if 
+// 'release' is true. The sum of the absolute stress of the other 
+// springs is added to 'stress'.
+// Return the number of ruptures
+SPRINGSYS_KERNEL int SpringSysSpringPassAVX512Dim(SpringSys *sys, 
+  int first, int last, bool release, float *stress, int nbDim);
+
+// Get the spring pass of the kernel of the SpringSys 'sys'
+static SpringSysSpringPass SpringSysGetSpringPass(SpringSys *sys);
+#endif
+
+// Apply the forces to the unfixed masses at positions [first, last[ 
+// of the compiled snapshot of the SpringSys 'sys' with 'nbDim' 
+// dimensions and step them in time by 'dt'
+SPRINGSYS_KERNEL void SpringSysIntegrateDim(SpringSys *sys, float dt,
+  int first, int last, SpringSysStats *stats, int nbDim);
+
+// Add the momentum 'momentum', kinetic energy 'energy' and highest 
+// force 'maxForce' of a set of masses to the statistics 'stats'
+static inline void SpringSysStatsAddMasses(SpringSysStats *stats,
+  float momentum, float energy, float maxForce);
+
+// Step in time the compiled snapshot of a SpringSys with 'nbDim' 
+// dimensions, part of the thread 'iThread' among 'nbThread', 'arg' is
+// a SpringSysParallelStep
+SPRINGSYS_KERNEL void SpringSysStepParallelDim(void *arg, int iThread,
+  int nbThread, int nbDim);
+
+// Apply the forces of the springs of the compiled snapshot of the 
+// SpringSys 'sys' to its masses with its thread pool, then if 'dt' is
+// not null step the masses in time by 'dt'. Broken springs apply no
+// force and are not released, their number is added to 'nbRupture'.
+// The observables calculated during the step are added to 'stats'.
+// Return false if the threads or the color classes couldn't be 
+// created, in which case the SpringSys is unchanged, else true
+static bool SpringSysStepParallel(SpringSys *sys, float dt, 
+  int *nbRupture, SpringSysStats *stats);
+
+// Create a pool of 'nbThread' threads (including the calling thread)
+// Return NULL if the threads couldn't be created
+static SpringSysThreadPool* SpringSysThreadPoolCreate(int nbThread);
+
+// Stop the threads of the pool 'pool' and free its memory
+static void SpringSysThreadPoolFree(SpringSysThreadPool **pool);
+
+// Execute 'job' with argument 'arg' on all the threads of the pool 
+// 'pool' and wait for its completion
+static void SpringSysThreadPoolRun(SpringSysThreadPool *pool,
+  void (*job)(void *arg, int iThread, int nbThread), void *arg);
+
+// Main function of the worker threads of a pool, 'arg' is the 
+// SpringSysThreadPool
+static void* SpringSysThreadPoolWorker(void *arg);
+
+// Partition the springs of the compiled packed arrays 'soa' into color
+// classes such as no two springs of a class share a mass, and sort 
+// them by class
+// Return false if memory allocation failed, else return true
+static bool SpringSysSoAColorSprings(SpringSysSoA *soa);
+
+// Set the positions of the first spring of each color class of the 
+// compiled packed arrays 'soa' from the colors of the springs
+static void SpringSysSoABuildColors(SpringSysSoA *soa);
+
+// Return the sum of the norm of the speed of masses in the packed 
+// arrays 'soa' with 'nbDim' dimensions
+SPRINGSYS_KERNEL float SpringSysMomentumDim(const SpringSysSoA *soa,
+  int nbDim);
+
+// Return the position of the nearest mass from 'pos' in the packed 
+// arrays 'soa' with 'nbDim' dimensions, or -1 if there is no mass. The
+// grid of masses is used if it's valid, else all the masses are 
+// checked. Among masses at the same distance, the first one in the 
+// packed arrays is returned.
+SPRINGSYS_KERNEL int SpringSysNearestMassDim(const SpringSysSoA *soa,
+  const float *pos, int nbDim);
+
+// Check if the mass at position 'iMass' in the packed arrays 'soa' 
+// with 'nbDim' dimensions is nearer from 'pos' than the mass 
+// 'nearest' at the squared distance 'dNearest' (the first one among 
+// masses at the same distance), and if so update them
+SPRINGSYS_KERNEL void SpringSysNearestMassCheckDim(
+  const SpringSysSoA *soa, const float *pos, int iMass, int *nearest,
+  float *dNearest, int nbDim);
+
+// Search the nearest masses of a batch of positions, the part of the 
+// thread 'iThread' among 'nbThread', 'arg' is a SpringSysNearestBatch
+static void SpringSysNearestMassJob(void *arg, int iThread, 
+  int nbThread);
+
+// Return the position of the nearest spring from 'pos' in the packed 
+// arrays 'soa' with 'nbDim' dimensions, or -1 if there is no spring, 
+// the distance to a spring being the distance to the segment between 
+// its masses. The hierarchy of springs is used if it's valid, else all
+// the springs are checked. Among springs at the same distance, the 
+// first one in the packed arrays is returned.
+SPRINGSYS_KERNEL int SpringSysNearestSpringDim(const SpringSysSoA *soa,
+  const float *pos, int nbDim);
+
+// Check if the spring at position 'iSpring' in the packed arrays 'soa'
+// with 'nbDim' dimensions is nearer from 'pos' than the spring 
+// 'nearest' at the squared distance 'dNearest' (the first one among 
+// springs at the same distance), and if so update them
+SPRINGSYS_KERNEL void SpringSysNearestSpringCheckDim(
+  const SpringSysSoA *soa, const float *pos, int iSpring, int *nearest,
+  float *dNearest, int nbDim);
+
+// Return the squared distance from 'pos' to the segment ['pA', 'pB'] 
+// with 'nbDim' dimensions
+SPRINGSYS_KERNEL float SpringSysSegmentSqDistDim(const float *pos, 
+  const float *pA, const float *pB, int nbDim);
+
+// Return the squared distance from 'pos' to the box 'box' (lower 
+// corner then upper corner) with 'nbDim' dimensions
+SPRINGSYS_KERNEL float SpringSysBoxSqDistDim(const float *box, 
+  const float *pos, int nbDim);
+
+// Set the range 'range' with 'nbDim' dimensions to the ball of center 
+// 'center' and radius 'radius'
+static void SpringSysRangeSetSphere(SpringSysRange *range, 
+  const float *center, float radius, int nbDim);
+
+// Set the range 'range' with 'nbDim' dimensions to the box from 'min' 
+// to 'max'
+static void SpringSysRangeSetBox(SpringSysRange *range, 
+  const float *min, const float *max, int nbDim);
+
+// Return true if 'pos' with 'nbDim' dimensions is in the range 
+// 'range', else false
+static inline bool SpringSysRangeHasPos(const SpringSysRange *range,
+  const float *pos, int nbDim);
+
+// Return true if the segment ['pA', 'pB'] with 'nbDim' dimensions 
+// crosses the range 'range', else false
+static inline bool SpringSysRangeHasSegment(const SpringSysRange *range,
+  const float *pA, const float *pB, int nbDim);
+
+// Return true if the box 'box' (lower corner then upper corner) with 
+// 'nbDim' dimensions overlaps the range 'range', else false
+static inline bool SpringSysRangeHitsBox(const SpringSysRange *range,
+  const float *box, int nbDim);
+
+// Add the id 'id' to the list 'list', enlarging it if necessary
+// Return false if memory allocation failed, else true
+static inline bool SpringSysIdListAdd(SpringSysIdList *list, int id);
+
+// Get the ids of the masses in the range 'range' of the SpringSys 
+// 'sys' and store their number in 'nb'
+// Return the ids in an array to be freed by the user, or NULL if 
+// memory allocation failed
+static int* SpringSysGetMassesInRange(SpringSys *sys, 
+  const SpringSysRange *range, int *nb);
+
+// Get the ids of the springs crossing the range 'range' of the 
+// SpringSys 'sys' and store their number in 'nb'
+// Return the ids in an array to be freed by the user, or NULL if 
+// memory allocation failed
+static int* SpringSysGetSpringsInRange(SpringSys *sys, 
+  const SpringSysRange *range, int *nb);
+
+// Build the hierarchy of the springs of the packed arrays 'soa' with 
+// 'nbDim' dimensions if it doesn't match the springs or has been refit
+// too many times, else refit it if it doesn't match the positions
+static void SpringSysSoAPrepareBVH(SpringSysSoA *soa, int nbDim);
+
+// Build the hierarchy of the springs of the packed arrays 'soa' with 
+// 'nbDim' dimensions, splitting the springs at the median of their 
+// centers along the longest dimension of their centers' box until 
+// there are at most SPRINGSYS_BVH_LEAF springs per leaf, and fit it 
+// to the current positions
+// Return false if memory allocation failed, in which case the 
+// hierarchy is not valid, else true
+static bool SpringSysSoABuildBVH(SpringSysSoA *soa, int nbDim);
+
+// Fit the boxes of the nodes of the hierarchy of springs of the packed
+// arrays 'soa' with 'nbDim' dimensions to the current positions
+static void SpringSysSoARefitBVH(SpringSysSoA *soa, int nbDim);
+
+// Reorder the 'nb' indices 'idx' such as the one at position 'k' is 
+// the one it would be at if they were sorted by increasing key, the 
+// ones before it having a lower or equal key and the ones after it a 
+// greater or equal one. The key of the index i is 'key'[i * 'stride'].
+static void SpringSysSelect(int *idx, const float *key, int stride, 
+  int nb, int k);
+
+// The masses of the packed arrays 'soa' have moved, flag the 
+// structures searching masses and springs by position as outdated
+static inline void SpringSysSoAMoved(SpringSysSoA *soa);
+
+// Sort the masses of the packed arrays 'soa' with 'nbDim' dimensions 
+// into a uniform grid over their bounding box, with about 
+// SPRINGSYS_GRID_DENSITY masses per cell, reusing the memory of the 
+// previous grid
+// Return false if the positions are not finite or memory allocation 
+// failed, in which case the grid is not valid, else true
+static bool SpringSysSoABuildGrid(SpringSysSoA *soa, int nbDim);
+
+// Return the coordinate along the dimension 'iDim' of the cell of the 
+// grid of masses of 'soa' containing the coordinate 'x', clamped to 
+// the grid (non numbers are in the first cell)
+static inline int SpringSysSoAGridCoord(const SpringSysSoA *soa, 
+  float x, int iDim);
+
+// Return the index of the cell of the grid of masses of 'soa' with 
+// 'nbDim' dimensions containing 'pos', clamped to the grid
+static inline int SpringSysSoAGridCell(const SpringSysSoA *soa, 
+  const float *pos, int nbDim);
+
+// Kernels specialized for 1, 2 and 3 dimensions
+static const SpringSysDimKernels springSysDimKernels[3];
+
+// Last stamp given to the topology of a SpringSys, and mutex 
+// protecting it (cf SpringSysGetTopology)
+static unsigned long springSysTopologyLast = 0;
+static pthread_mutex_t springSysTopologyMutex = 
+  PTHREAD_MUTEX_INITIALIZER;
+
+// Flag the topology of the SpringSys 'sys' as modified, it's stamped
+// again when needed
+static inline void SpringSysTopologyModified(SpringSys *sys);
+
+// Get the stamp of the topology of the SpringSys 'sys', stamping it if
+// it has been modified since its last stamp
+static unsigned long SpringSysGetTopology(SpringSys *sys);
+
+// Step in time by 'dt' the instances at positions [first, last[ of 
+// the ensemble 'ens' with 'nbDim' dimensions
+SPRINGSYS_KERNEL void SpringSysEnsembleStepDim(SpringSysEnsemble *ens,
+  float dt, int first, int last, int nbDim);
+
+// Step in time the ensemble, part of the thread 'iThread' among 
+// 'nbThread', 'arg' is a SpringSysEnsembleStepArg
+static void SpringSysEnsembleStepJob(void *arg, int iThread, 
+  int nbThread);
+
+// Get the position of the mass identified by 'id' in the ensemble 
+// 'ens'
+// Return -1 if there is no mass with this id
+static int SpringSysEnsembleGetMassSlot(SpringSysEnsemble *ens, int id);
+
+// Move the spring at position 'first' + i in the packed arrays 'soa' to
+// the position 'first' + 'perm'[i], for i in [0, 'nb'[, using 'tmp' 
+// as buffer (2 pointers per spring)
+static void SpringSysSoAPermuteSprings(SpringSysSoA *soa, int first, 
+  int nb, const int *perm, void *tmp);
+
+// Orient and sort the springs of the packed arrays 'soa' as required
+// by the compiled topology and set _rowStart, which must be allocated
+// Return false if memory allocation failed, else return true
+static bool SpringSysSoASortSprings(SpringSysSoA *soa);
+
+// Set the positions of the first spring of each row in the compiled 
+// packed arrays 'soa', whose springs are sorted
+static void SpringSysSoABuildRows(SpringSysSoA *soa);
+
+// Remove from the packed arrays and the set of springs of the 
+// SpringSys 'sys' the springs broken during the step
+static void SpringSysSoARemoveBroken(SpringSys *sys);
+
+// Return true if the Euler step of the compiled SpringSys 'sys' must 
+// use its islands, else false
+static bool SpringSysUseIslands(SpringSys *sys);
+
+// Step in time by 'dt' the islands awake of the compiled snapshot of 
+// the SpringSys 'sys' with the Euler scheme, on its threads, and put 
+// asleep the ones which stayed under the thresholds of sleep long 
+// enough. The islands are created and assigned to the threads if 
+// necessary, and split after ruptures.
+// Return false if the islands couldn't be created, or if they are not
+// used to sleep and don't share the work evenly enough between the 
+// threads, in which case the SpringSys is unchanged, else true
+static bool SpringSysStepIslands(SpringSys *sys, float dt);
+
+// Step in time the islands of the compiled snapshot of a SpringSys, 
+// the ones of the thread 'iThread' among 'nbThread', 'arg' is a 
+// SpringSysParallelStep
+static void SpringSysStepIslandsJob(void *arg, int iThread, 
+  int nbThread);
+
+// Step in time by 'dt' the island at position 'iIsland' of the 
+// compiled snapshot of the SpringSys 'sys', unless it's asleep, 
+// applying the forces of its springs with 'pass', and put it asleep if
+// it stayed under the thresholds of sleep long enough. Its observables
+// and number of ruptures are memorized, broken springs are not 
+// released. The forces on fixed masses must have been reset.
+static void SpringSysStepIsland(SpringSys *sys, float dt, int iIsland,
+  SpringSysSpringPass pass);
+
+// Partition the masses and springs of the compiled snapshot of the 
+// SpringSys 'sys' into islands, all awake, and sort them by island. 
+// No record must be handed out.
+// Return false if memory allocation failed, in which case the snapshot
+// is unchanged, else return true
+static bool SpringSysSoABuildIslands(SpringSys *sys);
+
+// Allocate the state of 'nbIsland' islands (plus the island of fixed 
+// masses) of the compiled packed arrays 'soa', all awake, replacing 
+// the current one, which is freed. The islands must be assigned to 
+// threads again.
+// Return false if memory allocation failed, in which case the current
+// state is unchanged, else return true
+static bool SpringSysSoAAllocIslandState(SpringSysSoA *soa, 
+  int nbIsland);
+
+// Release the islands of the compiled packed arrays 'soa'
+static void SpringSysSoAFreeIslands(SpringSysSoA *soa);
+
+// Set the positions of the first mass and spring of each island of 
+// the compiled packed arrays 'soa' from the islands of masses and 
+// springs
+static void SpringSysSoABuildIslandStarts(SpringSysSoA *soa);
+
+// Split the islands of the compiled snapshot of the SpringSys 'sys' 
+// whose springs broke at the last step into their connected parts, 
+// the parts of an island follow each other and are awake. If memory 
+// allocation failed, the islands are released and will be created 
+// again at the next step.
+static void SpringSysSoASplitIslands(SpringSys *sys);
+
+// Sort the masses and springs of the island at position 'iIsland' in 
+// the compiled snapshot of the SpringSys 'sys' by connected part, 
+// using 'buf' (3 integers per mass or spring plus one) and 'tmp' (2 
+// pointers per mass or spring) as buffers. If there are several parts
+// the island of its masses and springs is set to -1 - p, where p is 
+// the index of their part.
+// Return the number of parts
+static int SpringSysSoASplitIsland(SpringSys *sys, int iIsland, 
+  int *buf, void *tmp);
+
+// Set 'perm'[i] to the position of the element i after sorting the 
+// 'nb' elements by their key 'key'[i] in [0, 'nbKey'[, keeping their 
+// order for equal keys, using 'count' ('nbKey' + 1 integers) as buffer
+static void SpringSysCountingSort(const int *key, int nb, int nbKey, 
+  int *count, int *perm);
+
+// Assign the islands of the compiled packed arrays 'soa' to 'nbThread'
+// threads, the islands connected through a fixed mass to the same 
+// thread, sharing their masses and springs between the threads (the 
+// largest groups of islands first, each to the least busy thread)
+// Return the ratio between the work of the busiest thread and the 
+// average work of threads (INFINITY if memory allocation failed, in 
+// which case all the islands are assigned to the first thread)
+static float SpringSysSoAAssignIslands(SpringSysSoA *soa, 
+  int nbThread);
+
+// Compare the groups of islands 'a' and 'b' to sort them by 
+// decreasing work, then increasing representative (cf qsort)
+static int SpringSysIslandGroupCmp(const void *a, const void *b);
+
+// Move the mass at position 'first' + i in the packed arrays of the 
+// SpringSys 'sys' to the position 'first' + 'perm'[i], for i in [0, 
+// 'nb'[, using 'tmp' as buffer (2 pointers per mass), and update the 
+// springs at positions ['firstSpring', 'lastSpring'[, which must be 
+// the only ones attached to the moved masses. No record must be 
+// handed out.
+static void SpringSysSoAPermuteMasses(SpringSys *sys, int first, 
+  int nb, const int *perm, int firstSpring, int lastSpring, void *tmp);
+
+// Return the representative of the set of 'i' in the disjoint sets 
+// 'root' (where 'root'[i] is the parent of i), halving the path from
+// 'i' to the representative
+static inline int SpringSysUnionFind(int *root, int i);
+
+// Merge the sets of 'a' and 'b' in the disjoint sets 'root', the 
+// representative of the union is the lowest of their representatives
+static inline void SpringSysUnion(int *root, int a, int b);
+
+// Wake up the island at position 'iIsland' in the compiled packed 
+// arrays 'soa'
+static inline void SpringSysSoAWakeIsland(SpringSysSoA *soa, 
+  int iIsland);
+
+// Wake up the islands of the compiled packed arrays 'soa' affected by
+// the modification of the mass at position 'iMass', whose record 
+// hasn't been copied into the arrays yet
+static void SpringSysSoAWakeMass(SpringSysSoA *soa, int iMass);
+
+// Write 'v' zigzag encoded as a variable length integer at 'p' (1 to 
+// 10 bytes, 7 bits per byte, least significant first)
+// Return the position following the integer
+static inline unsigned char* SpringSysPutVarint(unsigned char *p, 
+  int64_t v);
+
+// Read the variable length integer at '*p' (cf SpringSysPutVarint), 
+// which must end before 'end', into 'v' and move '*p' after it
+// Return false if the integer is invalid, else return true
+static inline bool SpringSysGetVarint(const unsigned char **p, 
+  const unsigned char *end, int64_t *v);
+
+// Return the value 'v' quantized with the step 'precision'
+static inline int64_t SpringSysQuantize(float v, float precision);
+
+// Make room in the slot 'slot' for a frame of 'nbMass' masses with 
+// 'nbDim' dimensions and 'nbSpring' springs and the contents 'content'
+// Return false if memory allocation failed, else return true
+static bool SpringSysRecorderSlotReserve(SpringSysRecorderSlot *slot, 
+  int nbDim, int content, int nbMass, int nbSpring);
+
+// Main function of the writing thread of a recorder, 'arg' is the 
+// SpringSysRecorderQueue
+static void* SpringSysRecorderWriter(void *arg);
+
+// Encode the frame 'slot' of the recorder queue 'queue' and write it
+// Return false if the frame couldn't be written, else return true
+static bool SpringSysRecorderWrite(SpringSysRecorderQueue *queue, 
+  SpringSysRecorderSlot *slot);
+
+// Reallocate the array '*ptr' to 'size' bytes, or free it if 'size' 
+// is null
+// Return false if memory allocation failed, else return true
+static bool SpringSysFrameResize(void **ptr, size_t size);
+
+// Decode the frame of 'size' bytes in the buffer of 'frame', following
+// the size of the frame in the stream
+// Return 0 in case of success, 2 if memory allocation failed or 3 if
+// the data are invalid
+static int SpringSysFrameDecode(SpringSysFrame *frame, size_t size);
+
+// ================ Functions implementation ====================
+
 // Create a new SpringSys with number of dimensions 'nbDim' (in [1,3])
 // Default dissipation coefficient _dissip = 0.01
 // Return NULL if we couldn't create the Springsys
@@ -17,8 +1072,62 @@ SpringSys* SpringSysCreate(int nbDim) {
   if (ret != NULL) {
     // Set the number of dimensions
     ret->_nbDim = nbDim;
+    // Select the kernels specialized for this number of dimensions
+    ret->_dimKernels = springSysDimKernels + (nbDim - 1);
     // Set the dissipation coefficient
     ret->_dissip = 0.1;
+    // Set the backend, the SpringSys is initially not packed
+    ret->_backend = springSysBackendGSet;
+    ret->_soa = NULL;
+    // Set the number of threads, the pool is created at the first 
+    // step needing it
+    ret->_nbThread = 1;
+    ret->_threadPool = NULL;
+    // Set the kernel to the fastest one supported by the CPU
+    ret->_kernel = springSysKernelScalar;
+    if (SpringSysKernelIsSupported(springSysKernelAVX512))
+      ret->_kernel = springSysKernelAVX512;
+    else if (SpringSysKernelIsSupported(springSysKernelAVX2))
+      ret->_kernel = springSysKernelAVX2;
+    // Set the integrator
+    ret->_integrator = springSysIntegratorEuler;
+    ret->_solverTol = 0.0001;
+    ret->_solverMaxIter = 200;
+    ret->_solverNbIter = 0;
+    ret->_solverResidual = 0.0;
+    // Set the adaptive steps
+    ret->_adaptTol = 0.0;
+    ret->_adaptDt = 0.0;
+    ret->_nbStepAccepted = 0;
+    ret->_nbStepRejected = 0;
+    // Set the observables, calculated at the first step, and the 
+    // period of the checks of equilibrium
+    memset(&(ret->_stats), 0, sizeof(SpringSysStats));
+    ret->_statsValid = false;
+    // Set the events of ruptures and the tombstones
+    ret->_rupture = NULL;
+    ret->_ruptureFirst = 0;
+    ret->_nbRupture = 0;
+    ret->_ruptureSize = 0;
+    ret->_nbRuptureLost = 0;
+    ret->_tombstone = NULL;
+    ret->_nbTombstone = 0;
+    ret->_tombstoneSize = 0;
+    ret->_restCheckPeriod = 1;
+    // Set the thresholds of sleep, islands don't sleep by default
+    ret->_sleepMomentum = 0.0;
+    ret->_sleepForce = 0.0;
+    ret->_nbIslandActive = 0;
+    ret->_nbIslandSleeping = 0;
+    // Set the collisions, masses don't collide by default
+    ret->_collideRadius = 0.0;
+    ret->_collideK = 0.0;
+    ret->_collideCell = 0.0;
+    ret->_nbContact = 0;
+    // Set the pools of records, empty
+    SpringSysPoolInit(&(ret->_massPool), sizeof(SpringSysMass));
+    SpringSysPoolInit(&(ret->_springPool), sizeof(SpringSysSpring));
+    ret->_topology = 0;
     // Create the gset of masses
     ret->_masses = GSetCreate();
     // If we couldn't create the gset
@@ -38,8 +1147,19 @@ SpringSys* SpringSysCreate(int nbDim) {
       // Return NULL
       return NULL;
     }
+    // Create the index of masses
+    ret->_massIndex = SpringSysIndexCreate();
+    // If we couldn't create the index
+    if (ret->_massIndex == NULL) {
+      // Free memory
+      GSetFree(&(ret->_masses));
+      GSetFree(&(ret->_springs));
+      free(ret);
+      // Return NULL
+      return NULL;
+    }
   }
-  return ret;
+  return ret;  
 }
 
 // Clone the SpringSys 'sys'
@@ -56,11 +1176,64 @@ SpringSys* SpringSysClone(SpringSys *sys) {
   if (ret != NULL) {
     // Set the number of dimensions
     ret->_nbDim = sys->_nbDim;
+    ret->_dimKernels = sys->_dimKernels;
     // Set the dissipation coefficient
     ret->_dissip = sys->_dissip;
+    // Set the backend, the clone will be packed at its first step
+    ret->_backend = sys->_backend;
+    ret->_soa = NULL;
+    // Set the kernel
+    ret->_kernel = sys->_kernel;
+    // Set the integrator
+    ret->_integrator = sys->_integrator;
+    ret->_solverTol = sys->_solverTol;
+    ret->_solverMaxIter = sys->_solverMaxIter;
+    ret->_solverNbIter = 0;
+    ret->_solverResidual = 0.0;
+    // Set the adaptive steps
+    ret->_adaptTol = sys->_adaptTol;
+    ret->_adaptDt = sys->_adaptDt;
+    ret->_nbStepAccepted = 0;
+    ret->_nbStepRejected = 0;
+    // Set the observables, calculated at the first step, and the 
+    // period of the checks of equilibrium
+    memset(&(ret->_stats), 0, sizeof(SpringSysStats));
+    ret->_statsValid = false;
+    // Set the events of ruptures and the tombstones
+    ret->_rupture = NULL;
+    ret->_ruptureFirst = 0;
+    ret->_nbRupture = 0;
+    ret->_ruptureSize = 0;
+    ret->_nbRuptureLost = 0;
+    ret->_tombstone = NULL;
+    ret->_nbTombstone = 0;
+    ret->_tombstoneSize = 0;
+    ret->_restCheckPeriod = sys->_restCheckPeriod;
+    // Set the thresholds of sleep, all the islands of the clone are 
+    // awake
+    ret->_sleepMomentum = sys->_sleepMomentum;
+    ret->_sleepForce = sys->_sleepForce;
+    ret->_nbIslandActive = 0;
+    ret->_nbIslandSleeping = 0;
+    // Set the collisions
+    ret->_collideRadius = sys->_collideRadius;
+    ret->_collideK = sys->_collideK;
+    ret->_collideCell = sys->_collideCell;
+    ret->_nbContact = 0;
+    // Set the pools of records, empty
+    SpringSysPoolInit(&(ret->_massPool), sizeof(SpringSysMass));
+    SpringSysPoolInit(&(ret->_springPool), sizeof(SpringSysSpring));
+    ret->_topology = 0;
+    // Set the number of threads, the clone has its own pool
+    ret->_nbThread = sys->_nbThread;
+    ret->_threadPool = NULL;
     // Initialize the pointer to gsets of masses and springs
     ret->_masses = NULL;
     ret->_springs = NULL;
+    ret->_massIndex = NULL;
+    // If the SpringSys is packed, update its records before copying them
+    if (sys->_soa != NULL)
+      SpringSysSoAPullAll(sys);
     // Create the gset of masses
     ret->_masses = GSetCreate();
     // If we couldn't create the gset
@@ -80,6 +1253,23 @@ SpringSys* SpringSysClone(SpringSys *sys) {
       // Return NULL
       return NULL;
     }
+    // Create the index of masses
+    ret->_massIndex = SpringSysIndexCreate();
+    // If we couldn't create the index
+    if (ret->_massIndex == NULL) {
+      // Free memory
+      SpringSysFree(&ret);
+      // Return NULL
+      return NULL;
+    }
+    // Make room in the index and the pools for all the masses and 
+    // springs at once
+    if (sys->_masses != NULL) {
+      SpringSysIndexReserve(ret->_massIndex, sys->_masses->_nbElem);
+      SpringSysPoolReserve(&(ret->_massPool), sys->_masses->_nbElem);
+    }
+    if (sys->_springs != NULL)
+      SpringSysPoolReserve(&(ret->_springPool), sys->_springs->_nbElem);
     // If there is a gset of masses
     if (sys->_masses != NULL) {
       // Copy the masses
@@ -90,7 +1280,7 @@ SpringSys* SpringSysClone(SpringSys *sys) {
         // If the mass is not null in the SpringSys
         if (m->_data != NULL) {
           // Allocate memory for the clone of the mass
-          mass = (SpringSysMass*)malloc(sizeof(SpringSysMass));
+          mass = (SpringSysMass*)SpringSysPoolAlloc(&(ret->_massPool));
           // If we couldn't allocate memory
           if (mass == NULL) {
             // Free the memory
@@ -108,7 +1298,15 @@ SpringSys* SpringSysClone(SpringSys *sys) {
         // If we couldn't append the mass
         if (nbMass + 1 != ret->_masses->_nbElem) {
           // Free the memory
-          free(mass);
+          SpringSysPoolRelease(&(ret->_massPool), mass);
+          SpringSysFree(&ret);
+          // Return NULL
+          return NULL;
+        }
+        // If we couldn't index the mass
+        if (mass != NULL && 
+          !SpringSysIndexAdd(ret->_massIndex, mass->_id, mass)) {
+          // Free the memory
           SpringSysFree(&ret);
           // Return NULL
           return NULL;
@@ -127,7 +1325,8 @@ SpringSys* SpringSysClone(SpringSys *sys) {
         // If the spring is not null in the SpringSys
         if (s->_data != NULL) {
           // Allocate memory for the clone of the spring
-          spring = (SpringSysSpring*)malloc(sizeof(SpringSysSpring));
+          spring = 
+            (SpringSysSpring*)SpringSysPoolAlloc(&(ret->_springPool));
           // If we couldn't allocate memory
           if (spring == NULL) {
             // Free the memory
@@ -145,7 +1344,14 @@ SpringSys* SpringSysClone(SpringSys *sys) {
         // If we couldn't append the spring
         if (nbSpring + 1 != ret->_springs->_nbElem) {
           // Free the memory
-          free(spring);
+          SpringSysPoolRelease(&(ret->_springPool), spring);
+          SpringSysFree(&ret);
+          // Return NULL
+          return NULL;
+        }
+        // If we couldn't connect the spring to its masses
+        if (spring != NULL && !SpringSysAttachSpring(ret, spring)) {
+          // Free the memory
           SpringSysFree(&ret);
           // Return NULL
           return NULL;
@@ -154,11 +1360,94 @@ SpringSys* SpringSysClone(SpringSys *sys) {
         s = s->_next;
       }
     }
+    // The clone shares the topology of the SpringSys
+    ret->_topology = SpringSysGetTopology(sys);
   }
-  return ret;
+  return ret;  
+}
+
+// Copy the dynamic state of the SpringSys 'src' (positions, speeds and
+// stress of masses, lengths and stress of springs, observables of the
+// last step) into the SpringSys 'dst', reusing the memory of 'dst'
+// 'dst' and 'src' must have the same topology: one is a clone of the
+// other, or both are clones of the same SpringSys, and no mass or 
+// spring has been added, removed or broken in any of them since
+// Other properties of 'dst' (mass and fixed flag of masses, K 
+// coefficient and length at rest of springs, ...) are unchanged
+// Return false if arguments are invalid or the topologies are 
+// different, else return true
+bool SpringSysCopyStateInto(SpringSys *dst, SpringSys *src) {
+  // Check arguments
+  if (dst == NULL || src == NULL)
+    return false;
+  if (dst == src)
+    return true;
+  // If the topologies are different
+  if (SpringSysGetTopology(dst) != SpringSysGetTopology(src))
+    // Return false
+    return false;
+  // If the source is packed, update its records
+  if (src->_soa != NULL)
+    SpringSysSoAPullAll(src);
+  // Copy the state of masses, the sets of masses are in the same order
+  // in SpringSys with the same topology
+  size_t size = sizeof(float) * src->_nbDim;
+  GSetElem *eDst = dst->_masses->_head;
+  for (GSetElem *eSrc = src->_masses->_head; eSrc != NULL; 
+    eSrc = eSrc->_next, eDst = eDst->_next) {
+    SpringSysMass *mSrc = (SpringSysMass*)(eSrc->_data);
+    SpringSysMass *mDst = (SpringSysMass*)(eDst->_data);
+    if (mSrc != NULL && mDst != NULL) {
+      memcpy(mDst->_pos, mSrc->_pos, size);
+      memcpy(mDst->_speed, mSrc->_speed, size);
+      memcpy(mDst->_stress, mSrc->_stress, size);
+    }
+  }
+  // Copy the state of springs
+  eDst = dst->_springs->_head;
+  for (GSetElem *eSrc = src->_springs->_head; eSrc != NULL; 
+    eSrc = eSrc->_next, eDst = eDst->_next) {
+    SpringSysSpring *sSrc = (SpringSysSpring*)(eSrc->_data);
+    SpringSysSpring *sDst = (SpringSysSpring*)(eDst->_data);
+    if (sSrc != NULL && sDst != NULL) {
+      sDst->_length = sSrc->_length;
+      sDst->_stress = sSrc->_stress;
+    }
+  }
+  // If the destination is packed, flag all its records as handed out,
+  // they are copied into its packed arrays at its next step
+  if (dst->_soa != NULL)
+    dst->_soa->_allOut = true;
+  // Copy the observables
+  dst->_stats = src->_stats;
+  dst->_statsValid = src->_statsValid;
+  // Return true
+  return true;
+}
+
+// Flag the topology of the SpringSys 'sys' as modified, it's stamped
+// again when needed
+static inline void SpringSysTopologyModified(SpringSys *sys) {
+  sys->_topology = 0;
+}
+
+// Get the stamp of the topology of the SpringSys 'sys', stamping it if
+// it has been modified since its last stamp
+static unsigned long SpringSysGetTopology(SpringSys *sys) {
+  // If the topology has been modified since its last stamp
+  if (sys->_topology == 0) {
+    // Stamp it with a new stamp, unique among all the SpringSys
+    pthread_mutex_lock(&springSysTopologyMutex);
+    sys->_topology = ++springSysTopologyLast;
+    pthread_mutex_unlock(&springSysTopologyMutex);
+  }
+  // Return the stamp
+  return sys->_topology;
 }
 
-// Load the SpringSys 'sys' from the stream 'stream'
+// Load the SpringSys 'sys' from the stream 'stream', in text format 
+// (cf SpringSysSave) or binary format (cf SpringSysSaveBinary) 
+// automatically detected
 // If 'sys' is already allocated, it is freed before loading
 // Return 0 in case of success, or:
 // 1: invalid arguments
@@ -172,9 +1461,19 @@ int SpringSysLoad(SpringSys **sys, FILE *stream) {
   if (*sys != NULL)
     // Free memory
     SpringSysFree(sys);
+  // Peek the first character, the binary format starts with the first
+  // character of its magic number while the text format starts with 
+  // the number of dimensions
+  int c = getc(stream);
+  if (c == EOF)
+    return 3;
+  ungetc(c, stream);
+  if (c == SPRINGSYS_BINARY_MAGIC[0])
+    return SpringSysLoadBinaryStream(sys, stream);
   // Read the number of dimension
   int nbDim;
-  int ret = fscanf(stream, "%d\n", &nbDim);
+  if (fscanf(stream, "%d\n", &nbDim) != 1 || nbDim < 1 || nbDim > 3)
+    return 3;
   // Allocate memory for the SpringSys
   *sys = SpringSysCreate(nbDim);
   // If we couldn't allocate memory
@@ -196,69 +1495,58 @@ int SpringSysLoad(SpringSys **sys, FILE *stream) {
   }
   // Read the number of mass
   int nbMass;
-  ret = fscanf(stream, "%d\n", &nbMass);
-  // For each mass
-  for (int iMass = 0; iMass < nbMass; ++iMass) {
+  bool ok = (fscanf(stream, "%d\n", &nbMass) == 1 && nbMass >= 0);
+  // For each mass, until an error occurs
+  for (int iMass = 0; ok && iMass < nbMass; ++iMass) {
     // Read the properties of the mass
-    ret = fscanf(stream, "%d\n", &(mass->_id));
-    ret = fscanf(stream, "%f %f %f\n", &(mass->_pos[0]), 
-      &(mass->_pos[1]), &(mass->_pos[2]));
-    ret = fscanf(stream, "%f %f %f\n", &(mass->_speed[0]), 
-      &(mass->_speed[1]), &(mass->_speed[2]));
-    ret = fscanf(stream, "%f %f %f\n", &(mass->_stress[0]), 
-      &(mass->_stress[1]), &(mass->_stress[2]));
-    ret = fscanf(stream, "%f\n", &(mass->_mass));
-    int b;
-    ret = fscanf(stream, "%d\n", &b);
+    int b = 0;
+    ok = (fscanf(stream, "%d\n", &(mass->_id)) == 1 &&
+      fscanf(stream, "%f %f %f\n", &(mass->_pos[0]), 
+        &(mass->_pos[1]), &(mass->_pos[2])) == 3 &&
+      fscanf(stream, "%f %f %f\n", &(mass->_speed[0]), 
+        &(mass->_speed[1]), &(mass->_speed[2])) == 3 &&
+      fscanf(stream, "%f %f %f\n", &(mass->_stress[0]), 
+        &(mass->_stress[1]), &(mass->_stress[2])) == 3 &&
+      fscanf(stream, "%f\n", &(mass->_mass)) == 1 &&
+      fscanf(stream, "%d\n", &b) == 1);
     mass->_fixed = b;
     // Add the mass
-    bool ok = SpringSysAddMass(*sys, mass);
-    // If we couldn't add the mass
-    if (ok == false) {
-      SpringSysMassFree(&mass);
-      SpringSysSpringFree(&spring);
-      SpringSysFree(sys);
-      return 3;
-    }
+    ok = ok && SpringSysAddMass(*sys, mass);
   }
   // Read the number of spring
   int nbSpring;
-  ret = fscanf(stream, "%d\n", &nbSpring);
-  // For each spring
-  for (int iSpring = 0; iSpring < nbSpring; ++iSpring) {
+  ok = ok && (fscanf(stream, "%d\n", &nbSpring) == 1 && nbSpring >= 0);
+  // For each spring, until an error occurs
+  for (int iSpring = 0; ok && iSpring < nbSpring; ++iSpring) {
     // Read the properties of the spring
-    ret = fscanf(stream, "%d\n", &(spring->_id));
-    ret = fscanf(stream, "%f\n", &(spring->_length));
-    ret = fscanf(stream, "%f\n", &(spring->_k));
-    ret = fscanf(stream, "%f\n", &(spring->_restLength));
-    ret = fscanf(stream, "%f\n", &(spring->_stress));
-    ret = fscanf(stream, "%f %f\n", &(spring->_maxStress[0]), 
-      &(spring->_maxStress[1]));
-    ret = fscanf(stream, "%d %d\n", &(spring->_mass[0]), 
-      &(spring->_mass[1]));
-    int b;
-    ret = fscanf(stream, "%d\n", &b);
+    int b = 0;
+    ok = (fscanf(stream, "%d\n", &(spring->_id)) == 1 &&
+      fscanf(stream, "%f\n", &(spring->_length)) == 1 &&
+      fscanf(stream, "%f\n", &(spring->_k)) == 1 &&
+      fscanf(stream, "%f\n", &(spring->_restLength)) == 1 &&
+      fscanf(stream, "%f\n", &(spring->_stress)) == 1 &&
+      fscanf(stream, "%f %f\n", &(spring->_maxStress[0]), 
+        &(spring->_maxStress[1])) == 2 &&
+      fscanf(stream, "%d %d\n", &(spring->_mass[0]), 
+        &(spring->_mass[1])) == 2 &&
+      fscanf(stream, "%d\n", &b) == 1);
     spring->_breakable = b;
     // Add the spring
-    bool ok = SpringSysAddSpring(*sys, spring);
-    // If we couldn't add the spring
-    if (ok == false) {
-      SpringSysMassFree(&mass);
-      SpringSysSpringFree(&spring);
-      SpringSysFree(sys);
-      return 3;
-    }
+    ok = ok && SpringSysAddSpring(*sys, spring);
   }
-  // TODO don't ignore the return value
-  ret = ret;
   // Free memory
   SpringSysMassFree(&mass);
   SpringSysSpringFree(&spring);
+  // If the data were invalid or we couldn't add them
+  if (!ok) {
+    SpringSysFree(sys);
+    return 3;
+  }
   // Return success code
   return 0;
 }
 
-// Save the SpringSys 'sys' to the stream
+// Save the SpringSys 'sys' to the stream in text format
 // Return 0 upon success, else
 // 1: invalid argument
 // 2: invalid SpringSys
@@ -267,6 +1555,9 @@ int SpringSysSave(SpringSys *sys, FILE *stream) {
   if (sys == NULL || sys->_masses == NULL || 
     sys->_springs == NULL || stream == NULL)
     return 1;
+  // If the SpringSys is packed, update its records before saving them
+  if (sys->_soa != NULL)
+    SpringSysSoAPullAll(sys);
   // Write the number of dimensions
   fprintf(stream, "%d\n", sys->_nbDim);
   // Write the number of masses
@@ -326,32 +1617,435 @@ int SpringSysSave(SpringSys *sys, FILE *stream) {
   return 0;
 }
 
-// Create a default mass
-// Return NULL if memory allocation failed
-SpringSysMass* SpringSysCreateMass(void) {
-  // Allocate memory
-  SpringSysMass *ret = (SpringSysMass*)malloc(sizeof(SpringSysMass));
-  // If we could allocate memory
-  if (ret != NULL) {
-    // Set default values for the properties
-    ret->_id = 0;
-    ret->_pos[0] = ret->_pos[1] = ret->_pos[2] = 0.0;
-    ret->_speed[0] = ret->_speed[1] = ret->_speed[2] = 0.0;
-    ret->_stress[0] = ret->_stress[1] = ret->_stress[2] = 0.0;
-    ret->_mass = 1.0;
-    ret->_fixed = false;
-    ret->_data = NULL;
-  }
-  // Return the new mass
-  return ret;
-}
-
-// Create a default spring
-// Return NULL if memory allocation failed
-SpringSysSpring* SpringSysCreateSpring(void) {
-  // Allocate memory
-  SpringSysSpring *ret = 
-    (SpringSysSpring*)malloc(sizeof(SpringSysSpring));
+// Save the SpringSys 'sys' to the stream 'stream' in binary format
+// (cf SpringSysSaveBinary in springsys.h for the layout)
+// Return 0 upon success, else
+// 1: invalid argument
+// 2: invalid SpringSys
+// 3: can't allocate memory or write to the stream
+int SpringSysSaveBinary(SpringSys *sys, FILE *stream) {
+  // Check arguments
+  if (sys == NULL || sys->_masses == NULL || 
+    sys->_springs == NULL || stream == NULL)
+    return 1;
+  // If the SpringSys is packed, update its records before saving them
+  if (sys->_soa != NULL)
+    SpringSysSoAPullAll(sys);
+  // Encode the header and write it
+  unsigned char header[SPRINGSYS_BINARY_HEADER];
+  memcpy(header, SPRINGSYS_BINARY_MAGIC, 8);
+  SpringSysPutU32(header + 8, SPRINGSYS_BINARY_VERSION);
+  SpringSysPutU32(header + 12, SPRINGSYS_BINARY_HEADER);
+  SpringSysPutU32(header + 16, sys->_nbDim);
+  SpringSysPutU32(header + 20, sys->_masses->_nbElem);
+  SpringSysPutU32(header + 24, sys->_springs->_nbElem);
+  SpringSysPutU32(header + 28, SPRINGSYS_BINARY_MASS);
+  SpringSysPutU32(header + 32, SPRINGSYS_BINARY_SPRING);
+  SpringSysPutU32(header + 36, 0);
+  SpringSysPutU64(header + 40, SpringSysChecksum(header, 40));
+  if (fwrite(header, 1, SPRINGSYS_BINARY_HEADER, stream) != 
+    SPRINGSYS_BINARY_HEADER)
+    return 3;
+  // Allocate memory to encode the records by chunks, a mass record is
+  // larger than a spring record
+  unsigned char *buffer = 
+    malloc(SPRINGSYS_BINARY_CHUNK * SPRINGSYS_BINARY_MASS);
+  if (buffer == NULL)
+    return 3;
+  // Running sums of the checksums of the masses and springs
+  uint64_t sumMass[2] = {0, 0};
+  uint64_t sumSpring[2] = {0, 0};
+  // Return code
+  int ret = 0;
+  // Loop on chunks of masses until the end of the list or an error
+  GSetElem *e = sys->_masses->_head;
+  while (e != NULL && ret == 0) {
+    // Encode the masses of the chunk
+    size_t nb = 0;
+    while (e != NULL && nb < SPRINGSYS_BINARY_CHUNK && ret == 0) {
+      SpringSysMass *m = (SpringSysMass*)(e->_data);
+      // If the pointer is null
+      if (m == NULL) {
+        // This should never happen
+        ret = 2;
+      } else {
+        unsigned char *p = buffer + nb * SPRINGSYS_BINARY_MASS;
+        SpringSysPutU32(p, (uint32_t)(m->_id));
+        for (int i = 0; i < 3; ++i) {
+          SpringSysPutF32(p + 4 + 4 * i, m->_pos[i]);
+          SpringSysPutF32(p + 16 + 4 * i, m->_speed[i]);
+          SpringSysPutF32(p + 28 + 4 * i, m->_stress[i]);
+        }
+        SpringSysPutF32(p + 40, m->_mass);
+        SpringSysPutU32(p + 44, (m->_fixed ? 1 : 0));
+        ++nb;
+        e = e->_next;
+      }
+    }
+    // Add the chunk to the checksum and write it
+    size_t size = nb * SPRINGSYS_BINARY_MASS;
+    SpringSysChecksumAdd(sumMass, buffer, size);
+    if (ret == 0 && fwrite(buffer, 1, size, stream) != size)
+      ret = 3;
+  }
+  // Loop on chunks of springs until the end of the list or an error
+  e = sys->_springs->_head;
+  while (e != NULL && ret == 0) {
+    // Encode the springs of the chunk
+    size_t nb = 0;
+    while (e != NULL && nb < SPRINGSYS_BINARY_CHUNK && ret == 0) {
+      SpringSysSpring *s = (SpringSysSpring*)(e->_data);
+      // If the pointer is null
+      if (s == NULL) {
+        // This should never happen
+        ret = 2;
+      } else {
+        unsigned char *p = buffer + nb * SPRINGSYS_BINARY_SPRING;
+        SpringSysPutU32(p, (uint32_t)(s->_id));
+        SpringSysPutF32(p + 4, s->_length);
+        SpringSysPutF32(p + 8, s->_k);
+        SpringSysPutF32(p + 12, s->_restLength);
+        SpringSysPutF32(p + 16, s->_stress);
+        SpringSysPutF32(p + 20, s->_maxStress[0]);
+        SpringSysPutF32(p + 24, s->_maxStress[1]);
+        SpringSysPutU32(p + 28, (uint32_t)(s->_mass[0]));
+        SpringSysPutU32(p + 32, (uint32_t)(s->_mass[1]));
+        SpringSysPutU32(p + 36, (s->_breakable ? 1 : 0));
+        ++nb;
+        e = e->_next;
+      }
+    }
+    // Add the chunk to the checksum and write it
+    size_t size = nb * SPRINGSYS_BINARY_SPRING;
+    SpringSysChecksumAdd(sumSpring, buffer, size);
+    if (ret == 0 && fwrite(buffer, 1, size, stream) != size)
+      ret = 3;
+  }
+  // Free memory
+  free(buffer);
+  // Encode the trailer and write it
+  if (ret == 0) {
+    unsigned char trailer[SPRINGSYS_BINARY_TRAILER];
+    SpringSysPutU64(trailer, (sumMass[1] << 32) | sumMass[0]);
+    SpringSysPutU64(trailer + 8, (sumSpring[1] << 32) | sumSpring[0]);
+    if (fwrite(trailer, 1, SPRINGSYS_BINARY_TRAILER, stream) != 
+      SPRINGSYS_BINARY_TRAILER)
+      ret = 3;
+  }
+  // Return the code
+  return ret;
+}
+
+// Load the SpringSys 'sys' from the file at 'path', in text format 
+// (cf SpringSysSave) or binary format (cf SpringSysSaveBinary) 
+// automatically detected
+// The binary format is decoded directly from the file mapped in 
+// memory, without intermediate copy
+// If 'sys' is already allocated, it is freed before loading
+// Return 0 in case of success, or:
+// 1: invalid arguments
+// 2: can't allocate memory
+// 3: invalid data
+// 4: can't open the file
+int SpringSysLoadFile(SpringSys **sys, const char *path) {
+  // Check arguments
+  if (sys == NULL || path == NULL)
+    return 1;
+  // If the SpringSys is already allocated
+  if (*sys != NULL)
+    // Free memory
+    SpringSysFree(sys);
+  // Open the file and get its size
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return 4;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return 4;
+  }
+  size_t size = (size_t)(st.st_size);
+  // Map the file in memory, the mapping stays valid once the file is
+  // closed
+  unsigned char *data = NULL;
+  if (S_ISREG(st.st_mode) && size > 0) {
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED)
+      data = (unsigned char*)map;
+  }
+  close(fd);
+  // If the file is mapped
+  if (data != NULL) {
+    // If it is in binary format
+    if (data[0] == SPRINGSYS_BINARY_MAGIC[0]) {
+      // The data are read once to check them and once to decode them
+      posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+      // Decode the data
+      int ret = SpringSysLoadBinary(sys, data, size);
+      // Release the mapping
+      munmap(data, size);
+      // Return the code
+      return ret;
+    }
+    // Release the mapping
+    munmap(data, size);
+  }
+  // Else, the file is in text format or couldn't be mapped, load it
+  // through a stream
+  FILE *stream = fopen(path, "r");
+  if (stream == NULL)
+    return 4;
+  int ret = SpringSysLoad(sys, stream);
+  fclose(stream);
+  // Return the code
+  return ret;
+}
+
+// Read the little-endian unsigned integer of 32 bits at 'p'
+static inline uint32_t SpringSysGetU32(const unsigned char *p) {
+  return (uint32_t)(p[0]) | ((uint32_t)(p[1]) << 8) |
+    ((uint32_t)(p[2]) << 16) | ((uint32_t)(p[3]) << 24);
+}
+
+// Read the little-endian unsigned integer of 64 bits at 'p'
+static inline uint64_t SpringSysGetU64(const unsigned char *p) {
+  return (uint64_t)SpringSysGetU32(p) | 
+    ((uint64_t)SpringSysGetU32(p + 4) << 32);
+}
+
+// Read the little-endian float of 32 bits at 'p'
+static inline float SpringSysGetF32(const unsigned char *p) {
+  uint32_t u = SpringSysGetU32(p);
+  float v;
+  memcpy(&v, &u, sizeof(float));
+  return v;
+}
+
+// Write 'v' as a little-endian unsigned integer of 32 bits at 'p'
+static inline void SpringSysPutU32(unsigned char *p, uint32_t v) {
+  p[0] = (unsigned char)v;
+  p[1] = (unsigned char)(v >> 8);
+  p[2] = (unsigned char)(v >> 16);
+  p[3] = (unsigned char)(v >> 24);
+}
+
+// Write 'v' as a little-endian unsigned integer of 64 bits at 'p'
+static inline void SpringSysPutU64(unsigned char *p, uint64_t v) {
+  SpringSysPutU32(p, (uint32_t)v);
+  SpringSysPutU32(p + 4, (uint32_t)(v >> 32));
+}
+
+// Write 'v' as a little-endian float of 32 bits at 'p'
+static inline void SpringSysPutF32(unsigned char *p, float v) {
+  uint32_t u;
+  memcpy(&u, &v, sizeof(float));
+  SpringSysPutU32(p, u);
+}
+
+// Add the 'size' bytes at 'data' to the Fletcher-64 checksum whose
+// running sums are 'sum', 'size' must be a multiple of 4
+// The sums must be initialized to 0 and the checksum is 
+// (sum[1] << 32) | sum[0]
+static void SpringSysChecksumAdd(uint64_t *sum, 
+  const unsigned char *data, size_t size) {
+  uint64_t a = sum[0];
+  uint64_t b = sum[1];
+  // Loop on blocks of 1024 words, the sums are reduced modulo 2^32-1 
+  // after each block, which is often enough to avoid overflows
+  size_t i = 0;
+  while (i < size) {
+    size_t end = i + 4096;
+    if (end > size)
+      end = size;
+    for (; i < end; i += 4) {
+      a += SpringSysGetU32(data + i);
+      b += a;
+    }
+    a %= 0xFFFFFFFF;
+    b %= 0xFFFFFFFF;
+  }
+  sum[0] = a;
+  sum[1] = b;
+}
+
+// Return the Fletcher-64 checksum of the 'size' bytes at 'data'
+static uint64_t SpringSysChecksum(const unsigned char *data, 
+  size_t size) {
+  uint64_t sum[2] = {0, 0};
+  SpringSysChecksumAdd(sum, data, size);
+  return (sum[1] << 32) | sum[0];
+}
+
+// Check the header of binary format at 'header' and set 'size' to the
+// size in bytes of the whole data
+// Return false if the header is invalid, else return true
+static bool SpringSysBinarySize(const unsigned char *header, 
+  uint64_t *size) {
+  // Check the magic number, the version and the checksum
+  uint32_t version = SpringSysGetU32(header + 8);
+  if (memcmp(header, SPRINGSYS_BINARY_MAGIC, 8) != 0 || version < 1 || 
+    version > SPRINGSYS_BINARY_VERSION ||
+    SpringSysChecksum(header, 40) != SpringSysGetU64(header + 40))
+    return false;
+  // Check the sizes, the header and the records may be larger in later
+  // versions of the format and the additional data are then skipped
+  uint64_t sizeHeader = SpringSysGetU32(header + 12);
+  uint32_t nbDim = SpringSysGetU32(header + 16);
+  uint64_t nbMass = SpringSysGetU32(header + 20);
+  uint64_t nbSpring = SpringSysGetU32(header + 24);
+  uint64_t sizeMass = SpringSysGetU32(header + 28);
+  uint64_t sizeSpring = SpringSysGetU32(header + 32);
+  if (nbDim < 1 || nbDim > 3 || nbMass > INT_MAX || 
+    nbSpring > INT_MAX || sizeHeader < SPRINGSYS_BINARY_HEADER ||
+    sizeMass < SPRINGSYS_BINARY_MASS || 
+    sizeSpring < SPRINGSYS_BINARY_SPRING || sizeHeader > 65536 ||
+    sizeMass > 65536 || sizeSpring > 65536 || sizeHeader % 4 != 0 ||
+    sizeMass % 4 != 0 || sizeSpring % 4 != 0)
+    return false;
+  // Get the size of the whole data
+  *size = sizeHeader + nbMass * sizeMass + nbSpring * sizeSpring + 
+    SPRINGSYS_BINARY_TRAILER;
+  return true;
+}
+
+// Create the SpringSys 'sys' from the 'size' bytes of binary format 
+// at 'data'
+// Return 0 in case of success, or 2 if memory allocation failed, or 3
+// if the data are invalid
+static int SpringSysLoadBinary(SpringSys **sys, 
+  const unsigned char *data, size_t size) {
+  // Check the header and the size of the data
+  uint64_t sizeData;
+  if (size < SPRINGSYS_BINARY_HEADER || 
+    !SpringSysBinarySize(data, &sizeData) || sizeData > size)
+    return 3;
+  // Get the blocks of masses and springs and check them
+  int nbDim = (int)SpringSysGetU32(data + 16);
+  int nbMass = (int)SpringSysGetU32(data + 20);
+  int nbSpring = (int)SpringSysGetU32(data + 24);
+  size_t sizeMass = SpringSysGetU32(data + 28);
+  size_t sizeSpring = SpringSysGetU32(data + 32);
+  const unsigned char *masses = data + SpringSysGetU32(data + 12);
+  const unsigned char *springs = masses + nbMass * sizeMass;
+  const unsigned char *trailer = springs + nbSpring * sizeSpring;
+  if (SpringSysChecksum(masses, nbMass * sizeMass) != 
+    SpringSysGetU64(trailer) ||
+    SpringSysChecksum(springs, nbSpring * sizeSpring) != 
+    SpringSysGetU64(trailer + 8))
+    return 3;
+  // Allocate memory for the SpringSys, its masses and springs
+  *sys = SpringSysCreate(nbDim);
+  if (*sys == NULL)
+    return 2;
+  if (!SpringSysReserve(*sys, nbMass, nbSpring)) {
+    SpringSysFree(sys);
+    return 2;
+  }
+  // Return code
+  int ret = 0;
+  // Decode and add the masses until an error occurs
+  SpringSysMass m;
+  memset(&m, 0, sizeof(SpringSysMass));
+  for (int iMass = 0; iMass < nbMass && ret == 0; ++iMass) {
+    const unsigned char *p = masses + iMass * sizeMass;
+    m._id = (int)SpringSysGetU32(p);
+    for (int i = 0; i < 3; ++i) {
+      m._pos[i] = SpringSysGetF32(p + 4 + 4 * i);
+      m._speed[i] = SpringSysGetF32(p + 16 + 4 * i);
+      m._stress[i] = SpringSysGetF32(p + 28 + 4 * i);
+    }
+    m._mass = SpringSysGetF32(p + 40);
+    m._fixed = (SpringSysGetU32(p + 44) != 0);
+    if (!SpringSysIsValidMass(&m))
+      ret = 3;
+    else if (!SpringSysInsertMass(*sys, &m))
+      ret = 2;
+  }
+  // Decode and add the springs until an error occurs
+  SpringSysSpring s;
+  memset(&s, 0, sizeof(SpringSysSpring));
+  for (int iSpring = 0; iSpring < nbSpring && ret == 0; ++iSpring) {
+    const unsigned char *p = springs + iSpring * sizeSpring;
+    s._id = (int)SpringSysGetU32(p);
+    s._length = SpringSysGetF32(p + 4);
+    s._k = SpringSysGetF32(p + 8);
+    s._restLength = SpringSysGetF32(p + 12);
+    s._stress = SpringSysGetF32(p + 16);
+    s._maxStress[0] = SpringSysGetF32(p + 20);
+    s._maxStress[1] = SpringSysGetF32(p + 24);
+    s._mass[0] = (int)SpringSysGetU32(p + 28);
+    s._mass[1] = (int)SpringSysGetU32(p + 32);
+    s._breakable = (SpringSysGetU32(p + 36) != 0);
+    if (!SpringSysIsValidSpring(*sys, &s))
+      ret = 3;
+    else if (!SpringSysInsertSpring(*sys, &s))
+      ret = 2;
+  }
+  // If an error occured, free memory
+  if (ret != 0)
+    SpringSysFree(sys);
+  // Return the code
+  return ret;
+}
+
+// Create the SpringSys 'sys' from the binary format in the stream 
+// 'stream'
+// Return 0 in case of success, or 2 if memory allocation failed, or 3
+// if the data are invalid
+static int SpringSysLoadBinaryStream(SpringSys **sys, FILE *stream) {
+  // Read the header and get the size of the data
+  unsigned char header[SPRINGSYS_BINARY_HEADER];
+  uint64_t size;
+  if (fread(header, 1, SPRINGSYS_BINARY_HEADER, stream) != 
+    SPRINGSYS_BINARY_HEADER || !SpringSysBinarySize(header, &size))
+    return 3;
+  if (size > SIZE_MAX)
+    return 2;
+  // Read the whole data, the stream is left at the end of the data
+  unsigned char *data = malloc(size);
+  if (data == NULL)
+    return 2;
+  memcpy(data, header, SPRINGSYS_BINARY_HEADER);
+  size_t sizeLeft = size - SPRINGSYS_BINARY_HEADER;
+  if (fread(data + SPRINGSYS_BINARY_HEADER, 1, sizeLeft, stream) != 
+    sizeLeft) {
+    free(data);
+    return 3;
+  }
+  // Decode the data
+  int ret = SpringSysLoadBinary(sys, data, size);
+  // Free memory
+  free(data);
+  // Return the code
+  return ret;
+}
+
+// Create a default mass
+// Return NULL if memory allocation failed
+SpringSysMass* SpringSysCreateMass(void) {
+  // Allocate memory
+  SpringSysMass *ret = (SpringSysMass*)malloc(sizeof(SpringSysMass));
+  // If we could allocate memory
+  if (ret != NULL) {
+    // Set default values for the properties
+    ret->_id = 0;
+    ret->_pos[0] = ret->_pos[1] = ret->_pos[2] = 0.0;
+    ret->_speed[0] = ret->_speed[1] = ret->_speed[2] = 0.0;
+    ret->_stress[0] = ret->_stress[1] = ret->_stress[2] = 0.0;
+    ret->_mass = 1.0;
+    ret->_fixed = false;
+    ret->_data = NULL;
+  }
+  // Return the new mass
+  return ret;  
+}
+
+// Create a default spring
+// Return NULL if memory allocation failed
+SpringSysSpring* SpringSysCreateSpring(void) {
+  // Allocate memory
+  SpringSysSpring *ret = 
+    (SpringSysSpring*)malloc(sizeof(SpringSysSpring));
   // If we could allocate memory
   if (ret != NULL) {
     // Set default values for the properties
@@ -367,7 +2061,7 @@ SpringSysSpring* SpringSysCreateSpring(void) {
     ret->_breakable = false;
   }
   // Return the new spring
-  return ret;
+  return ret;  
 }
 
 // Free the memory used by a SpringSys
@@ -376,27 +2070,23 @@ void SpringSysFree(SpringSys **sys) {
   // Check arguments
   if (sys == NULL || *sys == NULL)
     return;
-  // If there is a gset of masses
-  if ((*sys)->_masses != NULL) {
-    // Free the memory used by masses
-    GSetElem *m = (*sys)->_masses->_head;
-    while (m != NULL) {
-      SpringSysMassFree((SpringSysMass**)(&(m->_data)));
-      m = m->_next;
-    }
-  }
-  // If there is a gset of springs
-  if ((*sys)->_springs != NULL) {
-    // Free the memory used by springs
-    GSetElem *s = (*sys)->_springs->_head;
-    while (s != NULL) {
-      SpringSysSpringFree((SpringSysSpring**)(&(s->_data)));
-      s = s->_next;
-    }
-  }
+  // Free the memory used by masses and springs, all at once with the 
+  // slabs of their pools
+  SpringSysPoolFree(&((*sys)->_massPool));
+  SpringSysPoolFree(&((*sys)->_springPool));
   // Free the gsets
   GSetFree(&((*sys)->_masses));
   GSetFree(&((*sys)->_springs));
+  // Free the index
+  SpringSysIndexFree(&((*sys)->_massIndex));
+  // Free the events of ruptures and the tombstones (there are none 
+  // between steps)
+  free((*sys)->_rupture);
+  free((*sys)->_tombstone);
+  // Free the packed arrays
+  SpringSysSoAFree(&((*sys)->_soa));
+  // Stop the threads
+  SpringSysThreadPoolFree(&((*sys)->_threadPool));
   // Free memory
   free(*sys);
   *sys = NULL;
@@ -431,6 +2121,9 @@ void SpringSysPrint(SpringSys *sys, FILE *stream) {
   // Check arguments
   if (sys == NULL || stream == NULL)
     return;
+  // If the SpringSys is packed, update its records before printing them
+  if (sys->_soa != NULL)
+    SpringSysSoAPullAll(sys);
   // Print the number of dimension
   fprintf(stream, "Number of dimension: %d\n", sys->_nbDim);
   // Print the dissipation
@@ -498,6 +2191,277 @@ void SpringSysSetDissip(SpringSys *sys, float dissip) {
   sys->_dissip = dissip;
 }
 
+// Set the storage backend of the SpringSys to 'backend'
+// Do nothing if arguments are invalid
+void SpringSysSetBackend(SpringSys *sys, SpringSysBackend backend) {
+  // Check arguments
+  if (sys == NULL || 
+    (backend != springSysBackendGSet && backend != springSysBackendSoA))
+    return;
+  // If the SpringSys leaves the SoA backend
+  if (backend != springSysBackendSoA)
+    // Release the packed arrays
+    SpringSysSoAUnpack(sys);
+  // Set the backend
+  sys->_backend = backend;
+}
+
+// Update the records of masses and springs in the GSets _masses and 
+// _springs from the packed arrays of the SpringSys. The records can
+// then be read and modified directly until the next step.
+// Do nothing if arguments are invalid or the SpringSys is not packed
+void SpringSysSync(SpringSys *sys) {
+  // Check arguments
+  if (sys == NULL || sys->_soa == NULL)
+    return;
+  // Update all the records
+  SpringSysSoAPullAll(sys);
+  // Flag all the records as handed out
+  sys->_soa->_allOut = true;
+}
+
+// Compile the SpringSys: freeze its current masses and springs into 
+// packed arrays whose springs are sorted in rows by their first mass,
+// with precomputed per-spring constants
+// Return false if arguments are invalid or memory allocation failed,
+// else return true
+bool SpringSysCompile(SpringSys *sys) {
+  // Check arguments
+  if (sys == NULL || sys->_masses == NULL || sys->_springs == NULL)
+    return false;
+  // If the SpringSys is already compiled
+  if (SpringSysIsCompiled(sys))
+    // Nothing to do
+    return true;
+  // Pack the masses and springs if necessary
+  if (!SpringSysSoAPrepare(sys))
+    return false;
+  // Allocate memory for the compiled data
+  SpringSysSoA *soa = sys->_soa;
+  int nS = (soa->_nbSpring > 0 ? soa->_nbSpring : 1);
+  soa->_rowStart = (int*)malloc(sizeof(int) * (soa->_nbMass + 1));
+  soa->_breakMin = (float*)malloc(sizeof(float) * nS);
+  soa->_breakMax = (float*)malloc(sizeof(float) * nS);
+  soa->_force = (float*)malloc(sizeof(float) * 
+    (soa->_nbMass > 0 ? soa->_nbMass : 1) * sys->_nbDim);
+  // If we couldn't allocate memory or sort the springs
+  if (soa->_rowStart == NULL || soa->_breakMin == NULL || 
+    soa->_breakMax == NULL || soa->_force == NULL || 
+    !SpringSysSoASortSprings(soa)) {
+    // Free memory, the SpringSys stays packed but not compiled
+    free(soa->_rowStart);
+    free(soa->_breakMin);
+    free(soa->_breakMax);
+    free(soa->_force);
+    soa->_rowStart = NULL;
+    soa->_breakMin = NULL;
+    soa->_breakMax = NULL;
+    soa->_force = NULL;
+    // Return false
+    return false;
+  }
+  // Precompute the limits of stress
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring)
+    SpringSysSoAReadSpring(soa, iSpring);
+  // Return true
+  return true;
+}
+
+// Return true if the SpringSys is compiled (cf SpringSysCompile), 
+// else false
+bool SpringSysIsCompiled(SpringSys *sys) {
+  return (sys != NULL && sys->_soa != NULL && 
+    sys->_soa->_breakMin != NULL);
+}
+
+// Set the kernel applying the forces of springs when the SpringSys is
+// compiled to 'kernel'
+// Return false if arguments are invalid or the kernel is not supported
+// by the CPU, else return true
+bool SpringSysSetKernel(SpringSys *sys, SpringSysKernel kernel) {
+  // Check arguments
+  if (sys == NULL || !SpringSysKernelIsSupported(kernel))
+    return false;
+  // Set the kernel
+  sys->_kernel = kernel;
+  // Return true
+  return true;
+}
+
+// Set the number of threads used to step the SpringSys when it is 
+// compiled to 'nbThread'
+// Do nothing if arguments are invalid
+void SpringSysSetNbThread(SpringSys *sys, int nbThread) {
+  // Check arguments
+  if (sys == NULL || nbThread < 1)
+    return;
+  // If the number of threads changes
+  if (nbThread != sys->_nbThread) {
+    // Stop the current threads, the new ones are created at the next 
+    // step
+    SpringSysThreadPoolFree(&(sys->_threadPool));
+    // Set the number of threads
+    sys->_nbThread = nbThread;
+  }
+}
+
+// Set the scheme integrating the motion of masses of the SpringSys to
+// 'integrator'
+// Do nothing if arguments are invalid
+void SpringSysSetIntegrator(SpringSys *sys, 
+  SpringSysIntegrator integrator) {
+  // Check arguments
+  if (sys == NULL || integrator < springSysIntegratorEuler || 
+    integrator > springSysIntegratorImplicit)
+    return;
+  // Set the integrator
+  sys->_integrator = integrator;
+}
+
+// Set the tolerance on the relative residual of the linear solver of 
+// the implicit integrator to 'tol' and its maximum number of 
+// iterations per step to 'maxIter'
+// Do nothing if arguments are invalid
+void SpringSysSetImplicitSolver(SpringSys *sys, float tol, 
+  int maxIter) {
+  // Check arguments
+  if (sys == NULL || tol < 0.0 || maxIter < 1)
+    return;
+  // Set the parameters of the solver
+  sys->_solverTol = tol;
+  sys->_solverMaxIter = maxIter;
+}
+
+// Set the tolerance on the local error of the steps of 
+// SpringSysStepToRest to 'tol', 0.0 for fixed steps
+// Do nothing if arguments are invalid
+void SpringSysSetAdaptiveStep(SpringSys *sys, float tol) {
+  // Check arguments
+  if (sys == NULL || tol < 0.0)
+    return;
+  // Set the tolerance
+  sys->_adaptTol = tol;
+}
+
+// Set the number of steps between two checks of the equilibrium in 
+// SpringSysStepToRest to 'period'
+// Do nothing if arguments are invalid
+void SpringSysSetRestCheckPeriod(SpringSys *sys, int period) {
+  // Check arguments
+  if (sys == NULL || period < 1)
+    return;
+  // Set the period
+  sys->_restCheckPeriod = period;
+}
+
+// Set the thresholds under which the islands of the SpringSys fall 
+// asleep to 'momentum' and 'force', 0.0 to keep them awake
+// Do nothing if arguments are invalid
+void SpringSysSetSleep(SpringSys *sys, float momentum, float force) {
+  // Check arguments
+  if (sys == NULL || momentum < 0.0 || force < 0.0)
+    return;
+  // Islands sleep only if both thresholds are set, if they don't they
+  // are woken up at the next step
+  if (momentum == 0.0 || force == 0.0) {
+    momentum = 0.0;
+    force = 0.0;
+  }
+  // Set the thresholds
+  sys->_sleepMomentum = momentum;
+  sys->_sleepForce = force;
+}
+
+// Set the radius of the masses of the SpringSys to 'radius', the 
+// stiffness of their contacts to 'k', and the size of the cells of the
+// spatial hash searching the contacts to 'cell' (0.0 for twice 
+// 'radius'), 'radius' equal to 0.0 disables the collisions. Two masses
+// not connected by a spring are in contact when they are closer than 
+// twice 'radius', then each is pushed away from the other by a force 
+// equal to 'k' times the overlap, added to the forces of springs 
+// before the masses are moved. Collisions run on the compiled snapshot
+// (on its threads, cf SpringSysSetNbThread), SpringSysStep compiles 
+// the SpringSys if necessary (cf SpringSysCompile for the access to 
+// masses and springs), and islands are not used while masses collide
+// (cf SpringSysSetSleep). The number of contacts during the last 
+// evaluation of forces is available in _nbContact.
+// Do nothing if arguments are invalid
+void SpringSysSetCollision(SpringSys *sys, float radius, float k, 
+  float cell) {
+  // Check arguments
+  if (sys == NULL || !(radius >= 0.0) || !(k >= 0.0) || 
+    !(cell >= 0.0))
+    return;
+  // Set the collisions
+  sys->_collideRadius = radius;
+  sys->_collideK = k;
+  sys->_collideCell = cell;
+  sys->_nbContact = 0;
+}
+
+// Return true if the kernel 'kernel' is supported by the CPU, else 
+// false
+bool SpringSysKernelIsSupported(SpringSysKernel kernel) {
+  switch (kernel) {
+    case springSysKernelScalar:
+      return true;
+#ifdef SPRINGSYS_X86_KERNEL
+    case springSysKernelAVX2:
+      return (__builtin_cpu_supports("avx2") && 
+        __builtin_cpu_supports("fma"));
+    case springSysKernelAVX512:
+      return (__builtin_cpu_supports("avx512f") != 0);
+#endif
+    default:
+      return false;
+  }
+}
+
+// Get the packed arrays of masses and springs of the SpringSys for 
+// bulk reading
+// Return NULL if arguments are invalid, the backend is not 
+// springSysBackendSoA or memory allocation failed
+const SpringSysSoA* SpringSysGetSoA(SpringSys *sys) {
+  // Check arguments
+  if (sys == NULL || sys->_backend != springSysBackendSoA)
+    return NULL;
+  // Make sure the packed arrays are up to date
+  if (!SpringSysSoAPrepare(sys))
+    return NULL;
+  // Return the packed arrays
+  return sys->_soa;
+}
+
+// Copy into 'ruptures' the 'nb' oldest ruptures of springs of the 
+// SpringSys not drained yet (or all of them if there are less) and 
+// remove them from its events. Springs breaking during a step are 
+// removed from _springs in one pass at the end of the force pass, and
+// their ruptures are recorded in the order of the steps, with the id
+// of the spring and its stress when it broke, whatever the backend, 
+// integrator and number of threads. Events accumulate until they are
+// drained, _nbRupture is their number and _nbRuptureLost the number 
+// of events lost because memory couldn't be allocated.
+// Return the number of ruptures copied, 0 if arguments are invalid
+int SpringSysDrainRuptures(SpringSys *sys, SpringSysRupture *ruptures,
+  int nb) {
+  // Check arguments
+  if (sys == NULL || ruptures == NULL || nb < 0)
+    return 0;
+  // Copy the oldest events
+  if (nb > sys->_nbRupture)
+    nb = sys->_nbRupture;
+  if (nb > 0)
+    memcpy(ruptures, sys->_rupture + sys->_ruptureFirst, 
+      sizeof(SpringSysRupture) * nb);
+  // Remove them from the events
+  sys->_ruptureFirst += nb;
+  sys->_nbRupture -= nb;
+  if (sys->_nbRupture == 0)
+    sys->_ruptureFirst = 0;
+  // Return the number of events copied
+  return nb;
+}
+
 // Get the mass identified by 'id'
 // Return NULL if arguments are invalid or if there is no mass 
 // with this id
@@ -505,25 +2469,19 @@ SpringSysMass* SpringSysGetMass(SpringSys *sys, int id) {
   // Check arguments
   if (sys == NULL)
     return NULL;
-  // Declare a pointer to memorize the searched mass
-  SpringSysMass *ret = NULL;
-  // Get a pointer to the first element in list of masses
-  GSetElem *m = sys->_masses->_head;
-  // While we are not at the end of the list
-  while (m != NULL) {
-    // If the current mass is the searched mass
-    if (((SpringSysMass*)(m->_data))->_id == id) {
-      // Update the result pointer
-      ret = (SpringSysMass*)(m->_data);
-      // Set the pointer to element to null to end the loop
-      m = NULL;
-    // Else, the current ass is not the searched mass
-    } else
-      // Move to the next element
-      m = m->_next;
-  }
-  // Return the result pointer
-  return ret;
+  // Get the entry of the mass in the index
+  SpringSysIndexEntry *entry = 
+    SpringSysIndexGetEntry(sys->_massIndex, id);
+  // If there is no mass with this id
+  if (entry == NULL)
+    // Return NULL
+    return NULL;
+  // If the SpringSys is packed
+  if (sys->_soa != NULL)
+    // Update the record of the mass
+    SpringSysSoAPullMass(sys, entry->_slot);
+  // Return the mass
+  return (SpringSysMass*)(entry->_elem);
 }
 
 // Get the spring identified by 'id'
@@ -533,6 +2491,21 @@ SpringSysSpring* SpringSysGetSpring(SpringSys *sys, int id) {
   // Check arguments
   if (sys == NULL || sys->_springs == NULL)
     return NULL;
+  // If the SpringSys is packed
+  if (sys->_soa != NULL) {
+    // Search the spring in the packed arrays
+    for (int iSpring = 0; iSpring < sys->_soa->_nbSpring; ++iSpring) {
+      // If it's the searched spring
+      if (sys->_soa->_springId[iSpring] == id) {
+        // Update the record of the spring
+        SpringSysSoAPullSpring(sys, iSpring);
+        // Return the spring
+        return sys->_soa->_springRec[iSpring];
+      }
+    }
+    // There is no spring with this id
+    return NULL;
+  }
   // Declare a pointer to memorize the searched spring
   SpringSysSpring *ret = NULL;
   // Get a pointer to the first element of the list of springs
@@ -552,7 +2525,7 @@ SpringSysSpring* SpringSysGetSpring(SpringSys *sys, int id) {
     }
   }
   // Return the result pointer
-  return ret;
+  return ret;  
 }
 
 // Get the number of mass in the SpringSys
@@ -575,6 +2548,50 @@ int SpringSysGetNbSpring(SpringSys *sys) {
   return sys->_springs->_nbElem;
 }
 
+// Get the number of springs connected to the mass identified by 'id'
+// Return -1 if arguments are invalid or if there is no mass with this 
+// id
+int SpringSysGetNbSpringOfMass(SpringSys *sys, int id) {
+  // Check arguments
+  if (sys == NULL)
+    return -1;
+  // Get the entry of the mass
+  SpringSysIndexEntry *entry = 
+    SpringSysIndexGetEntry(sys->_massIndex, id);
+  // Return the number of springs connected to the mass, or -1 if 
+  // there is no mass with this id
+  return (entry != NULL ? entry->_nbIncident : -1);
+}
+
+// Get the id of the 'iSpring'-th spring connected to the mass 
+// identified by 'id', 'iSpring' in [0, SpringSysGetNbSpringOfMass[
+// The order of the springs changes when springs connected to the mass
+// are added or removed
+// Return -1 if arguments are invalid or if there is no mass with this 
+// id
+int SpringSysGetSpringOfMass(SpringSys *sys, int id, int iSpring) {
+  // Get the spring
+  SpringSysSpring *s = SpringSysGetIncident(sys, id, iSpring);
+  // Return its id
+  return (s != NULL ? s->_id : -1);
+}
+
+// Get the id of the mass at the other extremity of the 'iSpring'-th 
+// spring connected to the mass identified by 'id' (cf 
+// SpringSysGetSpringOfMass)
+// Return -1 if arguments are invalid or if there is no mass with this 
+// id
+int SpringSysGetNeighborOfMass(SpringSys *sys, int id, int iSpring) {
+  // Get the spring
+  SpringSysSpring *s = SpringSysGetIncident(sys, id, iSpring);
+  // If there is no such spring
+  if (s == NULL)
+    // Return -1
+    return -1;
+  // Return the id of the mass at its other extremity
+  return (s->_mass[0] == id ? s->_mass[1] : s->_mass[0]);
+}
+
 // Add a copy of the mass 'm' to the SpringSys
 // If _data must be cloned it's up to the calling function
 // Return false if the arguments are invalid or memory allocation failed
@@ -584,23 +2601,13 @@ bool SpringSysAddMass(SpringSys *sys, SpringSysMass *m) {
   if (sys == NULL || m == NULL)
     return false;
   // If the mass properties are incorrect
-  if (m->_mass < 0.0)
-    // Return false
-    return false;
-  // Allocate memory for the new mass
-  SpringSysMass *mass = (SpringSysMass*)malloc(sizeof(SpringSysMass));
-  // If we could allocate memory
-  if (mass != NULL) {
-    // Copy the properties of the mass
-    memcpy(mass, m, sizeof(SpringSysMass));
-    // Add the mass
-    GSetAppend(sys->_masses, mass);
-  // Else, we couldn't allocate the memory
-  } else
+  if (!SpringSysIsValidMass(m))
     // Return false
     return false;
-  // Return true
-  return true;
+  // Release the packed arrays, the topology is modified
+  SpringSysSoAUnpack(sys);
+  // Add the mass
+  return SpringSysInsertMass(sys, m);
 }
 
 // Add a copy of the spring 's' to the SpringSys
@@ -611,98 +2618,417 @@ bool SpringSysAddSpring(SpringSys *sys, SpringSysSpring *s) {
   if (sys == NULL || s == NULL)
     return false;
   // If the spring properties are incorrect
-  if (s->_mass[0] == s->_mass[1] || s->_length < 0.0 || 
-    s->_k < 0.0 || s->_restLength < 0.0 ||
-    s->_maxStress[0] >= 0.0 || s->_maxStress[1] <= 0.0)
-    // Return false
-    return false;
-  SpringSysMass *m[2];
-  m[0] = SpringSysGetMass(sys, s->_mass[0]);
-  m[1] = SpringSysGetMass(sys, s->_mass[1]);
-  if (m[0] == NULL || m[1] == NULL)
-    // Return false
-    return false;
-  // Allocate memory for the new spring
-  SpringSysSpring *spring = 
-    (SpringSysSpring*)malloc(sizeof(SpringSysSpring));
-  // If we could allocate memory
-  if (spring != NULL) {
-    // Copy the properties of the spring
-    memcpy(spring, s, sizeof(SpringSysSpring));
-    // Add the spring to the list of springs
-    GSetAppend(sys->_springs, spring);
-  // Else, we couldn't allocate the memory
-  } else
+  if (!SpringSysIsValidSpring(sys, s))
     // Return false
     return false;
-  // Return true
-  return true;
+  // Release the packed arrays, the topology is modified
+  SpringSysSoAUnpack(sys);
+  // Add the spring
+  return SpringSysInsertSpring(sys, s);
 }
 
-// Remove the mass identified by 'id'
-// Springs connected to this mass are removed as well
-// Do nothing if arguments are invalids
-void SpringSysRemoveMass(SpringSys *sys, int id) {
+// Add a copy of the 'nb' masses of the array 'masses' to the SpringSys,
+// in the order of the array, until the end of the array or the first
+// mass which couldn't be added (invalid properties or memory 
+// allocation failure)
+// If _data must be cloned it's up to the calling function
+// Return the number of masses added, or -1 if arguments are invalid
+int SpringSysAddMasses(SpringSys *sys, const SpringSysMass *masses, 
+  int nb) {
   // Check arguments
-  if (sys == NULL)
-    return;
-  // Get a pointer to the first element in the list of mass
-  GSetElem *e = sys->_masses->_head;
-  // While we are not at the end of the list
-  while (e != NULL) {
-    // Get a pointer to the mass
-    SpringSysMass *m = (SpringSysMass*)(e->_data);
-    // Move to next mass
-    e = e->_next;
-    // If the pointer is not null and this is the searched mass
-    if (m != NULL && m->_id == id) {
-      // Remove the element
-      GSetRemoveFirst(sys->_masses, m);
-      // Free memory used by the mass
-      SpringSysMassFree(&m);
-    }
-  }
-  // Get a pointer to the first element in the list of spring
-  e = sys->_springs->_head;
-  // While we are not at the end of the list
-  while (e != NULL) {
-    // Get a pointer to the spring
-    SpringSysSpring *s = (SpringSysSpring*)(e->_data);
-    // Move to next spring
-    e = e->_next;
-    // If the pointer is not null and this is a spring connected to 
-    // the searched mass
-    if (s != NULL && (s->_mass[0] == id || s->_mass[1] == id)) {
-      // Remove the element
-      GSetRemoveFirst(sys->_springs, s);
-      // Free memory used by the spring
-      SpringSysSpringFree(&s);
+  if (sys == NULL || masses == NULL || nb < 0)
+    return -1;
+  // Release the packed arrays, the topology is modified
+  SpringSysSoAUnpack(sys);
+  // Make room in the index and the pool for all the masses at once
+  SpringSysIndexReserve(sys->_massIndex, nb);
+  SpringSysPoolReserve(&(sys->_massPool), nb);
+  // Add the masses until one can't be added
+  int iMass = 0;
+  while (iMass < nb && SpringSysIsValidMass(masses + iMass) &&
+    SpringSysInsertMass(sys, masses + iMass))
+    ++iMass;
+  // Return the number of masses added
+  return iMass;
+}
+
+// Add a copy of the 'nb' springs of the array 'springs' to the 
+// SpringSys, in the order of the array, until the end of the array or
+// the first spring which couldn't be added (invalid properties, 
+// missing mass or memory allocation failure)
+// Return the number of springs added, or -1 if arguments are invalid
+int SpringSysAddSprings(SpringSys *sys, const SpringSysSpring *springs,
+  int nb) {
+  // Check arguments
+  if (sys == NULL || springs == NULL || nb < 0)
+    return -1;
+  // Release the packed arrays, the topology is modified
+  SpringSysSoAUnpack(sys);
+  // Make room in the pool for all the springs at once
+  SpringSysPoolReserve(&(sys->_springPool), nb);
+  // Add the springs until one can't be added
+  int iSpring = 0;
+  while (iSpring < nb && SpringSysIsValidSpring(sys, springs + iSpring) &&
+    SpringSysInsertSpring(sys, springs + iSpring))
+    ++iSpring;
+  // Return the number of springs added
+  return iSpring;
+}
+
+// Add to the SpringSys a lattice of 'size[0]' x ... x 
+// 'size[nbDim - 1]' masses, linked by springs according to 'lattice'
+// (cf SpringSysLattice)
+// The masses are copies of 'mass', positioned from mass->_pos by steps
+// of 'spacing' along each axis, with ids consecutive from mass->_id 
+// (the index along the first axis varying fastest)
+// The springs are copies of 'spring' whose length and length at rest
+// are the distance between their masses, with ids consecutive from 
+// spring->_id
+// If the lattice couldn't be added entirely, the masses and springs 
+// added before the failure are left in the SpringSys
+// Return false if arguments are invalid or memory allocation failed, 
+// else return true
+bool SpringSysAddLattice(SpringSys *sys, SpringSysLattice lattice, 
+  const int *size, float spacing, const SpringSysMass *mass, 
+  const SpringSysSpring *spring) {
+  // Check arguments
+  if (sys == NULL || size == NULL || mass == NULL || spring == NULL ||
+    spacing <= 0.0 || !SpringSysIsValidMass(mass))
+    return false;
+  int nbDim = sys->_nbDim;
+  // Get the number of masses and the offset of the id of masses along
+  // each axis
+  int nbMass = 1;
+  int stride[3] = {0};
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    if (size[iDim] <= 0)
+      return false;
+    stride[iDim] = nbMass;
+    nbMass *= size[iDim];
+  }
+  // Get the offsets (in number of masses along each axis) between the 
+  // masses linked by springs: the neighbours in the 3^nbDim stencil 
+  // around a mass whose first non null offset is positive, restricted 
+  // to the axis for cubic lattices and to offsets in {0, 1} for 
+  // triangle lattices
+  int nbLink = 0;
+  int link[13][3];
+  for (int iLink = 0; iLink < 27; ++iLink) {
+    int offset[3] = {iLink % 3 - 1, (iLink / 3) % 3 - 1, iLink / 9 - 1};
+    bool valid = true;
+    int first = 0;
+    int nbNotNull = 0;
+    for (int iDim = 0; iDim < 3; ++iDim) {
+      if (iDim >= nbDim && offset[iDim] != 0)
+        valid = false;
+      if (offset[iDim] != 0) {
+        if (nbNotNull == 0)
+          first = offset[iDim];
+        ++nbNotNull;
+        if (lattice == springSysLatticeTriangle && offset[iDim] < 0)
+          valid = false;
+      }
     }
+    if (nbNotNull == 0 || first < 0 ||
+      (lattice == springSysLatticeCubic && nbNotNull > 1))
+      valid = false;
+    if (valid) {
+      memcpy(link[nbLink], offset, sizeof(offset));
+      ++nbLink;
+    }
+  }
+  // Release the packed arrays, the topology is modified
+  SpringSysSoAUnpack(sys);
+  // Make room in the index and the pools for all the masses and 
+  // springs at once (at most nbLink springs per mass)
+  SpringSysIndexReserve(sys->_massIndex, nbMass);
+  SpringSysPoolReserve(&(sys->_massPool), nbMass);
+  SpringSysPoolReserve(&(sys->_springPool), nbMass * nbLink);
+  // Add the masses
+  SpringSysMass m = *mass;
+  for (int iMass = 0; iMass < nbMass; ++iMass) {
+    m._id = mass->_id + iMass;
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      m._pos[iDim] = mass->_pos[iDim] + 
+        spacing * (float)((iMass / stride[iDim]) % size[iDim]);
+    if (!SpringSysInsertMass(sys, &m))
+      return false;
+  }
+  // Add the springs from each mass to its neighbours
+  SpringSysSpring s = *spring;
+  for (int iMass = 0; iMass < nbMass; ++iMass) {
+    for (int iLink = 0; iLink < nbLink; ++iLink) {
+      // Get the neighbour, skipping it if it's outside the lattice
+      int jMass = iMass;
+      int sqLength = 0;
+      bool inside = true;
+      for (int iDim = 0; iDim < nbDim; ++iDim) {
+        int pos = (iMass / stride[iDim]) % size[iDim] + link[iLink][iDim];
+        if (pos < 0 || pos >= size[iDim])
+          inside = false;
+        jMass += link[iLink][iDim] * stride[iDim];
+        sqLength += link[iLink][iDim] * link[iLink][iDim];
+      }
+      if (!inside)
+        continue;
+      // Add the spring
+      s._mass[0] = mass->_id + iMass;
+      s._mass[1] = mass->_id + jMass;
+      s._length = s._restLength = spacing * sqrt((float)sqLength);
+      if (!SpringSysIsValidSpring(sys, &s) || 
+        !SpringSysInsertSpring(sys, &s))
+        return false;
+      ++(s._id);
+    }
+  }
+  // Return true
+  return true;
+}
+
+// Preallocate the memory for the SpringSys to hold 'nbMass' masses and
+// 'nbSpring' springs without further allocation of their records
+// The records of masses and springs are allocated by slabs, reused 
+// when masses and springs are removed or break, and released all at 
+// once by SpringSysFree
+// Return false if arguments are invalid or memory allocation failed, 
+// else return true
+bool SpringSysReserve(SpringSys *sys, int nbMass, int nbSpring) {
+  // Check arguments
+  if (sys == NULL || nbMass < 0 || nbSpring < 0)
+    return false;
+  // Get the number of masses and springs to come
+  nbMass -= sys->_masses->_nbElem;
+  nbSpring -= sys->_springs->_nbElem;
+  if (nbMass < 0)
+    nbMass = 0;
+  if (nbSpring < 0)
+    nbSpring = 0;
+  // Make room for them in the pools and the index
+  return SpringSysPoolReserve(&(sys->_massPool), nbMass) &&
+    SpringSysPoolReserve(&(sys->_springPool), nbSpring) &&
+    SpringSysIndexReserve(sys->_massIndex, nbMass);
+}
+
+// Return true if the properties of the mass 'm' are valid, else false
+static bool SpringSysIsValidMass(const SpringSysMass *m) {
+  return (m->_mass >= 0.0);
+}
+
+// Return true if the properties of the spring 's' are valid and its 
+// masses exist in the SpringSys 'sys', else false
+static bool SpringSysIsValidSpring(SpringSys *sys, 
+  const SpringSysSpring *s) {
+  return (s->_mass[0] != s->_mass[1] && s->_length >= 0.0 && 
+    s->_k >= 0.0 && s->_restLength >= 0.0 &&
+    s->_maxStress[0] < 0.0 && s->_maxStress[1] > 0.0 &&
+    SpringSysIndexGet(sys->_massIndex, s->_mass[0]) != NULL &&
+    SpringSysIndexGet(sys->_massIndex, s->_mass[1]) != NULL);
+}
+
+// Add a copy of the valid mass 'm' to the unpacked SpringSys 'sys'
+// Return false if memory allocation failed, else return true
+static bool SpringSysInsertMass(SpringSys *sys, const SpringSysMass *m) {
+  // The topology is modified
+  SpringSysTopologyModified(sys);
+  // Get a record for the new mass
+  SpringSysMass *mass = 
+    (SpringSysMass*)SpringSysPoolAlloc(&(sys->_massPool));
+  // If we couldn't allocate memory
+  if (mass == NULL)
+    // Return false
+    return false;
+  // Copy the properties of the mass
+  memcpy(mass, m, sizeof(SpringSysMass));
+  // Memorize if there is already a mass with the same id
+  bool isIndexed = (SpringSysIndexGet(sys->_massIndex, m->_id) != NULL);
+  // Add the mass to the index
+  if (!SpringSysIndexAdd(sys->_massIndex, mass->_id, mass)) {
+    // Free memory
+    SpringSysPoolRelease(&(sys->_massPool), mass);
+    // Return false
+    return false;
+  }
+  // Add the mass
+  int nbMass = sys->_masses->_nbElem;
+  GSetAppend(sys->_masses, mass);
+  // If we couldn't append the mass
+  if (nbMass + 1 != sys->_masses->_nbElem) {
+    // Remove the mass from the index if it has been added
+    if (isIndexed == false)
+      SpringSysIndexRemove(sys->_massIndex, mass->_id);
+    // Free memory
+    SpringSysPoolRelease(&(sys->_massPool), mass);
+    // Return false
+    return false;
+  }
+  // Return true
+  return true;
+}
+
+// Add a copy of the valid spring 's' to the unpacked SpringSys 'sys'
+// Return false if memory allocation failed, else return true
+static bool SpringSysInsertSpring(SpringSys *sys, 
+  const SpringSysSpring *s) {
+  // The topology is modified
+  SpringSysTopologyModified(sys);
+  // Get a record for the new spring
+  SpringSysSpring *spring = 
+    (SpringSysSpring*)SpringSysPoolAlloc(&(sys->_springPool));
+  // If we couldn't allocate memory
+  if (spring == NULL)
+    // Return false
+    return false;
+  // Copy the properties of the spring
+  memcpy(spring, s, sizeof(SpringSysSpring));
+  // Connect the spring to its masses
+  if (!SpringSysAttachSpring(sys, spring)) {
+    // Free memory
+    SpringSysPoolRelease(&(sys->_springPool), spring);
+    // Return false
+    return false;
+  }
+  // Add the spring to the list of springs
+  int nbSpring = sys->_springs->_nbElem;
+  GSetAppend(sys->_springs, spring);
+  // If we couldn't append the spring
+  if (nbSpring + 1 != sys->_springs->_nbElem) {
+    // Disconnect the spring from its masses
+    SpringSysDetachSpring(sys, spring);
+    // Free memory
+    SpringSysPoolRelease(&(sys->_springPool), spring);
+    // Return false
+    return false;
   }
+  // Return true
+  return true;
+}
+
+// Remove the mass identified by 'id'
+// Springs connected to this mass are removed as well
+// Do nothing if arguments are invalids
+void SpringSysRemoveMass(SpringSys *sys, int id) {
+  // Remove the mass as a batch of one mass
+  SpringSysRemoveMasses(sys, &id, 1);
 }
 
 // Remove spring idenitfied by 'id'
 // Do nothing if argument are invalids
 void SpringSysRemoveSpring(SpringSys *sys, int id) {
+  // Remove the spring as a batch of one spring
+  SpringSysRemoveSprings(sys, &id, 1);
+}
+
+// Remove the 'nb' masses identified by the ids in 'ids' and the 
+// springs connected to them
+// The sets of masses and springs are updated once for all the masses,
+// hence removing many masses is faster with this function than with 
+// SpringSysRemoveMass
+// Do nothing if arguments are invalids
+void SpringSysRemoveMasses(SpringSys *sys, const int *ids, int nb) {
   // Check arguments
-  if (sys == NULL)
+  if (sys == NULL || ids == NULL || nb <= 0)
+    return;
+  // Sort a copy of the ids to search them
+  int *sorted = (int*)malloc(sizeof(int) * nb);
+  if (sorted == NULL)
+    return;
+  memcpy(sorted, ids, sizeof(int) * nb);
+  qsort(sorted, nb, sizeof(int), SpringSysCompareInt);
+  // Release the packed arrays, the topology is modified
+  SpringSysSoAUnpack(sys);
+  // For each mass, ignoring repeated ids
+  for (int i = 0; i < nb; ++i) {
+    if (i > 0 && sorted[i] == sorted[i - 1])
+      continue;
+    // Get the entry of the mass
+    SpringSysIndexEntry *entry = 
+      SpringSysIndexGetEntry(sys->_massIndex, sorted[i]);
+    if (entry == NULL)
+      continue;
+    // Take the springs connected to the mass and tombstone them, which
+    // disconnects them from the mass at their other extremity
+    SpringSysSpring **incident = entry->_incident;
+    int nbIncident = entry->_nbIncident;
+    entry->_incident = NULL;
+    entry->_nbIncident = 0;
+    entry->_incidentSize = 0;
+    for (int iSpring = 0; iSpring < nbIncident; ++iSpring)
+      SpringSysTombstoneSpring(sys, incident[iSpring]);
+    free(incident);
+    // Remove the mass from the index
+    SpringSysIndexRemove(sys->_massIndex, sorted[i]);
+  }
+  // Remove the springs connected to the masses
+  SpringSysRemoveTombstones(sys);
+  // The topology is modified
+  SpringSysTopologyModified(sys);
+  // If there are many masses, copy the masses which are not removed 
+  // into a new set
+  GSet *masses = NULL;
+  if (nb >= SPRINGSYS_REBUILD_MINREMOVE)
+    masses = GSetCreate();
+  // If we could create the set
+  if (masses != NULL) {
+    for (GSetElem *e = sys->_masses->_head; e != NULL; e = e->_next) {
+      SpringSysMass *m = (SpringSysMass*)(e->_data);
+      if (m != NULL && bsearch(&(m->_id), sorted, nb, sizeof(int), 
+        SpringSysCompareInt) != NULL)
+        SpringSysPoolRelease(&(sys->_massPool), m);
+      else
+        GSetAppend(masses, e->_data);
+    }
+    // Replace the set of masses
+    GSetFree(&(sys->_masses));
+    sys->_masses = masses;
+  // Else, remove the masses one by one
+  } else {
+    GSetElem *e = sys->_masses->_head;
+    while (e != NULL) {
+      SpringSysMass *m = (SpringSysMass*)(e->_data);
+      e = e->_next;
+      if (m != NULL && bsearch(&(m->_id), sorted, nb, sizeof(int), 
+        SpringSysCompareInt) != NULL) {
+        GSetRemoveFirst(sys->_masses, m);
+        SpringSysPoolRelease(&(sys->_massPool), m);
+      }
+    }
+  }
+  // Free memory
+  free(sorted);
+}
+
+// Remove the 'nb' springs identified by the ids in 'ids'
+// The set of springs is updated once for all the springs, hence 
+// removing many springs is faster with this function than with 
+// SpringSysRemoveSpring
+// Do nothing if arguments are invalids
+void SpringSysRemoveSprings(SpringSys *sys, const int *ids, int nb) {
+  // Check arguments
+  if (sys == NULL || ids == NULL || nb <= 0)
     return;
-  // Get a pointer to the first element in the list of spring
+  // Sort a copy of the ids to search them
+  int *sorted = (int*)malloc(sizeof(int) * nb);
+  if (sorted == NULL)
+    return;
+  memcpy(sorted, ids, sizeof(int) * nb);
+  qsort(sorted, nb, sizeof(int), SpringSysCompareInt);
+  // Release the packed arrays, the topology is modified
+  SpringSysSoAUnpack(sys);
+  // Tombstone the springs to remove
   GSetElem *e = sys->_springs->_head;
-  // While we are not at the end of the list
   while (e != NULL) {
-    // Get a pointer to the spring
     SpringSysSpring *s = (SpringSysSpring*)(e->_data);
-    // Move to next spring
+    // Move to the next spring now, the current element is freed if 
+    // the spring can't be tombstoned
     e = e->_next;
-    // If the pointer is not null and this is the searched spring
-    if (s != NULL && s->_id == id) {
-      // Remove the element
-      GSetRemoveFirst(sys->_springs, s);
-      // Free memory used by the spring
-      SpringSysSpringFree(&s);
-    }
+    if (s != NULL && bsearch(&(s->_id), sorted, nb, sizeof(int), 
+      SpringSysCompareInt) != NULL)
+      SpringSysTombstoneSpring(sys, s);
   }
+  // Remove them
+  SpringSysRemoveTombstones(sys);
+  // Free memory
+  free(sorted);
 }
 
 // Step in time by 'dt' the SpringSys
@@ -712,6 +3038,36 @@ void SpringSysStep(SpringSys *sys, float dt) {
   if (sys == NULL || dt <= 0.0 || sys->_masses == NULL || 
     sys->_springs == NULL)
     return;
+  // The observables are calculated again by the step if it can
+  sys->_statsValid = false;
+  // If the SpringSys is compiled, or must be for its integrator, its
+  // sleeping islands or the collisions of its masses and could be
+  if (SpringSysIsCompiled(sys) || 
+    ((sys->_integrator != springSysIntegratorEuler || 
+    sys->_sleepMomentum > 0.0 || sys->_collideRadius > 0.0) && 
+    SpringSysCompile(sys))) {
+    // Copy the records handed out into the packed arrays
+    SpringSysSoAPush(sys);
+    // Step on the compiled snapshot
+    SpringSysStepCompiled(sys, dt);
+  // Else, if the SpringSys uses the packed arrays and they are ready
+  } else if (sys->_backend == springSysBackendSoA && 
+    SpringSysSoAPrepare(sys)) {
+    // Step on the packed arrays, the structures searching masses and 
+    // springs by position won't match the positions anymore
+    SpringSysSoAMoved(sys->_soa);
+    sys->_dimKernels->_stepSoA(sys, dt);
+  // Else, the SpringSys uses the GSets or couldn't be packed
+  } else {
+    // Step on the GSets
+    SpringSysStepGSet(sys, dt);
+  }
+}
+
+// Step in time by 'dt' the SpringSys 'sys' on its GSets
+static void SpringSysStepGSet(SpringSys *sys, float dt) {
+  // Declare a variable to memorize the observables of the step
+  SpringSysStats stats = {0};
   // Reset the stress for each unfixed mass
   // Get a pointer to the first element in the list of mass
   GSetElem *e = sys->_masses->_head;
@@ -733,10 +3089,11 @@ void SpringSysStep(SpringSys *sys, float dt) {
   while (e != NULL) {
     // Get a pointer to the spring
     SpringSysSpring *s = (SpringSysSpring*)(e->_data);
+    // Move to the next spring now, the current element is freed if the
+    // spring breaks
+    e = e->_next;
     // If the pointer is not null
     if (s != NULL) {
-      // Declare a variable to memorize if there has been a rupture
-      bool flagRupture = false;
       // Get the two masses at extremities of the spring
       SpringSysMass* m[2];
       m[0] = SpringSysGetMass(sys, s->_mass[0]);
@@ -754,13 +3111,12 @@ void SpringSysStep(SpringSys *sys, float dt) {
         if (s->_breakable == true &&
           ((s->_stress > 0.0 && s->_stress >= s->_maxStress[1]) ||
           (s->_stress < 0.0 && s->_stress <= s->_maxStress[0]))) {
-          // Memorize there has been a rupture
-          flagRupture = true;
-          // Remove this spring from the sets of spring
-          GSetRemoveFirst(sys->_springs, s);
-          // Free memory for the spring
-          SpringSysSpringFree(&s);
+          // Record its rupture and tombstone it, it's removed from the
+          // set of springs after the loop
+          SpringSysBreakSpring(sys, s, s->_stress);
         } else {
+          // Add the stress to the observables
+          stats._stress += fabs(s->_stress);
           // Update the stress to the masses which are not fixed
           for (int iDim = 0; iDim < sys->_nbDim; ++iDim) {
             for (int iMass = 0; iMass < 2; ++iMass) {
@@ -772,39 +3128,52 @@ void SpringSysStep(SpringSys *sys, float dt) {
           }
         }
       }
-      // If there has been no rupture
-      if (flagRupture == false) {
-        // Move to the next spring
-        e = e->_next;
-      }
-      // Else, the pointer is yet on the following element
-    // Else, the pointer to the spring is null
-    } else {
-      // Move to the next element in list
-      e = e->_next;
     }
   }
+  // Remove the springs broken during the loop from the set of springs
+  SpringSysRemoveTombstones(sys);
   // Apply speed to masses which are not fixed
+  // Get the dissipation over the step
+  double dissip = pow(1.0 - sys->_dissip, dt);
   // Get a pointer to the first element of the list of mass
   e = sys->_masses->_head;
   // While we are not at the end of the list
   while (e != NULL) {
     // Get a pointer to the mass
     SpringSysMass *m = (SpringSysMass*)(e->_data);
-    // If the pointer is not null and the mass is not fixed
-    if (m != NULL && m->_fixed == false)
-      // For each dimension
-      for (int iDim = 0; iDim < sys->_nbDim; ++iDim) {
-        // Apply the dissipation to the speed
-        m->_speed[iDim] *= pow(1.0 - sys->_dissip, dt);
-        // Apply the stress to the speed
-        m->_speed[iDim] += m->_stress[iDim] * dt;
-        // Apply the speed to the position
-        m->_pos[iDim] += m->_speed[iDim] * dt;
+    // If the pointer is not null
+    if (m != NULL) {
+      // If the mass is not fixed
+      if (m->_fixed == false) {
+        float f = 0.0;
+        // For each dimension
+        for (int iDim = 0; iDim < sys->_nbDim; ++iDim) {
+          // Apply the dissipation to the speed
+          m->_speed[iDim] *= dissip;
+          // Apply the stress to the speed
+          m->_speed[iDim] += m->_stress[iDim] * dt;
+          // Apply the speed to the position
+          m->_pos[iDim] += m->_speed[iDim] * dt;
+          f += m->_stress[iDim] * m->_stress[iDim];
+        }
+        // Update the highest force
+        f = sqrt(f) * (1.0 + m->_mass);
+        if (f > stats._maxForce)
+          stats._maxForce = f;
       }
+      // Add the momentum and kinetic energy of the mass
+      float v = 0.0;
+      for (int iDim = 0; iDim < sys->_nbDim; ++iDim)
+        v += m->_speed[iDim] * m->_speed[iDim];
+      stats._momentum += sqrt(v);
+      stats._kineticEnergy += 0.5 * v * (1.0 + m->_mass);
+    }
     // Move to next mass
     e = e->_next;
   }
+  // Memorize the observables of the step
+  sys->_stats = stats;
+  sys->_statsValid = true;
 }
 
 // Step in time by 'dt' the SpringSys until it is in equilibrium 
@@ -817,33 +3186,239 @@ float SpringSysStepToRest(SpringSys *sys, float dt, float tMax) {
   float t = tMax + dt; 
   // If arguments are valid
   if (sys != NULL && dt > 0.0 && tMax > dt) {
+    // Reset the statistics of adaptive steps, 'dt' is the first one
+    sys->_nbStepAccepted = 0;
+    sys->_nbStepRejected = 0;
+    sys->_adaptDt = dt;
     // Declare a variable to memorize the momentum of the system
     float m = 0.0;
     // Declare variables to memorize the stress of the system at current
-    // step and previous step
+    // check and previous check
     float s = 0.0;
     float sp = 0.0;
+    // Declare variables to memorize the number of steps and if the 
+    // equilibrium has been reached
+    int nbStep = 0;
+    bool rest = false;
     // Loop until the momentum is null and the stress stops varying or 
     // tMax is reached
     t = 0.0;
     do {
-      // Update current stress
-      s = sp;
-      // Step the SpringSys
-      SpringSysStep(sys, dt);
-      // Get the momentum
-      m = SpringSysGetMomentum(sys);
-      // Get the stress
-      sp = SpringSysGetStress(sys);
+      // Declare a variable to memorize the length of the step
+      float h = 0.0;
+      // If the SpringSys uses adaptive steps and can be compiled
+      if (sys->_adaptTol > 0.0 && sys->_masses != NULL && 
+        (SpringSysIsCompiled(sys) || SpringSysCompile(sys))) {
+        // Copy the records handed out into the packed arrays
+        SpringSysSoAPush(sys);
+        // Step the SpringSys with an adaptive step
+        h = SpringSysStepAdaptive(sys, tMax - t + dt, sys->_adaptTol);
+      }
+      // If the step couldn't be adaptive
+      if (h <= 0.0) {
+        // Step the SpringSys by 'dt'
+        SpringSysStep(sys, dt);
+        h = dt;
+      }
       // Increment time
-      t += dt;
-    } while ((m > SPRINGSYS_EPSILON || 
-      fabs(sp - s) > SPRINGSYS_EPSILON) && t <= tMax);
+      t += h;
+      ++nbStep;
+      // If the equilibrium must be checked at this step
+      if (nbStep % sys->_restCheckPeriod == 0) {
+        // Get the momentum and stress calculated by the step
+        const SpringSysStats *stats = SpringSysGetStats(sys);
+        s = sp;
+        m = stats->_momentum;
+        sp = stats->_stress;
+        // Check the equilibrium
+        rest = !(m > SPRINGSYS_EPSILON || 
+          fabs(sp - s) > SPRINGSYS_EPSILON);
+      }
+    } while (rest == false && t <= tMax);
   }
   // Return the time
   return t;
 }
 
+// Step in time the SpringSys by 'tTarget' with adaptive steps whose 
+// local error is kept below 'tol'
+// Return false if arguments are invalid or the SpringSys couldn't be
+// compiled, else return true
+bool SpringSysAdvance(SpringSys *sys, float tTarget, float tol) {
+  // Check arguments
+  if (sys == NULL || tTarget <= 0.0 || tol <= 0.0 || 
+    sys->_masses == NULL || sys->_springs == NULL)
+    return false;
+  // Compile the SpringSys if necessary
+  if (!SpringSysIsCompiled(sys) && !SpringSysCompile(sys))
+    return false;
+  // Copy the records handed out into the packed arrays
+  SpringSysSoAPush(sys);
+  // Reset the statistics of adaptive steps
+  sys->_nbStepAccepted = 0;
+  sys->_nbStepRejected = 0;
+  // If there is no previous step, start with a single one
+  if (sys->_adaptDt <= 0.0)
+    sys->_adaptDt = tTarget;
+  // Loop until the target time is reached
+  float t = 0.0;
+  while (tTarget - t > SPRINGSYS_EPSILON * tTarget) {
+    // Step the SpringSys
+    float dt = SpringSysStepAdaptive(sys, tTarget - t, tol);
+    // If the step failed
+    if (dt <= 0.0) {
+      // Step with a fixed step for the remaining time
+      dt = tTarget - t;
+      SpringSysStepCompiled(sys, dt);
+    }
+    // Update the time
+    t += dt;
+  }
+  // Return true
+  return true;
+}
+
+// Move the masses of the SpringSys to the configuration of minimum 
+// energy of its springs, with the FIRE algorithm, until the norm of 
+// the force on each unfixed mass is below 'tol' or 'maxIter' 
+// iterations have been done
+// Return false if arguments are invalid, the SpringSys couldn't be 
+// compiled or the equilibrium hasn't been reached, else return true
+bool SpringSysSolveEquilibrium(SpringSys *sys, float tol, int maxIter,
+  int *nbIter, float *residual) {
+  // Check arguments
+  if (sys == NULL || tol <= 0.0 || maxIter < 1 || 
+    sys->_masses == NULL || sys->_springs == NULL)
+    return false;
+  // Compile the SpringSys if necessary
+  if (!SpringSysIsCompiled(sys) && !SpringSysCompile(sys))
+    return false;
+  // Copy the records handed out into the packed arrays
+  SpringSysSoAPush(sys);
+  SpringSysSoA *soa = sys->_soa;
+  int nbDim = sys->_nbDim;
+  // Get the largest step stable for the springs: the highest 
+  // frequency of the system is bounded by the highest sum of the K 
+  // coefficients of springs on a mass scaled by its inverse inertia 
+  // (Gershgorin bound on the stiffness)
+  float *stiff = SpringSysSoAGetIntegBuf(soa, soa->_nbMass);
+  if (stiff == NULL)
+    return false;
+  memset(stiff, 0, sizeof(float) * soa->_nbMass);
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+    stiff[soa->_springMass[2 * iSpring]] += 2.0 * soa->_k[iSpring];
+    stiff[soa->_springMass[2 * iSpring + 1]] += 
+      2.0 * soa->_k[iSpring];
+  }
+  float omega = 0.0;
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    if (soa->_fixed[iMass] == false && 
+      stiff[iMass] * soa->_invMass[iMass] > omega)
+      omega = stiff[iMass] * soa->_invMass[iMass];
+  omega = sqrt(omega);
+  float dtMax = (omega > SPRINGSYS_EPSILON ? 1.0 / omega : 1.0);
+  float dt = 0.1 * dtMax;
+  // The structures searching masses and springs by position won't 
+  // match the positions anymore
+  SpringSysSoAMoved(soa);
+  // The minimization starts at rest
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    if (soa->_fixed[iMass] == false)
+      for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i)
+        soa->_speed[i] = 0.0;
+  // Declare variables to memorize the mixing of speed and force, the 
+  // number of steps since the power was last negative, the iteration
+  // and the norm of the force
+  float alpha = SPRINGSYS_FIRE_ALPHA;
+  int nbPositive = 0;
+  int iIter = 0;
+  float normForce = 0.0;
+  // Loop until the equilibrium or the maximum number of iterations is
+  // reached
+  while (true) {
+    // Apply the forces of springs at the current positions
+    SpringSysApplyForces(sys, 0.0);
+    // Get the highest norm of the force on unfixed masses, the power 
+    // of the force and the norms of speed and force
+    normForce = 0.0;
+    double power = 0.0;
+    double sqSpeed = 0.0;
+    double sqForce = 0.0;
+    for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+      if (soa->_fixed[iMass] == false) {
+        float sq = 0.0;
+        for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i) {
+          sq += soa->_force[i] * soa->_force[i];
+          power += (double)soa->_force[i] * soa->_speed[i];
+          sqSpeed += (double)soa->_speed[i] * soa->_speed[i];
+        }
+        sqForce += sq;
+        if (sq > normForce)
+          normForce = sq;
+      }
+    }
+    normForce = sqrt(normForce);
+    // Stop if the equilibrium or the maximum number of iterations is 
+    // reached
+    if (normForce <= tol || iIter >= maxIter)
+      break;
+    ++iIter;
+    // If the masses move along the force
+    if (power > 0.0) {
+      // After a few steps, lengthen the step and reduce the mixing
+      ++nbPositive;
+      if (nbPositive > SPRINGSYS_FIRE_NMIN) {
+        dt *= SPRINGSYS_FIRE_FINC;
+        if (dt > dtMax)
+          dt = dtMax;
+        alpha *= SPRINGSYS_FIRE_FALPHA;
+      }
+    // Else, the masses went past the minimum
+    } else {
+      // Shorten the step, move back by half a step and stop the masses
+      nbPositive = 0;
+      dt *= SPRINGSYS_FIRE_FDEC;
+      alpha = SPRINGSYS_FIRE_ALPHA;
+      for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+        if (soa->_fixed[iMass] == false) {
+          for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i) {
+            soa->_pos[i] -= 0.5 * dt * soa->_speed[i];
+            soa->_speed[i] = 0.0;
+          }
+        }
+      }
+      sqSpeed = 0.0;
+    }
+    // Apply the force to the speed, mix the speed with the direction 
+    // of the force, and apply the speed to the position
+    float mix = (sqForce > 0.0 ? alpha * sqrt(sqSpeed / sqForce) : 0.0);
+    for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+      if (soa->_fixed[iMass] == false) {
+        for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i) {
+          soa->_speed[i] = (1.0 - alpha) * 
+            (soa->_speed[i] + dt * soa->_force[i] * 
+            soa->_invMass[iMass]) + mix * soa->_force[i];
+          soa->_pos[i] += dt * soa->_speed[i];
+        }
+      }
+    }
+  }
+  // The masses are at rest, their stress is the acceleration due to 
+  // the remaining force
+  SpringSysSoAUpdateStress(sys);
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    if (soa->_fixed[iMass] == false)
+      for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i)
+        soa->_speed[i] = 0.0;
+  // Memorize the number of iterations and the residual force
+  if (nbIter != NULL)
+    *nbIter = iIter;
+  if (residual != NULL)
+    *residual = normForce;
+  // Return true if the equilibrium has been reached
+  return (normForce <= tol);
+}
+
 // Get the momentum (sum of norm(v) of masses) of the SpringSys
 // Return 0.0 if the arguments are invalid
 float SpringSysGetMomentum(SpringSys *sys) {
@@ -852,6 +3427,13 @@ float SpringSysGetMomentum(SpringSys *sys) {
     return 0.0;
   // Declare a variable to memorize the sum
   float sum = 0.0;
+  // If the SpringSys is packed
+  if (sys->_soa != NULL) {
+    // Copy the records handed out into the packed arrays
+    SpringSysSoAPush(sys);
+    // Return the sum calculated on the packed arrays
+    return sys->_dimKernels->_momentum(sys->_soa);
+  }
   // Declare a pointer to the first element of the list of masses
   GSetElem *e = sys->_masses->_head;
   // While we are not at the end of the list
@@ -872,7 +3454,7 @@ float SpringSysGetMomentum(SpringSys *sys) {
     e = e->_next;
   }
   // Return the sum
-  return sum;
+  return sum;  
 }
 
 // Get the stress (sum of abs(stress) of springs) of the SpringSys
@@ -883,6 +3465,16 @@ float SpringSysGetStress(SpringSys *sys) {
     return 0.0;
   // Declare a variable to memorize the sum
   float sum = 0.0;
+  // If the SpringSys is packed
+  if (sys->_soa != NULL) {
+    // Copy the records handed out into the packed arrays
+    SpringSysSoAPush(sys);
+    // Calculate the sum on the packed arrays
+    for (int iSpring = 0; iSpring < sys->_soa->_nbSpring; ++iSpring)
+      sum += fabs(sys->_soa->_springStress[iSpring]);
+    // Return the sum
+    return sum;
+  }
   // Declare a pointer to the first element of the list of springs
   GSetElem *e = sys->_springs->_head;
   // While we are not at the end of the list
@@ -900,12 +3492,84 @@ float SpringSysGetStress(SpringSys *sys) {
   return sum;  
 }
 
+// Get the observables of the SpringSys calculated during its last step
+// Return NULL if arguments are invalid
+const SpringSysStats* SpringSysGetStats(SpringSys *sys) {
+  // Check arguments
+  if (sys == NULL || sys->_masses == NULL || sys->_springs == NULL)
+    return NULL;
+  // If the last step calculated the observables
+  if (sys->_statsValid)
+    // Return them
+    return &(sys->_stats);
+  // Else, calculate them from the current state
+  SpringSysStats *stats = &(sys->_stats);
+  stats->_momentum = SpringSysGetMomentum(sys);
+  stats->_stress = SpringSysGetStress(sys);
+  stats->_kineticEnergy = 0.0;
+  stats->_maxForce = 0.0;
+  int nbDim = sys->_nbDim;
+  // If the SpringSys is packed (the records have been copied into the
+  // packed arrays by SpringSysGetMomentum)
+  if (sys->_soa != NULL) {
+    SpringSysSoA *soa = sys->_soa;
+    for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+      float v = 0.0;
+      float f = 0.0;
+      for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i) {
+        v += soa->_speed[i] * soa->_speed[i];
+        f += soa->_stress[i] * soa->_stress[i];
+      }
+      stats->_kineticEnergy += 0.5 * v / soa->_invMass[iMass];
+      f = sqrt(f) / soa->_invMass[iMass];
+      if (soa->_fixed[iMass] == false && f > stats->_maxForce)
+        stats->_maxForce = f;
+    }
+  // Else, use the GSet
+  } else {
+    for (GSetElem *e = sys->_masses->_head; e != NULL; e = e->_next) {
+      SpringSysMass *m = (SpringSysMass*)(e->_data);
+      if (m != NULL) {
+        float v = 0.0;
+        float f = 0.0;
+        for (int iDim = 0; iDim < nbDim; ++iDim) {
+          v += m->_speed[iDim] * m->_speed[iDim];
+          f += m->_stress[iDim] * m->_stress[iDim];
+        }
+        stats->_kineticEnergy += 0.5 * v * (1.0 + m->_mass);
+        f = sqrt(f) * (1.0 + m->_mass);
+        if (m->_fixed == false && f > stats->_maxForce)
+          stats->_maxForce = f;
+      }
+    }
+  }
+  // Return the observables
+  return stats;
+}
+
 // Get the nearest mass to 'pos' in the SpringSys 'sys'
 // Return NULL if arguments are invalids
 SpringSysMass* SpringSysGetMassByPos(SpringSys *sys, float *pos) {
   // Check arguments
   if (sys == NULL || pos == NULL || sys->_masses == NULL)
     return NULL;
+  // If the SpringSys is packed
+  if (sys->_soa != NULL) {
+    // Copy the records handed out into the packed arrays
+    SpringSysSoAPush(sys);
+    // Build the grid of masses if necessary
+    SpringSysSoA *soa = sys->_soa;
+    if (soa->_gridValid == false)
+      SpringSysSoABuildGrid(soa, sys->_nbDim);
+    // Search the nearest mass in the packed arrays
+    int nearest = sys->_dimKernels->_nearestMass(soa, pos);
+    // If there is no mass
+    if (nearest == -1)
+      return NULL;
+    // Update the record of the nearest mass and return it
+    SpringSysSoAPullMass(sys, nearest);
+    return soa->_massRec[nearest];
+  }
   // Declare a pointer to memorize the nearest mass
   SpringSysMass *ret = NULL;
   // Declare a variable to memorize the distance to nearest mass
@@ -918,12 +3582,11 @@ SpringSysMass* SpringSysGetMassByPos(SpringSys *sys, float *pos) {
     SpringSysMass *m = (SpringSysMass*)(e->_data);
     // If the pointer is not null
     if (m != NULL) {
-      // Declare a variable to calculate the distance
+      // Declare a variable to calculate the squared distance
       float v = 0.0;
-      // Calculate the distance
+      // Calculate the squared distance
       for (int iDim = 0; iDim < sys->_nbDim; ++iDim)
-        v += pow(m->_pos[iDim] - pos[iDim], 2.0);
-      v = sqrt(v);
+        v += (m->_pos[iDim] - pos[iDim]) * (m->_pos[iDim] - pos[iDim]);
       // If the distance is shorter than the current one
       if (ret == NULL || d > v) {
         // Update the distance
@@ -936,7 +3599,198 @@ SpringSysMass* SpringSysGetMassByPos(SpringSys *sys, float *pos) {
     e = e->_next;
   }
   // Return the nearest mass
-  return ret;
+  return ret;  
+}
+
+// Get the nearest mass to each of the 'nb' positions 'pos' ('nb' times
+// _nbDim values) in the SpringSys 'sys' and store them in 'masses' (a
+// mass is NULL if there is no mass), as SpringSysGetMassByPos. If the 
+// SpringSys is packed, large batches are shared between its threads 
+// (cf SpringSysSetNbThread).
+// Return false if arguments are invalid, else true
+bool SpringSysGetMassesByPos(SpringSys *sys, const float *pos, int nb,
+  SpringSysMass **masses) {
+  // Check arguments
+  if (sys == NULL || pos == NULL || nb < 0 || masses == NULL || 
+    sys->_masses == NULL)
+    return false;
+  // Allocate memory for the positions of the nearest masses in the 
+  // packed arrays
+  int *nearest = 
+    (sys->_soa != NULL ? (int*)malloc(sizeof(int) * (nb + 1)) : NULL);
+  // If the SpringSys is not packed or we couldn't allocate memory
+  if (nearest == NULL) {
+    // Search the masses one by one
+    for (int iPos = 0; iPos < nb; ++iPos)
+      masses[iPos] = 
+        SpringSysGetMassByPos(sys, (float*)(pos + iPos * sys->_nbDim));
+    // Return true
+    return true;
+  }
+  // Copy the records handed out into the packed arrays
+  SpringSysSoAPush(sys);
+  // Build the grid of masses if necessary
+  SpringSysSoA *soa = sys->_soa;
+  if (soa->_gridValid == false)
+    SpringSysSoABuildGrid(soa, sys->_nbDim);
+  // Search the nearest masses, on the threads if the batch is large 
+  // enough and the threads could be created
+  SpringSysNearestBatch batch = {
+    ._sys = sys, ._pos = pos, ._nb = nb, ._nearest = nearest
+  };
+  if (sys->_nbThread > 1 && nb >= SPRINGSYS_NEAREST_MINBATCH && 
+    sys->_threadPool == NULL)
+    sys->_threadPool = SpringSysThreadPoolCreate(sys->_nbThread);
+  if (sys->_nbThread > 1 && nb >= SPRINGSYS_NEAREST_MINBATCH && 
+    sys->_threadPool != NULL)
+    SpringSysThreadPoolRun(sys->_threadPool, SpringSysNearestMassJob,
+      &batch);
+  else
+    SpringSysNearestMassJob(&batch, 0, 1);
+  // Update the records of the nearest masses
+  for (int iPos = 0; iPos < nb; ++iPos) {
+    if (nearest[iPos] == -1) {
+      masses[iPos] = NULL;
+    } else {
+      SpringSysSoAPullMass(sys, nearest[iPos]);
+      masses[iPos] = soa->_massRec[nearest[iPos]];
+    }
+  }
+  // Free memory
+  free(nearest);
+  // Return true
+  return true;
+}
+
+// Search the nearest masses of a batch of positions, the part of the 
+// thread 'iThread' among 'nbThread', 'arg' is a SpringSysNearestBatch
+static void SpringSysNearestMassJob(void *arg, int iThread, 
+  int nbThread) {
+  SpringSysNearestBatch *batch = (SpringSysNearestBatch*)arg;
+  SpringSys *sys = batch->_sys;
+  int first = (int)((long)(batch->_nb) * iThread / nbThread);
+  int last = (int)((long)(batch->_nb) * (iThread + 1) / nbThread);
+  for (int iPos = first; iPos < last; ++iPos)
+    batch->_nearest[iPos] = sys->_dimKernels->_nearestMass(sys->_soa,
+      batch->_pos + iPos * sys->_nbDim);
+}
+
+// Sort the masses of the packed arrays 'soa' with 'nbDim' dimensions 
+// into a uniform grid over their bounding box, with about 
+// SPRINGSYS_GRID_DENSITY masses per cell, reusing the memory of the 
+// previous grid
+// Return false if the positions are not finite or memory allocation 
+// failed, in which case the grid is not valid, else true
+static bool SpringSysSoABuildGrid(SpringSysSoA *soa, int nbDim) {
+  soa->_gridValid = false;
+  int nbMass = soa->_nbMass;
+  if (nbMass == 0)
+    return false;
+  // Get the bounding box of masses
+  float min[3] = {0.0, 0.0, 0.0};
+  float ext[3] = {0.0, 0.0, 0.0};
+  float maxExt = 0.0;
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    float max = soa->_pos[iDim];
+    min[iDim] = max;
+    for (int iMass = 1; iMass < nbMass; ++iMass) {
+      float x = soa->_pos[iMass * nbDim + iDim];
+      if (x < min[iDim])
+        min[iDim] = x;
+      if (x > max)
+        max = x;
+    }
+    ext[iDim] = max - min[iDim];
+    if (!isfinite(min[iDim]) || !isfinite(ext[iDim]))
+      return false;
+    if (ext[iDim] > maxExt)
+      maxExt = ext[iDim];
+  }
+  // Get the size of cells giving the requested density, the flat 
+  // dimensions of the box being extended
+  float cell = 1.0;
+  if (maxExt > 0.0) {
+    double volume = 1.0;
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      volume *= (ext[iDim] > maxExt / nbMass ? 
+        ext[iDim] : maxExt / nbMass);
+    cell = pow(volume * SPRINGSYS_GRID_DENSITY / nbMass, 1.0 / nbDim);
+    if (!(cell > 0.0))
+      cell = maxExt;
+  }
+  // Get the number of cells per dimension, enlarging the cells if the
+  // box is so thin in some dimension that there are too many cells
+  long nbCell = 0;
+  do {
+    nbCell = 1;
+    for (int iDim = 0; iDim < 3; ++iDim) {
+      double nb = (iDim < nbDim ? floor(ext[iDim] / cell) + 1.0 : 1.0);
+      soa->_gridDim[iDim] = (nb < nbMass ? (int)nb : nbMass);
+      nbCell *= soa->_gridDim[iDim];
+    }
+    if (nbCell > 4 * (long)nbMass)
+      cell *= 1.5;
+  } while (nbCell > 4 * (long)nbMass);
+  // Allocate memory if necessary
+  if (soa->_gridMass == NULL)
+    soa->_gridMass = (int*)malloc(sizeof(int) * nbMass);
+  if (soa->_gridSize < nbCell + 1) {
+    free(soa->_gridStart);
+    soa->_gridStart = (int*)malloc(sizeof(int) * (nbCell + 1));
+    soa->_gridSize = (soa->_gridStart != NULL ? nbCell + 1 : 0);
+  }
+  // If we couldn't allocate memory
+  if (soa->_gridMass == NULL || soa->_gridStart == NULL)
+    // Return false
+    return false;
+  soa->_gridCell = cell;
+  for (int iDim = 0; iDim < 3; ++iDim) {
+    soa->_gridMin[iDim] = min[iDim];
+    soa->_gridMax[iDim] = min[iDim] + ext[iDim];
+  }
+  // Sort the masses by cell (counting sort)
+  int *start = soa->_gridStart;
+  memset(start, 0, sizeof(int) * (nbCell + 1));
+  for (int iMass = 0; iMass < nbMass; ++iMass)
+    ++(start[SpringSysSoAGridCell(soa, soa->_pos + iMass * nbDim, 
+      nbDim) + 1]);
+  for (int iCell = 0; iCell < nbCell; ++iCell)
+    start[iCell + 1] += start[iCell];
+  for (int iMass = 0; iMass < nbMass; ++iMass)
+    soa->_gridMass[(start[SpringSysSoAGridCell(soa, 
+      soa->_pos + iMass * nbDim, nbDim)])++] = iMass;
+  // The cursors are now at the first position of the next cell
+  for (int iCell = nbCell; iCell > 0; --iCell)
+    start[iCell] = start[iCell - 1];
+  start[0] = 0;
+  // The grid is valid
+  soa->_gridValid = true;
+  // Return true
+  return true;
+}
+
+// Return the coordinate along the dimension 'iDim' of the cell of the 
+// grid of masses of 'soa' containing the coordinate 'x', clamped to 
+// the grid (non numbers are in the first cell)
+static inline int SpringSysSoAGridCoord(const SpringSysSoA *soa, 
+  float x, int iDim) {
+  float f = (x - soa->_gridMin[iDim]) / soa->_gridCell;
+  if (!(f >= 1.0))
+    return 0;
+  if (f >= soa->_gridDim[iDim])
+    return soa->_gridDim[iDim] - 1;
+  return (int)f;
+}
+
+// Return the index of the cell of the grid of masses of 'soa' with 
+// 'nbDim' dimensions containing 'pos', clamped to the grid
+static inline int SpringSysSoAGridCell(const SpringSysSoA *soa, 
+  const float *pos, int nbDim) {
+  int cell = 0;
+  for (int iDim = nbDim - 1; iDim >= 0; --iDim)
+    cell = cell * soa->_gridDim[iDim] + 
+      SpringSysSoAGridCoord(soa, pos[iDim], iDim);
+  return cell;
 }
 
 // Get the nearest spring to 'pos' in the SpringSys 'sys'
@@ -946,9 +3800,26 @@ SpringSysSpring* SpringSysGetSpringByPos(SpringSys *sys, float *pos) {
   if (sys == NULL || pos == NULL || sys->_springs == NULL || 
     sys->_masses == NULL)
     return NULL;
+  // If the SpringSys is packed
+  if (sys->_soa != NULL) {
+    // Copy the records handed out into the packed arrays
+    SpringSysSoAPush(sys);
+    // Build or refit the hierarchy of springs if necessary
+    SpringSysSoA *soa = sys->_soa;
+    SpringSysSoAPrepareBVH(soa, sys->_nbDim);
+    // Search the nearest spring in the packed arrays
+    int nearest = sys->_dimKernels->_nearestSpring(soa, pos);
+    // If there is no spring
+    if (nearest == -1)
+      return NULL;
+    // Update the record of the nearest spring and return it
+    SpringSysSoAPullSpring(sys, nearest);
+    return soa->_springRec[nearest];
+  }
   // Declare a pointer to memorize the nearest spring
   SpringSysSpring *ret = NULL;
-  // Declare a variable to memorize the distance to nearest mass
+  // Declare a variable to memorize the squared distance to nearest 
+  // spring
   float d = 0.0;
   // Declare a pointer to the first element of the list of springs
   GSetElem *e = sys->_springs->_head;
@@ -962,17 +3833,10 @@ SpringSysSpring* SpringSysGetSpringByPos(SpringSys *sys, float *pos) {
       SpringSysMass *mA = SpringSysGetMass(sys, s->_mass[0]);
       SpringSysMass *mB = SpringSysGetMass(sys, s->_mass[1]);
       if (mA != NULL && mB != NULL) {
-        // Declare a variable to memorize the center of the spring
-        float center[2];
-        // Calculate the center of the spring
-        center[0] = 0.5 * (mA->_pos[0] + mB->_pos[0]);
-        center[1] = 0.5 * (mA->_pos[1] + mB->_pos[1]);
-        // Declare a variable to calculate the distance
-        float v = 0.0;
-        // Calculate the distance
-        for (int iDim = 0; iDim < sys->_nbDim; ++iDim)
-          v += pow(center[iDim] - pos[iDim], 2.0);
-        v = sqrt(v);
+        // Calculate the squared distance to the segment between the 
+        // masses
+        float v = SpringSysSegmentSqDistDim(pos, mA->_pos, mB->_pos, 
+          sys->_nbDim);
         // If the distance is shorter than the current one
         if (ret == NULL || d > v) {
           // Update the distance
@@ -989,3 +3853,5509 @@ SpringSysSpring* SpringSysGetSpringByPos(SpringSys *sys, float *pos) {
   return ret;  
 }
 
+// Get the ids of the masses at a distance less than or equal to 
+// 'radius' from 'center' in the SpringSys 'sys'. Their number is 
+// stored in 'nb'. If the SpringSys is packed (cf SpringSysSetBackend 
+// and SpringSysCompile), only the masses in the cells of the grid of 
+// masses overlapping the sphere are checked (cf 
+// SpringSysGetMassByPos), else all the masses are checked.
+// Return the ids, in no particular order, in an array to be freed by 
+// the user, or NULL if arguments are invalid or memory allocation 
+// failed
+int* SpringSysGetMassesInSphere(SpringSys *sys, const float *center,
+  float radius, int *nb) {
+  // Check arguments
+  if (sys == NULL || center == NULL || !(radius >= 0.0) || 
+    nb == NULL || sys->_masses == NULL)
+    return NULL;
+  // Get the range of the query
+  SpringSysRange range;
+  SpringSysRangeSetSphere(&range, center, radius, sys->_nbDim);
+  // Return the masses in the range
+  return SpringSysGetMassesInRange(sys, &range, nb);
+}
+
+// Get the ids of the masses inside the box from 'min' to 'max' 
+// (bounds included) in the SpringSys 'sys', as 
+// SpringSysGetMassesInSphere
+int* SpringSysGetMassesInBox(SpringSys *sys, const float *min, 
+  const float *max, int *nb) {
+  // Check arguments
+  if (sys == NULL || min == NULL || max == NULL || nb == NULL || 
+    sys->_masses == NULL)
+    return NULL;
+  // Get the range of the query
+  SpringSysRange range;
+  SpringSysRangeSetBox(&range, min, max, sys->_nbDim);
+  // Return the masses in the range
+  return SpringSysGetMassesInRange(sys, &range, nb);
+}
+
+// Get the ids of the springs whose segment between their masses is at
+// a distance less than or equal to 'radius' from 'center' in the 
+// SpringSys 'sys'. Their number is stored in 'nb'. If the SpringSys is
+// packed (cf SpringSysSetBackend and SpringSysCompile), only the 
+// springs in the nodes of the hierarchy of springs overlapping the 
+// sphere are checked (cf SpringSysGetSpringByPos), else all the 
+// springs are checked.
+// Return the ids, in no particular order, in an array to be freed by 
+// the user, or NULL if arguments are invalid or memory allocation 
+// failed
+int* SpringSysGetSpringsInSphere(SpringSys *sys, const float *center,
+  float radius, int *nb) {
+  // Check arguments
+  if (sys == NULL || center == NULL || !(radius >= 0.0) || 
+    nb == NULL || sys->_springs == NULL || sys->_masses == NULL)
+    return NULL;
+  // Get the range of the query
+  SpringSysRange range;
+  SpringSysRangeSetSphere(&range, center, radius, sys->_nbDim);
+  // Return the springs in the range
+  return SpringSysGetSpringsInRange(sys, &range, nb);
+}
+
+// Get the ids of the springs whose segment between their masses 
+// crosses the box from 'min' to 'max' (bounds included) in the 
+// SpringSys 'sys', as SpringSysGetSpringsInSphere
+int* SpringSysGetSpringsInBox(SpringSys *sys, const float *min, 
+  const float *max, int *nb) {
+  // Check arguments
+  if (sys == NULL || min == NULL || max == NULL || nb == NULL || 
+    sys->_springs == NULL || sys->_masses == NULL)
+    return NULL;
+  // Get the range of the query
+  SpringSysRange range;
+  SpringSysRangeSetBox(&range, min, max, sys->_nbDim);
+  // Return the springs in the range
+  return SpringSysGetSpringsInRange(sys, &range, nb);
+}
+
+// Set the range 'range' with 'nbDim' dimensions to the ball of center 
+// 'center' and radius 'radius'
+static void SpringSysRangeSetSphere(SpringSysRange *range, 
+  const float *center, float radius, int nbDim) {
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    range->_min[iDim] = center[iDim] - radius;
+    range->_max[iDim] = center[iDim] + radius;
+    range->_center[iDim] = center[iDim];
+  }
+  range->_sphere = true;
+  range->_sqRadius = radius * radius;
+}
+
+// Set the range 'range' with 'nbDim' dimensions to the box from 'min' 
+// to 'max'
+static void SpringSysRangeSetBox(SpringSysRange *range, 
+  const float *min, const float *max, int nbDim) {
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    range->_min[iDim] = min[iDim];
+    range->_max[iDim] = max[iDim];
+  }
+  range->_sphere = false;
+}
+
+// Return true if 'pos' with 'nbDim' dimensions is in the range 
+// 'range', else false
+static inline bool SpringSysRangeHasPos(const SpringSysRange *range,
+  const float *pos, int nbDim) {
+  for (int iDim = 0; iDim < nbDim; ++iDim)
+    if (!(pos[iDim] >= range->_min[iDim] && 
+      pos[iDim] <= range->_max[iDim]))
+      return false;
+  if (range->_sphere) {
+    float v = 0.0;
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      v += (pos[iDim] - range->_center[iDim]) * 
+        (pos[iDim] - range->_center[iDim]);
+    return (v <= range->_sqRadius);
+  }
+  return true;
+}
+
+// Return true if the segment ['pA', 'pB'] with 'nbDim' dimensions 
+// crosses the range 'range', else false
+static inline bool SpringSysRangeHasSegment(const SpringSysRange *range,
+  const float *pA, const float *pB, int nbDim) {
+  // If the range is a sphere, check the distance to its center
+  if (range->_sphere)
+    return (SpringSysSegmentSqDistDim(range->_center, pA, pB, nbDim) <=
+      range->_sqRadius);
+  // Clip the segment to the slab of the box along each dimension
+  float tMin = 0.0;
+  float tMax = 1.0;
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    float d = pB[iDim] - pA[iDim];
+    if (d == 0.0) {
+      if (!(pA[iDim] >= range->_min[iDim] && 
+        pA[iDim] <= range->_max[iDim]))
+        return false;
+    } else {
+      float tA = (range->_min[iDim] - pA[iDim]) / d;
+      float tB = (range->_max[iDim] - pA[iDim]) / d;
+      if (tA > tB) {
+        float tmp = tA;
+        tA = tB;
+        tB = tmp;
+      }
+      if (tA > tMin)
+        tMin = tA;
+      if (tB < tMax)
+        tMax = tB;
+      if (!(tMin <= tMax))
+        return false;
+    }
+  }
+  return true;
+}
+
+// Return true if the box 'box' (lower corner then upper corner) with 
+// 'nbDim' dimensions overlaps the range 'range', else false
+static inline bool SpringSysRangeHitsBox(const SpringSysRange *range,
+  const float *box, int nbDim) {
+  for (int iDim = 0; iDim < nbDim; ++iDim)
+    if (box[nbDim + iDim] < range->_min[iDim] || 
+      box[iDim] > range->_max[iDim])
+      return false;
+  if (range->_sphere)
+    return (SpringSysBoxSqDistDim(box, range->_center, nbDim) <= 
+      range->_sqRadius);
+  return true;
+}
+
+// Add the id 'id' to the list 'list', enlarging it if necessary
+// Return false if memory allocation failed, else true
+static inline bool SpringSysIdListAdd(SpringSysIdList *list, int id) {
+  if (list->_nb == list->_size) {
+    int size = 2 * list->_size + 16;
+    int *ids = (int*)realloc(list->_id, sizeof(int) * size);
+    if (ids == NULL)
+      return false;
+    list->_id = ids;
+    list->_size = size;
+  }
+  list->_id[(list->_nb)++] = id;
+  return true;
+}
+
+// Get the ids of the masses in the range 'range' of the SpringSys 
+// 'sys' and store their number in 'nb'
+// Return the ids in an array to be freed by the user, or NULL if 
+// memory allocation failed
+static int* SpringSysGetMassesInRange(SpringSys *sys, 
+  const SpringSysRange *range, int *nb) {
+  int nbDim = sys->_nbDim;
+  SpringSysIdList list = {._id = NULL, ._nb = 0, ._size = 0};
+  bool ok = SpringSysIdListAdd(&list, 0);
+  list._nb = 0;
+  // If the SpringSys is packed
+  if (ok && sys->_soa != NULL) {
+    // Copy the records handed out into the packed arrays
+    SpringSysSoAPush(sys);
+    // Build the grid of masses if necessary
+    SpringSysSoA *soa = sys->_soa;
+    if (soa->_gridValid == false)
+      SpringSysSoABuildGrid(soa, nbDim);
+    // If the grid is valid
+    if (soa->_gridValid) {
+      // Get the cells of the grid overlapping the range, none if the 
+      // range is out of the grid
+      int lo[3] = {0, 0, 0};
+      int hi[3] = {0, 0, 0};
+      bool out = false;
+      for (int iDim = 0; iDim < nbDim; ++iDim) {
+        if (!(range->_max[iDim] >= soa->_gridMin[iDim] && 
+          range->_min[iDim] <= soa->_gridMax[iDim]))
+          out = true;
+        lo[iDim] = SpringSysSoAGridCoord(soa, range->_min[iDim], iDim);
+        hi[iDim] = SpringSysSoAGridCoord(soa, range->_max[iDim], iDim);
+      }
+      if (out)
+        hi[2] = -1;
+      // Check the masses of these cells
+      for (int z = lo[2]; z <= hi[2]; ++z) {
+        for (int y = lo[1]; y <= hi[1]; ++y) {
+          int row = (z * soa->_gridDim[1] + y) * soa->_gridDim[0];
+          for (int x = lo[0]; ok && x <= hi[0]; ++x) {
+            for (int i = soa->_gridStart[row + x]; 
+              ok && i < soa->_gridStart[row + x + 1]; ++i) {
+              int iMass = soa->_gridMass[i];
+              if (SpringSysRangeHasPos(range, 
+                soa->_pos + iMass * nbDim, nbDim))
+                ok = SpringSysIdListAdd(&list, soa->_massId[iMass]);
+            }
+          }
+        }
+      }
+    // Else, check all the masses of the packed arrays
+    } else {
+      for (int iMass = 0; ok && iMass < soa->_nbMass; ++iMass)
+        if (SpringSysRangeHasPos(range, soa->_pos + iMass * nbDim, 
+          nbDim))
+          ok = SpringSysIdListAdd(&list, soa->_massId[iMass]);
+    }
+  // Else, if the SpringSys is not packed
+  } else if (ok) {
+    // Check all the masses
+    for (GSetElem *e = sys->_masses->_head; ok && e != NULL; 
+      e = e->_next) {
+      SpringSysMass *m = (SpringSysMass*)(e->_data);
+      if (m != NULL && SpringSysRangeHasPos(range, m->_pos, nbDim))
+        ok = SpringSysIdListAdd(&list, m->_id);
+    }
+  }
+  // If memory allocation failed
+  if (!ok) {
+    // Free memory and return NULL
+    free(list._id);
+    return NULL;
+  }
+  // Return the ids
+  *nb = list._nb;
+  return list._id;
+}
+
+// Get the ids of the springs crossing the range 'range' of the 
+// SpringSys 'sys' and store their number in 'nb'
+// Return the ids in an array to be freed by the user, or NULL if 
+// memory allocation failed
+static int* SpringSysGetSpringsInRange(SpringSys *sys, 
+  const SpringSysRange *range, int *nb) {
+  int nbDim = sys->_nbDim;
+  SpringSysIdList list = {._id = NULL, ._nb = 0, ._size = 0};
+  bool ok = SpringSysIdListAdd(&list, 0);
+  list._nb = 0;
+  // If the SpringSys is packed
+  if (ok && sys->_soa != NULL) {
+    // Copy the records handed out into the packed arrays
+    SpringSysSoAPush(sys);
+    // Build or refit the hierarchy of springs if necessary
+    SpringSysSoA *soa = sys->_soa;
+    SpringSysSoAPrepareBVH(soa, nbDim);
+    // If the hierarchy is valid
+    if (soa->_bvhValid && soa->_bvhFit) {
+      // Walk the hierarchy from the root, skipping the nodes out of the
+      // range
+      int stack[64];
+      int nbStack = 0;
+      if (soa->_nbSpring > 0)
+        stack[nbStack++] = 0;
+      while (ok && nbStack > 0) {
+        int iNode = stack[--nbStack];
+        if (!SpringSysRangeHitsBox(range, 
+          soa->_bvhBox + iNode * 2 * nbDim, nbDim))
+          continue;
+        int first = soa->_bvhNode[2 * iNode];
+        int nbLeaf = soa->_bvhNode[2 * iNode + 1];
+        // If the node is a leaf, check its springs
+        if (nbLeaf > 0) {
+          for (int i = first; ok && i < first + nbLeaf; ++i) {
+            int iSpring = soa->_bvhSpring[i];
+            if (SpringSysRangeHasSegment(range, 
+              soa->_pos + soa->_springMass[2 * iSpring] * nbDim,
+              soa->_pos + soa->_springMass[2 * iSpring + 1] * nbDim, 
+              nbDim))
+              ok = SpringSysIdListAdd(&list, soa->_springId[iSpring]);
+          }
+        // Else, push its children
+        } else {
+          stack[nbStack++] = first + 1;
+          stack[nbStack++] = first;
+        }
+      }
+    // Else, check all the springs of the packed arrays
+    } else {
+      for (int iSpring = 0; ok && iSpring < soa->_nbSpring; ++iSpring)
+        if (SpringSysRangeHasSegment(range, 
+          soa->_pos + soa->_springMass[2 * iSpring] * nbDim,
+          soa->_pos + soa->_springMass[2 * iSpring + 1] * nbDim, nbDim))
+          ok = SpringSysIdListAdd(&list, soa->_springId[iSpring]);
+    }
+  // Else, if the SpringSys is not packed
+  } else if (ok) {
+    // Check all the springs
+    for (GSetElem *e = sys->_springs->_head; ok && e != NULL; 
+      e = e->_next) {
+      SpringSysSpring *s = (SpringSysSpring*)(e->_data);
+      if (s == NULL)
+        continue;
+      SpringSysMass *mA = SpringSysGetMass(sys, s->_mass[0]);
+      SpringSysMass *mB = SpringSysGetMass(sys, s->_mass[1]);
+      if (mA != NULL && mB != NULL && 
+        SpringSysRangeHasSegment(range, mA->_pos, mB->_pos, nbDim))
+        ok = SpringSysIdListAdd(&list, s->_id);
+    }
+  }
+  // If memory allocation failed
+  if (!ok) {
+    // Free memory and return NULL
+    free(list._id);
+    return NULL;
+  }
+  // Return the ids
+  *nb = list._nb;
+  return list._id;
+}
+
+// Build the hierarchy of the springs of the packed arrays 'soa' with 
+// 'nbDim' dimensions if it doesn't match the springs or has been refit
+// too many times, else refit it if it doesn't match the positions
+static void SpringSysSoAPrepareBVH(SpringSysSoA *soa, int nbDim) {
+  if (soa->_bvhValid == false || 
+    (soa->_bvhFit == false && 
+    soa->_bvhNbRefit >= SPRINGSYS_BVH_MAXREFIT))
+    SpringSysSoABuildBVH(soa, nbDim);
+  else if (soa->_bvhFit == false)
+    SpringSysSoARefitBVH(soa, nbDim);
+}
+
+// Build the hierarchy of the springs of the packed arrays 'soa' with 
+// 'nbDim' dimensions, splitting the springs at the median of their 
+// centers along the longest dimension of their centers' box until 
+// there are at most SPRINGSYS_BVH_LEAF springs per leaf, and fit it 
+// to the current positions
+// Return false if memory allocation failed, in which case the 
+// hierarchy is not valid, else true
+static bool SpringSysSoABuildBVH(SpringSysSoA *soa, int nbDim) {
+  int nbSpring = soa->_nbSpring;
+  // Release the current hierarchy
+  free(soa->_bvhSpring);
+  free(soa->_bvhNode);
+  free(soa->_bvhBox);
+  soa->_bvhSpring = NULL;
+  soa->_bvhNode = NULL;
+  soa->_bvhBox = NULL;
+  soa->_bvhNbNode = 0;
+  soa->_bvhValid = false;
+  // Allocate memory for the hierarchy (a binary tree whose leaves have
+  // at least one spring has less than 2 nodes per spring), the 
+  // centers of springs and the stack of nodes to split
+  int nS = (nbSpring > 0 ? nbSpring : 1);
+  soa->_bvhSpring = (int*)malloc(sizeof(int) * nS);
+  soa->_bvhNode = (int*)malloc(sizeof(int) * 4 * nS);
+  soa->_bvhBox = (float*)malloc(sizeof(float) * 4 * nS * nbDim);
+  float *center = (float*)malloc(sizeof(float) * nS * nbDim);
+  int *stack = (int*)malloc(sizeof(int) * 2 * nS);
+  // If we couldn't allocate memory
+  if (soa->_bvhSpring == NULL || soa->_bvhNode == NULL || 
+    soa->_bvhBox == NULL || center == NULL || stack == NULL) {
+    // Free memory
+    free(center);
+    free(stack);
+    // Return false
+    return false;
+  }
+  // Get the centers of springs
+  for (int iSpring = 0; iSpring < nbSpring; ++iSpring) {
+    const float *pA = soa->_pos + soa->_springMass[2 * iSpring] * nbDim;
+    const float *pB = 
+      soa->_pos + soa->_springMass[2 * iSpring + 1] * nbDim;
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      center[iSpring * nbDim + iDim] = 0.5 * (pA[iDim] + pB[iDim]);
+    soa->_bvhSpring[iSpring] = iSpring;
+  }
+  // Split the nodes from the root, the children of a node are created 
+  // after it
+  int *node = soa->_bvhNode;
+  node[0] = 0;
+  node[1] = nbSpring;
+  soa->_bvhNbNode = 1;
+  int nbStack = 0;
+  if (nbSpring > SPRINGSYS_BVH_LEAF)
+    stack[nbStack++] = 0;
+  while (nbStack > 0) {
+    int iNode = stack[--nbStack];
+    int first = node[2 * iNode];
+    int nb = node[2 * iNode + 1];
+    int *spring = soa->_bvhSpring + first;
+    // Get the longest dimension of the box of centers
+    int axis = 0;
+    float longest = -1.0;
+    for (int iDim = 0; iDim < nbDim; ++iDim) {
+      float min = center[spring[0] * nbDim + iDim];
+      float max = min;
+      for (int i = 1; i < nb; ++i) {
+        float x = center[spring[i] * nbDim + iDim];
+        if (x < min)
+          min = x;
+        if (x > max)
+          max = x;
+      }
+      if (max - min > longest) {
+        longest = max - min;
+        axis = iDim;
+      }
+    }
+    // Split the springs at the median of their centers along this 
+    // dimension
+    int half = nb / 2;
+    SpringSysSelect(spring, center + axis, nbDim, nb, half);
+    int child = soa->_bvhNbNode;
+    soa->_bvhNbNode += 2;
+    node[2 * child] = first;
+    node[2 * child + 1] = half;
+    node[2 * child + 2] = first + half;
+    node[2 * child + 3] = nb - half;
+    node[2 * iNode] = child;
+    node[2 * iNode + 1] = 0;
+    if (half > SPRINGSYS_BVH_LEAF)
+      stack[nbStack++] = child;
+    if (nb - half > SPRINGSYS_BVH_LEAF)
+      stack[nbStack++] = child + 1;
+  }
+  // Free memory
+  free(center);
+  free(stack);
+  // Fit the boxes of nodes to the positions
+  soa->_bvhValid = true;
+  SpringSysSoARefitBVH(soa, nbDim);
+  soa->_bvhNbRefit = 0;
+  // Return true
+  return true;
+}
+
+// Fit the boxes of the nodes of the hierarchy of springs of the packed
+// arrays 'soa' with 'nbDim' dimensions to the current positions
+static void SpringSysSoARefitBVH(SpringSysSoA *soa, int nbDim) {
+  // Children are after their parent, fit the nodes from the last one
+  for (int iNode = soa->_bvhNbNode - 1; iNode >= 0; --iNode) {
+    float *box = soa->_bvhBox + iNode * 2 * nbDim;
+    int first = soa->_bvhNode[2 * iNode];
+    int nb = soa->_bvhNode[2 * iNode + 1];
+    for (int iDim = 0; iDim < nbDim; ++iDim) {
+      box[iDim] = INFINITY;
+      box[nbDim + iDim] = -INFINITY;
+    }
+    // If the node is a leaf, fit its box to the masses of its springs
+    if (nb > 0) {
+      for (int i = first; i < first + nb; ++i) {
+        int iSpring = soa->_bvhSpring[i];
+        for (int iEnd = 0; iEnd < 2; ++iEnd) {
+          const float *p = 
+            soa->_pos + soa->_springMass[2 * iSpring + iEnd] * nbDim;
+          for (int iDim = 0; iDim < nbDim; ++iDim) {
+            if (p[iDim] < box[iDim])
+              box[iDim] = p[iDim];
+            if (p[iDim] > box[nbDim + iDim])
+              box[nbDim + iDim] = p[iDim];
+          }
+        }
+      }
+    // Else, fit its box to the ones of its children
+    } else {
+      const float *boxA = soa->_bvhBox + first * 2 * nbDim;
+      const float *boxB = boxA + 2 * nbDim;
+      for (int iDim = 0; iDim < nbDim; ++iDim) {
+        box[iDim] = (boxA[iDim] < boxB[iDim] ? boxA[iDim] : boxB[iDim]);
+        box[nbDim + iDim] = (boxA[nbDim + iDim] > boxB[nbDim + iDim] ? 
+          boxA[nbDim + iDim] : boxB[nbDim + iDim]);
+      }
+    }
+  }
+  soa->_bvhFit = true;
+  ++(soa->_bvhNbRefit);
+}
+
+// Reorder the 'nb' indices 'idx' such as the one at position 'k' is 
+// the one it would be at if they were sorted by increasing key, the 
+// ones before it having a lower or equal key and the ones after it a 
+// greater or equal one. The key of the index i is 'key'[i * 'stride'].
+static void SpringSysSelect(int *idx, const float *key, int stride, 
+  int nb, int k) {
+  int lo = 0;
+  int hi = nb - 1;
+  while (lo < hi) {
+    float pivot = key[idx[(lo + hi) / 2] * stride];
+    int i = lo;
+    int j = hi;
+    while (i <= j) {
+      while (key[idx[i] * stride] < pivot)
+        ++i;
+      while (key[idx[j] * stride] > pivot)
+        --j;
+      if (i <= j) {
+        int tmp = idx[i];
+        idx[i] = idx[j];
+        idx[j] = tmp;
+        ++i;
+        --j;
+      }
+    }
+    if (k <= j)
+      hi = j;
+    else if (k >= i)
+      lo = i;
+    else
+      break;
+  }
+}
+
+// The masses of the packed arrays 'soa' have moved, flag the 
+// structures searching masses and springs by position as outdated
+static inline void SpringSysSoAMoved(SpringSysSoA *soa) {
+  soa->_gridValid = false;
+  soa->_bvhFit = false;
+}
+
+// Create a new empty index
+// Return NULL if memory allocation failed
+static SpringSysIndex* SpringSysIndexCreate(void) {
+  // Allocate memory for the index
+  SpringSysIndex *ret = (SpringSysIndex*)malloc(sizeof(SpringSysIndex));
+  // If we could allocate memory
+  if (ret != NULL) {
+    // Allocate memory for the hash table, entries are empty when their
+    // pointer to element is null
+    ret->_entries = (SpringSysIndexEntry*)calloc(
+      SPRINGSYS_INDEX_INITSIZE, sizeof(SpringSysIndexEntry));
+    // If we couldn't allocate memory
+    if (ret->_entries == NULL) {
+      // Free memory
+      free(ret);
+      // Return NULL
+      return NULL;
+    }
+    // Set the properties
+    ret->_size = SPRINGSYS_INDEX_INITSIZE;
+    ret->_nbElem = 0;
+  }
+  // Return the new index
+  return ret;  
+}
+
+// Free the memory used by the index 'index'
+static void SpringSysIndexFree(SpringSysIndex **index) {
+  // Check arguments
+  if (index == NULL || *index == NULL)
+    return;
+  // Free memory
+  for (int iEntry = 0; iEntry < (*index)->_size; ++iEntry)
+    if ((*index)->_entries[iEntry]._elem != NULL)
+      free((*index)->_entries[iEntry]._incident);
+  free((*index)->_entries);
+  free(*index);
+  *index = NULL;
+}
+
+// Get the position in the hash table of size 'size' where the search
+// for the element identified by 'id' starts
+static inline int SpringSysIndexHash(int id, int size) {
+  // Mix the bits of the id (multiplicative hashing) and bring the 
+  // result into the table
+  unsigned int h = (unsigned int)id * 2654435761u;
+  h ^= (h >> 16);
+  return (int)(h & (unsigned int)(size - 1));
+}
+
+// Get the element identified by 'id' in the index 'index'
+// Return NULL if there is no element with this id
+static void* SpringSysIndexGet(SpringSysIndex *index, int id) {
+  // Get the entry of the element
+  SpringSysIndexEntry *entry = SpringSysIndexGetEntry(index, id);
+  // Return the element if it's in the index
+  return (entry != NULL ? entry->_elem : NULL);
+}
+
+// Get the entry of the element identified by 'id' in the index 'index'
+// Return NULL if there is no element with this id
+static SpringSysIndexEntry* SpringSysIndexGetEntry(SpringSysIndex *index,
+  int id) {
+  // Check arguments
+  if (index == NULL)
+    return NULL;
+  // Search the element from its hash position until we find it or
+  // reach an empty entry
+  int iEntry = SpringSysIndexHash(id, index->_size);
+  while (index->_entries[iEntry]._elem != NULL) {
+    // If it's the searched element
+    if (index->_entries[iEntry]._id == id)
+      // Return the entry
+      return index->_entries + iEntry;
+    // Move to the next entry
+    iEntry = (iEntry + 1) & (index->_size - 1);
+  }
+  // The element is not in the index
+  return NULL;
+}
+
+// Resize the hash table of the index 'index' to 'size' entries
+// 'size' must be a power of 2 and greater than the number of elements
+// Return false if memory allocation failed, else return true
+static bool SpringSysIndexResize(SpringSysIndex *index, int size) {
+  // Allocate memory for the new hash table
+  SpringSysIndexEntry *entries = 
+    (SpringSysIndexEntry*)calloc(size, sizeof(SpringSysIndexEntry));
+  // If we couldn't allocate memory
+  if (entries == NULL)
+    // Return false
+    return false;
+  // Move the entries from the old hash table to the new one
+  for (int iEntry = 0; iEntry < index->_size; ++iEntry) {
+    if (index->_entries[iEntry]._elem != NULL) {
+      int jEntry = SpringSysIndexHash(index->_entries[iEntry]._id, size);
+      while (entries[jEntry]._elem != NULL)
+        jEntry = (jEntry + 1) & (size - 1);
+      entries[jEntry] = index->_entries[iEntry];
+    }
+  }
+  // Replace the hash table
+  free(index->_entries);
+  index->_entries = entries;
+  index->_size = size;
+  // Return true
+  return true;
+}
+
+// Add the element 'elem' identified by 'id' to the index 'index'
+// If there is already an element with this id the index is unchanged
+// Return false if memory allocation failed, else return true
+static bool SpringSysIndexAdd(SpringSysIndex *index, int id, void *elem) {
+  // Check arguments
+  if (index == NULL || elem == NULL)
+    return false;
+  // Keep the load of the hash table under one half to keep the 
+  // searches short
+  if (2 * (index->_nbElem + 1) > index->_size)
+    if (!SpringSysIndexResize(index, 2 * index->_size))
+      return false;
+  // Search the first empty entry from the hash position
+  int iEntry = SpringSysIndexHash(id, index->_size);
+  while (index->_entries[iEntry]._elem != NULL) {
+    // If there is already an element with this id
+    if (index->_entries[iEntry]._id == id)
+      // Nothing to do
+      return true;
+    // Move to the next entry
+    iEntry = (iEntry + 1) & (index->_size - 1);
+  }
+  // Set the entry
+  index->_entries[iEntry]._id = id;
+  index->_entries[iEntry]._elem = elem;
+  index->_entries[iEntry]._incident = NULL;
+  index->_entries[iEntry]._nbIncident = 0;
+  index->_entries[iEntry]._incidentSize = 0;
+  ++(index->_nbElem);
+  // Return true
+  return true;
+}
+
+// Remove the element identified by 'id' from the index 'index'
+static void SpringSysIndexRemove(SpringSysIndex *index, int id) {
+  // Check arguments
+  if (index == NULL)
+    return;
+  // Search the entry of the element
+  int mask = index->_size - 1;
+  int iEntry = SpringSysIndexHash(id, index->_size);
+  while (index->_entries[iEntry]._elem != NULL && 
+    index->_entries[iEntry]._id != id)
+    iEntry = (iEntry + 1) & mask;
+  // If the element is not in the index
+  if (index->_entries[iEntry]._elem == NULL)
+    // Nothing to do
+    return;
+  // Empty the entry
+  index->_entries[iEntry]._elem = NULL;
+  free(index->_entries[iEntry]._incident);
+  --(index->_nbElem);
+  // Shift back the following entries of the same cluster which would 
+  // not be reachable anymore from their hash position
+  int jEntry = (iEntry + 1) & mask;
+  while (index->_entries[jEntry]._elem != NULL) {
+    // Get the hash position of the entry
+    int hEntry = SpringSysIndexHash(index->_entries[jEntry]._id, 
+      index->_size);
+    // If the hash position is not cyclically in ]iEntry, jEntry]
+    if ((jEntry > iEntry && (hEntry <= iEntry || hEntry > jEntry)) ||
+      (jEntry < iEntry && (hEntry <= iEntry && hEntry > jEntry))) {
+      // Move the entry into the hole
+      index->_entries[iEntry] = index->_entries[jEntry];
+      index->_entries[jEntry]._elem = NULL;
+      iEntry = jEntry;
+    }
+    // Move to the next entry
+    jEntry = (jEntry + 1) & mask;
+  }
+}
+
+// Enlarge if necessary the hash table of the index 'index' so that 
+// 'nb' more elements can be added without resizing it
+// Return false if memory allocation failed, else return true
+static bool SpringSysIndexReserve(SpringSysIndex *index, int nb) {
+  // Get the size keeping the load of the hash table under one half 
+  // (cf SpringSysIndexAdd)
+  long size = index->_size;
+  while (2 * ((long)(index->_nbElem) + nb) > size)
+    size *= 2;
+  // If the hash table is large enough, nothing to do
+  if (size == index->_size)
+    return true;
+  // If the size is too large
+  if (size > (1L << 30))
+    // Return false
+    return false;
+  // Resize the hash table
+  return SpringSysIndexResize(index, (int)size);
+}
+
+// Initialize the empty pool 'pool' of records of 'size' bytes
+static void SpringSysPoolInit(SpringSysPool *pool, size_t size) {
+  // Round up the size of records to hold the pointer chaining them 
+  // once released and keep them aligned
+  pool->_size = 
+    (size + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*);
+  pool->_slab = NULL;
+  pool->_slabNb = SPRINGSYS_POOL_MINSLAB;
+  pool->_next = NULL;
+  pool->_nbNext = 0;
+  pool->_free = NULL;
+  pool->_nbFree = 0;
+}
+
+// Release all the slabs of the pool 'pool', and the records in them,
+// leaving the pool empty
+static void SpringSysPoolFree(SpringSysPool *pool) {
+  // Free the slabs
+  while (pool->_slab != NULL) {
+    void *slab = pool->_slab;
+    pool->_slab = *(void**)slab;
+    free(slab);
+  }
+  // Reset the pool
+  SpringSysPoolInit(pool, pool->_size);
+}
+
+// Get a record from the pool 'pool', released or never used
+// Return NULL if memory allocation failed
+static void* SpringSysPoolAlloc(SpringSysPool *pool) {
+  // If there is a released record
+  if (pool->_free != NULL) {
+    // Reuse it
+    void *rec = pool->_free;
+    pool->_free = *(void**)rec;
+    --(pool->_nbFree);
+    return rec;
+  }
+  // If all the records of the last slab are used
+  if (pool->_nbNext == 0) {
+    // Allocate a new slab, and double the size of the next one
+    if (!SpringSysPoolAddSlab(pool, pool->_slabNb))
+      return NULL;
+    if (pool->_slabNb < SPRINGSYS_POOL_MAXSLAB)
+      pool->_slabNb *= 2;
+  }
+  // Use the next record of the last slab
+  void *rec = pool->_next;
+  pool->_next += pool->_size;
+  --(pool->_nbNext);
+  return rec;
+}
+
+// Release the record 'rec' of the pool 'pool' for reuse
+static void SpringSysPoolRelease(SpringSysPool *pool, void *rec) {
+  // Check arguments
+  if (rec == NULL)
+    return;
+  // Add the record to the released records
+  *(void**)rec = pool->_free;
+  pool->_free = rec;
+  ++(pool->_nbFree);
+}
+
+// Allocate if necessary a slab in the pool 'pool' so that 'nb' 
+// records can be got without further allocation
+// Return false if memory allocation failed, else return true
+static bool SpringSysPoolReserve(SpringSysPool *pool, int nb) {
+  // Get the number of records available
+  int nbAvailable = pool->_nbFree + pool->_nbNext;
+  // If there are enough records, nothing to do
+  if (nb <= nbAvailable)
+    return true;
+  // Allocate a slab for the missing records
+  return SpringSysPoolAddSlab(pool, nb - nbAvailable);
+}
+
+// Allocate a new slab of 'nb' records in the pool 'pool', the records
+// never used of the previous slab are released
+// Return false if memory allocation failed, else return true
+static bool SpringSysPoolAddSlab(SpringSysPool *pool, int nb) {
+  // Allocate memory for the slab, its first bytes chain it to the 
+  // previous one
+  char *slab = (char*)malloc(sizeof(void*) + pool->_size * (size_t)nb);
+  // If we couldn't allocate memory
+  if (slab == NULL)
+    // Return false
+    return false;
+  *(void**)slab = pool->_slab;
+  pool->_slab = slab;
+  // Release the records never used of the previous slab
+  for (; pool->_nbNext > 0; --(pool->_nbNext)) {
+    SpringSysPoolRelease(pool, pool->_next);
+    pool->_next += pool->_size;
+  }
+  // Use the records of the new slab
+  pool->_next = slab + sizeof(void*);
+  pool->_nbNext = nb;
+  // Return true
+  return true;
+}
+
+// Add the spring 's' to the springs connected to its masses in the 
+// index of masses of the SpringSys 'sys'
+// Return false if memory allocation failed, else return true
+static bool SpringSysAttachSpring(SpringSys *sys, SpringSysSpring *s) {
+  // For each extremity of the spring
+  for (int iMass = 0; iMass < 2; ++iMass) {
+    // Get the entry of the mass, if the mass doesn't exist there is
+    // nothing to update
+    SpringSysIndexEntry *entry = 
+      SpringSysIndexGetEntry(sys->_massIndex, s->_mass[iMass]);
+    if (entry == NULL)
+      continue;
+    // Enlarge the array of springs connected to the mass if necessary
+    if (entry->_nbIncident == entry->_incidentSize) {
+      int size = 2 * entry->_incidentSize + 4;
+      SpringSysSpring **incident = (SpringSysSpring**)realloc(
+        entry->_incident, sizeof(SpringSysSpring*) * size);
+      // If we couldn't allocate memory
+      if (incident == NULL) {
+        // Disconnect the spring from the other mass if it has been
+        // connected
+        SpringSysDetachSpring(sys, s);
+        // Return false
+        return false;
+      }
+      entry->_incident = incident;
+      entry->_incidentSize = size;
+    }
+    // Add the spring
+    entry->_incident[(entry->_nbIncident)++] = s;
+  }
+  // Return true
+  return true;
+}
+
+// Remove the spring 's' from the springs connected to its masses in 
+// the index of masses of the SpringSys 'sys'
+static void SpringSysDetachSpring(SpringSys *sys, SpringSysSpring *s) {
+  // For each extremity of the spring
+  for (int iMass = 0; iMass < 2; ++iMass) {
+    // Get the entry of the mass
+    SpringSysIndexEntry *entry = 
+      SpringSysIndexGetEntry(sys->_massIndex, s->_mass[iMass]);
+    if (entry == NULL)
+      continue;
+    // Search the spring and replace it with the last one
+    for (int iSpring = 0; iSpring < entry->_nbIncident; ++iSpring) {
+      if (entry->_incident[iSpring] == s) {
+        entry->_incident[iSpring] = 
+          entry->_incident[--(entry->_nbIncident)];
+        break;
+      }
+    }
+  }
+}
+
+// Get the 'iSpring'-th spring connected to the mass identified by 'id'
+// in the SpringSys 'sys'
+// Return NULL if arguments are invalid or if there is no mass with 
+// this id
+static SpringSysSpring* SpringSysGetIncident(SpringSys *sys, int id,
+  int iSpring) {
+  // Check arguments
+  if (sys == NULL)
+    return NULL;
+  // Get the entry of the mass
+  SpringSysIndexEntry *entry = 
+    SpringSysIndexGetEntry(sys->_massIndex, id);
+  // If there is no mass with this id or no such spring
+  if (entry == NULL || iSpring < 0 || iSpring >= entry->_nbIncident)
+    // Return NULL
+    return NULL;
+  // Return the spring
+  return entry->_incident[iSpring];
+}
+
+// Create the packed arrays for 'nbMass' masses and 'nbSpring' springs
+// in 'nbDim' dimensions
+// Return NULL if memory allocation failed
+static SpringSysSoA* SpringSysSoACreate(int nbDim, int nbMass, 
+  int nbSpring) {
+  // Allocate memory for the packed arrays, pointers are null until
+  // their array is allocated
+  SpringSysSoA *ret = (SpringSysSoA*)calloc(1, sizeof(SpringSysSoA));
+  // If we couldn't allocate memory
+  if (ret == NULL)
+    // Return NULL
+    return NULL;
+  // Set the number of masses and springs
+  ret->_nbMass = nbMass;
+  ret->_nbSpring = nbSpring;
+  ret->_nbMassOut = 0;
+  ret->_nbSpringOut = 0;
+  ret->_allOut = false;
+  // Allocate memory for the arrays (at least one element to get 
+  // non null pointers for empty SpringSys)
+  int nM = (nbMass > 0 ? nbMass : 1);
+  int nS = (nbSpring > 0 ? nbSpring : 1);
+  ret->_massId = (int*)malloc(sizeof(int) * nM);
+  ret->_pos = (float*)malloc(sizeof(float) * nM * nbDim);
+  ret->_speed = (float*)malloc(sizeof(float) * nM * nbDim);
+  ret->_stress = (float*)malloc(sizeof(float) * nM * nbDim);
+  ret->_invMass = (float*)malloc(sizeof(float) * nM);
+  ret->_fixed = (bool*)malloc(sizeof(bool) * nM);
+  ret->_massRec = (SpringSysMass**)malloc(sizeof(SpringSysMass*) * nM);
+  ret->_massOut = (bool*)calloc(nM, sizeof(bool));
+  ret->_massOutList = (int*)malloc(sizeof(int) * nM);
+  ret->_springId = (int*)malloc(sizeof(int) * nS);
+  ret->_springMass = (int*)malloc(sizeof(int) * nS * 2);
+  ret->_k = (float*)malloc(sizeof(float) * nS);
+  ret->_restLength = (float*)malloc(sizeof(float) * nS);
+  ret->_length = (float*)malloc(sizeof(float) * nS);
+  ret->_springStress = (float*)malloc(sizeof(float) * nS);
+  ret->_maxStress = (float*)malloc(sizeof(float) * nS * 2);
+  ret->_breakable = (bool*)malloc(sizeof(bool) * nS);
+  ret->_springRec = 
+    (SpringSysSpring**)malloc(sizeof(SpringSysSpring*) * nS);
+  ret->_springOut = (bool*)calloc(nS, sizeof(bool));
+  ret->_springOutList = (int*)malloc(sizeof(int) * nS);
+  // If we couldn't allocate one of the arrays
+  if (ret->_massId == NULL || ret->_pos == NULL || 
+    ret->_speed == NULL || ret->_stress == NULL || 
+    ret->_invMass == NULL || ret->_fixed == NULL || 
+    ret->_massRec == NULL || ret->_massOut == NULL || 
+    ret->_massOutList == NULL || ret->_springId == NULL || 
+    ret->_springMass == NULL || ret->_k == NULL || 
+    ret->_restLength == NULL || ret->_length == NULL || 
+    ret->_springStress == NULL || ret->_maxStress == NULL || 
+    ret->_breakable == NULL || ret->_springRec == NULL || 
+    ret->_springOut == NULL || ret->_springOutList == NULL)
+    // Free memory
+    SpringSysSoAFree(&ret);
+  // Return the new packed arrays
+  return ret;  
+}
+
+// Free the memory used by the packed arrays 'soa'
+static void SpringSysSoAFree(SpringSysSoA **soa) {
+  // Check arguments
+  if (soa == NULL || *soa == NULL)
+    return;
+  // Free memory
+  free((*soa)->_massId);
+  free((*soa)->_pos);
+  free((*soa)->_speed);
+  free((*soa)->_stress);
+  free((*soa)->_invMass);
+  free((*soa)->_fixed);
+  free((*soa)->_massRec);
+  free((*soa)->_massOut);
+  free((*soa)->_massOutList);
+  free((*soa)->_springId);
+  free((*soa)->_springMass);
+  free((*soa)->_k);
+  free((*soa)->_restLength);
+  free((*soa)->_length);
+  free((*soa)->_springStress);
+  free((*soa)->_maxStress);
+  free((*soa)->_breakable);
+  free((*soa)->_springRec);
+  free((*soa)->_springOut);
+  free((*soa)->_springOutList);
+  free((*soa)->_rowStart);
+  free((*soa)->_breakMin);
+  free((*soa)->_breakMax);
+  free((*soa)->_force);
+  free((*soa)->_springColor);
+  free((*soa)->_colorStart);
+  free((*soa)->_integBuf);
+  free((*soa)->_adaptBuf);
+  free((*soa)->_brokenFlag);
+  free((*soa)->_gridStart);
+  free((*soa)->_gridMass);
+  free((*soa)->_bvhSpring);
+  free((*soa)->_bvhNode);
+  free((*soa)->_bvhBox);
+  free((*soa)->_hashStart);
+  free((*soa)->_hashMass);
+  free((*soa)->_hashCoord);
+  free((*soa)->_hashPos);
+  free((*soa)->_adjStart);
+  free((*soa)->_adjMass);
+  SpringSysSoAFreeIslands(*soa);
+  free(*soa);
+  *soa = NULL;
+}
+
+// Copy the state of the mass at position 'iMass' in the packed arrays
+// 'soa' of a SpringSys with 'nbDim' dimensions from its record
+static inline void SpringSysSoAReadMass(SpringSysSoA *soa, int nbDim,
+  int iMass) {
+  SpringSysMass *m = soa->_massRec[iMass];
+  float invMass = 1.0 / (1.0 + m->_mass);
+  // Check if the mass has been moved, or its inertia or speed modified
+  bool moved = 
+    (invMass != soa->_invMass[iMass] || m->_fixed != soa->_fixed[iMass]);
+  bool pushed = false;
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    if (m->_pos[iDim] != soa->_pos[iMass * nbDim + iDim])
+      moved = true;
+    if (m->_speed[iDim] != soa->_speed[iMass * nbDim + iDim])
+      pushed = true;
+  }
+  // If the mass has been moved or its inertia modified, the stress of
+  // masses doesn't match the forces of springs anymore, nor the 
+  // structures searching masses and springs by position
+  if (moved) {
+    soa->_stressValid = false;
+    SpringSysSoAMoved(soa);
+  }
+  // If the mass has been modified, wake up its island
+  if ((moved || pushed) && soa->_massIsland != NULL)
+    SpringSysSoAWakeMass(soa, iMass);
+  soa->_massId[iMass] = m->_id;
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    soa->_pos[iMass * nbDim + iDim] = m->_pos[iDim];
+    soa->_speed[iMass * nbDim + iDim] = m->_speed[iDim];
+    soa->_stress[iMass * nbDim + iDim] = m->_stress[iDim];
+  }
+  soa->_invMass[iMass] = invMass;
+  soa->_fixed[iMass] = m->_fixed;
+}
+
+// Copy the state of the spring at position 'iSpring' in the packed 
+// arrays 'soa' from its record
+static inline void SpringSysSoAReadSpring(SpringSysSoA *soa, 
+  int iSpring) {
+  SpringSysSpring *s = soa->_springRec[iSpring];
+  // If the spring has been modified, the stress of masses doesn't 
+  // match the forces of springs anymore
+  if (s->_k != soa->_k[iSpring] || 
+    s->_restLength != soa->_restLength[iSpring] ||
+    s->_maxStress[0] != soa->_maxStress[2 * iSpring] ||
+    s->_maxStress[1] != soa->_maxStress[2 * iSpring + 1] ||
+    s->_breakable != soa->_breakable[iSpring]) {
+    soa->_stressValid = false;
+    // Wake up the island of the spring
+    if (soa->_springIsland != NULL)
+      SpringSysSoAWakeIsland(soa, soa->_springIsland[iSpring]);
+  }
+  soa->_springId[iSpring] = s->_id;
+  soa->_k[iSpring] = s->_k;
+  soa->_restLength[iSpring] = s->_restLength;
+  soa->_length[iSpring] = s->_length;
+  soa->_springStress[iSpring] = s->_stress;
+  soa->_maxStress[2 * iSpring] = s->_maxStress[0];
+  soa->_maxStress[2 * iSpring + 1] = s->_maxStress[1];
+  soa->_breakable[iSpring] = s->_breakable;
+  // If the SpringSys is compiled, update the limits of stress 
+  if (soa->_breakMin != NULL) {
+    soa->_breakMin[iSpring] = (s->_breakable ? s->_maxStress[0] : -INFINITY);
+    soa->_breakMax[iSpring] = (s->_breakable ? s->_maxStress[1] : INFINITY);
+  }
+}
+
+// Pack the masses and springs of the SpringSys 'sys' into new arrays
+// Return false if memory allocation failed or the springs refer to 
+// unknown masses, else return true
+static bool SpringSysSoAPack(SpringSys *sys) {
+  // Allocate memory for the packed arrays
+  SpringSysSoA *soa = SpringSysSoACreate(sys->_nbDim, 
+    sys->_masses->_nbElem, sys->_springs->_nbElem);
+  // If we couldn't allocate memory
+  if (soa == NULL)
+    // Return false
+    return false;
+  // Pack the masses in the order of the GSet
+  int iMass = 0;
+  GSetElem *e = sys->_masses->_head;
+  while (e != NULL) {
+    SpringSysMass *m = (SpringSysMass*)(e->_data);
+    soa->_massRec[iMass] = m;
+    SpringSysSoAReadMass(soa, sys->_nbDim, iMass);
+    // If this mass is the one indexed for its id, memorize its 
+    // position in the index
+    SpringSysIndexEntry *entry = 
+      SpringSysIndexGetEntry(sys->_massIndex, m->_id);
+    if (entry != NULL && entry->_elem == m)
+      entry->_slot = iMass;
+    ++iMass;
+    e = e->_next;
+  }
+  // Pack the springs in the order of the GSet
+  int iSpring = 0;
+  e = sys->_springs->_head;
+  while (e != NULL) {
+    SpringSysSpring *s = (SpringSysSpring*)(e->_data);
+    soa->_springRec[iSpring] = s;
+    SpringSysSoAReadSpring(soa, iSpring);
+    // Replace the ids of the masses at extremities by their position
+    for (int iMass = 0; iMass < 2; ++iMass) {
+      SpringSysIndexEntry *entry = 
+        SpringSysIndexGetEntry(sys->_massIndex, s->_mass[iMass]);
+      // If the mass doesn't exist
+      if (entry == NULL) {
+        // Free memory
+        SpringSysSoAFree(&soa);
+        // Return false
+        return false;
+      }
+      soa->_springMass[2 * iSpring + iMass] = entry->_slot;
+    }
+    ++iSpring;
+    e = e->_next;
+  }
+  // Attach the packed arrays to the SpringSys
+  sys->_soa = soa;
+  // Return true
+  return true;
+}
+
+// Update the records of the SpringSys 'sys' from its packed arrays and
+// release the packed arrays
+static void SpringSysSoAUnpack(SpringSys *sys) {
+  // If the SpringSys is not packed
+  if (sys->_soa == NULL)
+    // Nothing to do
+    return;
+  // Update the records
+  SpringSysSoAPullAll(sys);
+  // Release the packed arrays
+  SpringSysSoAFree(&(sys->_soa));
+}
+
+// Update the record of the mass at position 'iMass' in the packed
+// arrays of the SpringSys 'sys' and flag it as handed out
+static void SpringSysSoAPullMass(SpringSys *sys, int iMass) {
+  SpringSysSoA *soa = sys->_soa;
+  // If the record is already handed out, it's already up to date
+  if (soa->_allOut || soa->_massOut[iMass])
+    return;
+  // Update the dynamic properties of the record
+  SpringSysMass *m = soa->_massRec[iMass];
+  for (int iDim = 0; iDim < sys->_nbDim; ++iDim) {
+    m->_pos[iDim] = soa->_pos[iMass * sys->_nbDim + iDim];
+    m->_speed[iDim] = soa->_speed[iMass * sys->_nbDim + iDim];
+    m->_stress[iDim] = soa->_stress[iMass * sys->_nbDim + iDim];
+  }
+  // Flag the record as handed out
+  soa->_massOut[iMass] = true;
+  soa->_massOutList[(soa->_nbMassOut)++] = iMass;
+}
+
+// Update the record of the spring at position 'iSpring' in the packed
+// arrays of the SpringSys 'sys' and flag it as handed out
+static void SpringSysSoAPullSpring(SpringSys *sys, int iSpring) {
+  SpringSysSoA *soa = sys->_soa;
+  // If the record is already handed out, it's already up to date
+  if (soa->_allOut || soa->_springOut[iSpring])
+    return;
+  // Update the dynamic properties of the record
+  SpringSysSpring *s = soa->_springRec[iSpring];
+  s->_length = soa->_length[iSpring];
+  s->_stress = soa->_springStress[iSpring];
+  // Flag the record as handed out
+  soa->_springOut[iSpring] = true;
+  soa->_springOutList[(soa->_nbSpringOut)++] = iSpring;
+}
+
+// Update all the records of the SpringSys 'sys' from its packed arrays
+static void SpringSysSoAPullAll(SpringSys *sys) {
+  SpringSysSoA *soa = sys->_soa;
+  // If all the records are handed out, they are already up to date
+  if (soa->_allOut)
+    return;
+  // Update the records which are not handed out
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+    if (!soa->_massOut[iMass]) {
+      SpringSysMass *m = soa->_massRec[iMass];
+      for (int iDim = 0; iDim < sys->_nbDim; ++iDim) {
+        m->_pos[iDim] = soa->_pos[iMass * sys->_nbDim + iDim];
+        m->_speed[iDim] = soa->_speed[iMass * sys->_nbDim + iDim];
+        m->_stress[iDim] = soa->_stress[iMass * sys->_nbDim + iDim];
+      }
+    }
+  }
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+    if (!soa->_springOut[iSpring]) {
+      SpringSysSpring *s = soa->_springRec[iSpring];
+      s->_length = soa->_length[iSpring];
+      s->_stress = soa->_springStress[iSpring];
+    }
+  }
+}
+
+// Copy the records handed out of the SpringSys 'sys' into its packed 
+// arrays
+static void SpringSysSoAPush(SpringSys *sys) {
+  SpringSysSoA *soa = sys->_soa;
+  // If all the records are handed out
+  if (soa->_allOut) {
+    // Copy all the records
+    for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+      SpringSysSoAReadMass(soa, sys->_nbDim, iMass);
+    for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring)
+      SpringSysSoAReadSpring(soa, iSpring);
+    soa->_allOut = false;
+  }
+  // Copy the records in the lists of records handed out
+  for (int iOut = 0; iOut < soa->_nbMassOut; ++iOut) {
+    int iMass = soa->_massOutList[iOut];
+    SpringSysSoAReadMass(soa, sys->_nbDim, iMass);
+    soa->_massOut[iMass] = false;
+  }
+  soa->_nbMassOut = 0;
+  for (int iOut = 0; iOut < soa->_nbSpringOut; ++iOut) {
+    int iSpring = soa->_springOutList[iOut];
+    SpringSysSoAReadSpring(soa, iSpring);
+    soa->_springOut[iSpring] = false;
+  }
+  soa->_nbSpringOut = 0;
+}
+
+// Make the packed arrays of the SpringSys 'sys' ready for stepping, 
+// packing them if necessary
+// Return false if the SpringSys couldn't be packed, else return true
+static bool SpringSysSoAPrepare(SpringSys *sys) {
+  // If the SpringSys is not packed
+  if (sys->_soa == NULL)
+    // Pack it
+    return SpringSysSoAPack(sys);
+  // Else, copy the records handed out into the packed arrays
+  SpringSysSoAPush(sys);
+  // Return true
+  return true;
+}
+
+// Step in time by 'dt' the SpringSys 'sys' with 'nbDim' dimensions on
+// its packed arrays
+SPRINGSYS_KERNEL void SpringSysStepSoADim(SpringSys *sys, float dt,
+  int nbDim) {
+  SpringSysSoA *soa = sys->_soa;
+  // Declare a variable to memorize the observables of the step
+  SpringSysStats stats = {0};
+  // Reset the stress of unfixed masses
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    if (soa->_fixed[iMass] == false)
+      for (int iDim = 0; iDim < nbDim; ++iDim)
+        soa->_stress[iMass * nbDim + iDim] = 0.0;
+  // Declare a variable to memorize the number of ruptures
+  int nbRupture = 0;
+  // Update length and stress of each spring
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+    int iA = soa->_springMass[2 * iSpring];
+    int iB = soa->_springMass[2 * iSpring + 1];
+    float *pA = soa->_pos + iA * nbDim;
+    float *pB = soa->_pos + iB * nbDim;
+    // Get the distance between the masses
+    float l = 0.0;
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      l += (pA[iDim] - pB[iDim]) * (pA[iDim] - pB[iDim]);
+    l = sqrt(l);
+    soa->_length[iSpring] = l;
+    // Get the stress
+    float stress = (l - soa->_restLength[iSpring]) * soa->_k[iSpring];
+    soa->_springStress[iSpring] = stress;
+    // If the spring is breakable and its stress is over the limits
+    if (soa->_breakable[iSpring] == true &&
+      ((stress > 0.0 && stress >= soa->_maxStress[2 * iSpring + 1]) ||
+      (stress < 0.0 && stress <= soa->_maxStress[2 * iSpring]))) {
+      // Record its rupture and tombstone it, the packed arrays and the
+      // set of springs are compacted after the loop
+      SpringSysSoABreakSpring(sys, iSpring);
+      ++nbRupture;
+    // Else, the spring holds
+    } else {
+      // Add its stress to the observables
+      stats._stress += fabs(stress);
+      // Update the stress of the masses which are not fixed
+      if (soa->_fixed[iA] == false && 
+        l > SPRINGSYS_EPSILON * soa->_invMass[iA]) {
+        float f = stress * soa->_invMass[iA] / l;
+        for (int iDim = 0; iDim < nbDim; ++iDim)
+          soa->_stress[iA * nbDim + iDim] += f * (pB[iDim] - pA[iDim]);
+      }
+      if (soa->_fixed[iB] == false && 
+        l > SPRINGSYS_EPSILON * soa->_invMass[iB]) {
+        float f = stress * soa->_invMass[iB] / l;
+        for (int iDim = 0; iDim < nbDim; ++iDim)
+          soa->_stress[iB * nbDim + iDim] += f * (pA[iDim] - pB[iDim]);
+      }
+    }
+  }
+  // If there has been ruptures
+  if (nbRupture > 0)
+    // Remove the broken springs from the packed arrays
+    SpringSysSoARemoveBroken(sys);
+  // Apply speed to masses which are not fixed
+  double dissip = pow(1.0 - sys->_dissip, dt);
+  float maxForce = 0.0;
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+    float *speed = soa->_speed + iMass * nbDim;
+    if (soa->_fixed[iMass] == false) {
+      float *pos = soa->_pos + iMass * nbDim;
+      float *stress = soa->_stress + iMass * nbDim;
+      float f = 0.0;
+      for (int iDim = 0; iDim < nbDim; ++iDim) {
+        // Apply the dissipation to the speed
+        speed[iDim] *= dissip;
+        // Apply the stress to the speed
+        speed[iDim] += stress[iDim] * dt;
+        // Apply the speed to the position
+        pos[iDim] += speed[iDim] * dt;
+        f += stress[iDim] * stress[iDim];
+      }
+      // Update the highest force
+      f = sqrt(f) / soa->_invMass[iMass];
+      if (f > maxForce)
+        maxForce = f;
+    }
+    // Add the momentum and kinetic energy of the mass
+    float v = 0.0;
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      v += speed[iDim] * speed[iDim];
+    stats._momentum += sqrt(v);
+    stats._kineticEnergy += 0.5 * v / soa->_invMass[iMass];
+  }
+  // Memorize the observables of the step
+  stats._maxForce = maxForce;
+  sys->_stats = stats;
+  sys->_statsValid = true;
+}
+
+// Reorder the 'nb' elements of size 'size' of the array 'arr' such as
+// the element at position i moves to position 'perm'[i], using 'tmp' 
+// (of same size as 'arr') as buffer
+static void SpringSysPermute(void *arr, size_t size, const int *perm,
+  int nb, void *tmp) {
+  for (int i = 0; i < nb; ++i)
+    memcpy((char*)tmp + perm[i] * size, (char*)arr + i * size, size);
+  memcpy(arr, tmp, nb * size);
+}
+
+// Move the spring at position 'first' + i in the packed arrays 'soa' to
+// the position 'first' + 'perm'[i], for i in [0, 'nb'[, using 'tmp' 
+// as buffer (2 pointers per spring)
+static void SpringSysSoAPermuteSprings(SpringSysSoA *soa, int first, 
+  int nb, const int *perm, void *tmp) {
+  // The hierarchy of springs won't match their positions anymore
+  soa->_bvhValid = false;
+  SpringSysPermute(soa->_springId + first, sizeof(int), perm, nb, tmp);
+  SpringSysPermute(soa->_springMass + 2 * first, 2 * sizeof(int), perm,
+    nb, tmp);
+  SpringSysPermute(soa->_k + first, sizeof(float), perm, nb, tmp);
+  SpringSysPermute(soa->_restLength + first, sizeof(float), perm, nb, 
+    tmp);
+  SpringSysPermute(soa->_length + first, sizeof(float), perm, nb, tmp);
+  SpringSysPermute(soa->_springStress + first, sizeof(float), perm, nb,
+    tmp);
+  SpringSysPermute(soa->_maxStress + 2 * first, 2 * sizeof(float), perm,
+    nb, tmp);
+  SpringSysPermute(soa->_breakable + first, sizeof(bool), perm, nb, 
+    tmp);
+  SpringSysPermute(soa->_springRec + first, sizeof(SpringSysSpring*), 
+    perm, nb, tmp);
+  if (soa->_breakMin != NULL) {
+    SpringSysPermute(soa->_breakMin + first, sizeof(float), perm, nb, 
+      tmp);
+    SpringSysPermute(soa->_breakMax + first, sizeof(float), perm, nb, 
+      tmp);
+  }
+  if (soa->_springColor != NULL)
+    SpringSysPermute(soa->_springColor + first, sizeof(int), perm, nb, 
+      tmp);
+  if (soa->_springIsland != NULL)
+    SpringSysPermute(soa->_springIsland + first, sizeof(int), perm, nb,
+      tmp);
+}
+
+// Orient and sort the springs of the packed arrays 'soa' as required
+// by the compiled topology and set _rowStart, which must be allocated
+// Return false if memory allocation failed, else return true
+static bool SpringSysSoASortSprings(SpringSysSoA *soa) {
+  int nS = (soa->_nbSpring > 0 ? soa->_nbSpring : 1);
+  // Allocate memory for the permutation and the buffer (large enough 
+  // for any of the arrays of springs)
+  int *perm = (int*)malloc(sizeof(int) * nS);
+  void *tmp = malloc(nS * 2 * sizeof(void*));
+  // If we couldn't allocate memory
+  if (perm == NULL || tmp == NULL) {
+    // Free memory
+    free(perm);
+    free(tmp);
+    // Return false
+    return false;
+  }
+  // Orient the springs from the lowest to the highest position, 
+  // swapping the extremities doesn't change the behaviour of the spring
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+    if (soa->_springMass[2 * iSpring] > soa->_springMass[2 * iSpring + 1]) {
+      int iMass = soa->_springMass[2 * iSpring];
+      soa->_springMass[2 * iSpring] = soa->_springMass[2 * iSpring + 1];
+      soa->_springMass[2 * iSpring + 1] = iMass;
+    }
+  }
+  // Count the springs of each row and get the first position of rows
+  SpringSysSoABuildRows(soa);
+  // Get the new position of each spring (counting sort, using the 
+  // first positions of rows as cursors)
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring)
+    perm[iSpring] = (soa->_rowStart[soa->_springMass[2 * iSpring]])++;
+  SpringSysSoABuildRows(soa);
+  // Move the springs to their new position
+  SpringSysSoAPermuteSprings(soa, 0, soa->_nbSpring, perm, tmp);
+  // Free memory
+  free(perm);
+  free(tmp);
+  // Return true
+  return true;
+}
+
+// Set the positions of the first spring of each row in the compiled 
+// packed arrays 'soa', whose springs are sorted
+static void SpringSysSoABuildRows(SpringSysSoA *soa) {
+  // Count the springs of each row
+  for (int iMass = 0; iMass <= soa->_nbMass; ++iMass)
+    soa->_rowStart[iMass] = 0;
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring)
+    ++(soa->_rowStart[soa->_springMass[2 * iSpring] + 1]);
+  // Convert the counts into positions
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    soa->_rowStart[iMass + 1] += soa->_rowStart[iMass];
+}
+
+// Remove from the packed arrays and the set of springs of the 
+// SpringSys 'sys' the springs broken during the step
+static void SpringSysSoARemoveBroken(SpringSys *sys) {
+  SpringSysSoA *soa = sys->_soa;
+  // The hierarchy of springs and the masses connected by springs 
+  // won't match them anymore
+  soa->_bvhValid = false;
+  soa->_adjValid = false;
+  // Move the remaining springs toward the beginning of the arrays
+  int jSpring = 0;
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+    if (soa->_springRec[iSpring] != NULL) {
+      if (jSpring != iSpring) {
+        soa->_springId[jSpring] = soa->_springId[iSpring];
+        soa->_springMass[2 * jSpring] = soa->_springMass[2 * iSpring];
+        soa->_springMass[2 * jSpring + 1] = 
+          soa->_springMass[2 * iSpring + 1];
+        soa->_k[jSpring] = soa->_k[iSpring];
+        soa->_restLength[jSpring] = soa->_restLength[iSpring];
+        soa->_length[jSpring] = soa->_length[iSpring];
+        soa->_springStress[jSpring] = soa->_springStress[iSpring];
+        soa->_maxStress[2 * jSpring] = soa->_maxStress[2 * iSpring];
+        soa->_maxStress[2 * jSpring + 1] = 
+          soa->_maxStress[2 * iSpring + 1];
+        soa->_breakable[jSpring] = soa->_breakable[iSpring];
+        soa->_springRec[jSpring] = soa->_springRec[iSpring];
+        if (soa->_breakMin != NULL) {
+          soa->_breakMin[jSpring] = soa->_breakMin[iSpring];
+          soa->_breakMax[jSpring] = soa->_breakMax[iSpring];
+        }
+        if (soa->_springColor != NULL)
+          soa->_springColor[jSpring] = soa->_springColor[iSpring];
+        if (soa->_springIsland != NULL)
+          soa->_springIsland[jSpring] = soa->_springIsland[iSpring];
+      }
+      ++jSpring;
+    }
+  }
+  soa->_nbSpring = jSpring;
+  // If the springs are sorted by rows, update the rows (springs are 
+  // still sorted)
+  if (soa->_rowStart != NULL)
+    SpringSysSoABuildRows(soa);
+  // If the springs are sorted by color classes, update the classes
+  if (soa->_springColor != NULL)
+    SpringSysSoABuildColors(soa);
+  // If the springs are sorted by islands, update the islands
+  if (soa->_springIsland != NULL)
+    SpringSysSoABuildIslandStarts(soa);
+  // Remove the broken springs from the set of springs
+  SpringSysRemoveTombstones(sys);
+}
+
+// Return true if the Euler step of the compiled SpringSys 'sys' must
+// use its islands, else false
+static bool SpringSysUseIslands(SpringSys *sys) {
+  SpringSysSoA *soa = sys->_soa;
+  // Islands are not used by adaptive steps
+  if (soa->_deferRupture)
+    return false;
+  // Islands are needed to sleep
+  if (sys->_sleepMomentum > 0.0)
+    return true;
+  // Else, they are only useful to share the work between threads
+  if (sys->_nbThread < 2)
+    return false;
+  // If the springs are sorted by color classes, try the islands again
+  // only once enough springs broke since
+  if (soa->_springColor != NULL)
+    return (soa->_nbBrokenSinceColor > 0 &&
+      (long)(soa->_nbBrokenSinceColor) * SPRINGSYS_ISLAND_RETRY >=
+      soa->_nbSpring);
+  // Return true
+  return true;
+}
+
+// Step in time by 'dt' the islands awake of the compiled snapshot of 
+// the SpringSys 'sys' with the Euler scheme, and put asleep the ones
+// which stayed under the thresholds of sleep long enough
+// Return false if the islands couldn't be created, or if they are not
+// used to sleep and don't share the work evenly enough between the
+// threads, else true
+static bool SpringSysStepIslands(SpringSys *sys, float dt) {
+  SpringSysSoA *soa = sys->_soa;
+  int nbDim = sys->_nbDim;
+  bool sleep = (sys->_sleepMomentum > 0.0);
+  // Create the threads if necessary
+  if (sys->_nbThread > 1 && sys->_threadPool == NULL)
+    sys->_threadPool = SpringSysThreadPoolCreate(sys->_nbThread);
+  // Without sleep the islands are only useful on several threads
+  if (sleep == false && sys->_threadPool == NULL)
+    return false;
+  // Create the islands if necessary
+  if ((soa->_massIsland == NULL || soa->_islandDirty) && 
+    !SpringSysSoABuildIslands(sys))
+    return false;
+  // Assign the islands to the threads if necessary
+  int nbThread = (sys->_threadPool != NULL ? sys->_nbThread : 1);
+  if (soa->_islandNbThread != nbThread) {
+    float load = SpringSysSoAAssignIslands(soa, nbThread);
+    // If the islands are not used to sleep and the threads would be
+    // unbalanced, step with the color classes instead
+    if (sleep == false && load >= SPRINGSYS_ISLAND_MAXLOAD) {
+      SpringSysSoAFreeIslands(soa);
+      return false;
+    }
+  }
+  // The stress of masses won't match their positions anymore
+  soa->_stressValid = false;
+  // If fixed masses have been moved, wake up the islands asleep 
+  // connected to them
+  if (soa->_massWakeAny) {
+    for (int iIsland = 0; iIsland < soa->_nbIsland; ++iIsland) {
+      if (soa->_islandAsleep[iIsland]) {
+        for (int iSpring = soa->_islandSpringStart[iIsland]; 
+          iSpring < soa->_islandSpringStart[iIsland + 1]; ++iSpring) {
+          if (soa->_massWake[soa->_springMass[2 * iSpring]] || 
+            soa->_massWake[soa->_springMass[2 * iSpring + 1]]) {
+            SpringSysSoAWakeIsland(soa, iIsland);
+            break;
+          }
+        }
+      }
+    }
+    memset(soa->_massWake, 0, sizeof(bool) * soa->_nbMass);
+    soa->_massWakeAny = false;
+  }
+  // Reset the forces applied on the fixed masses, which receive the 
+  // forces of springs of all the islands
+  int first = soa->_islandMassStart[soa->_nbIsland];
+  memset(soa->_force + first * nbDim, 0, 
+    sizeof(float) * (soa->_nbMass - first) * nbDim);
+  // Step the islands, each thread its own ones
+  SpringSysParallelStep step = {
+    ._sys = sys, ._dt = dt, ._nbRupture = NULL, ._stats = NULL
+  };
+  if (nbThread > 1)
+    SpringSysThreadPoolRun(sys->_threadPool, SpringSysStepIslandsJob,
+      &step);
+  else
+    SpringSysStepIslandsJob(&step, 0, 1);
+  // Step the island of fixed masses, whose springs between fixed
+  // masses share their masses with the other islands
+  SpringSysStepIsland(sys, dt, soa->_nbIsland,
+    SpringSysGetSpringPass(sys));
+  // Get the observables, the number of islands asleep and the number
+  // of ruptures, and release the broken springs
+  SpringSysStats stats = {0};
+  int nbSleeping = 0;
+  int nbRupture = 0;
+  for (int iIsland = 0; iIsland <= soa->_nbIsland; ++iIsland) {
+    SpringSysStats *islandStats = soa->_islandStats + iIsland;
+    stats._stress += islandStats->_stress;
+    SpringSysStatsAddMasses(&stats, islandStats->_momentum,
+      islandStats->_kineticEnergy, islandStats->_maxForce);
+    if (soa->_islandAsleep[iIsland])
+      ++nbSleeping;
+    if (soa->_islandRupture[iIsland] > 0) {
+      nbRupture += soa->_islandRupture[iIsland];
+      for (int iSpring = soa->_islandSpringStart[iIsland];
+        iSpring < soa->_islandSpringStart[iIsland + 1]; ++iSpring)
+        if (SpringSysSoAIsBroken(soa, iSpring))
+          SpringSysSoABreakSpring(sys, iSpring);
+    }
+  }
+  // Memorize the observables of the step and the number of islands
+  sys->_stats = stats;
+  sys->_statsValid = true;
+  sys->_nbIslandActive = soa->_nbIsland - nbSleeping;
+  sys->_nbIslandSleeping = nbSleeping;
+  // If there has been ruptures
+  if (nbRupture > 0) {
+    // Remove the broken springs from the snapshot and split the
+    // islands they were holding together
+    SpringSysSoARemoveBroken(sys);
+    SpringSysSoASplitIslands(sys);
+  }
+  // Return true
+  return true;
+}
+
+// Step in time the islands of the compiled snapshot of a SpringSys,
+// the ones of the thread 'iThread' among 'nbThread', 'arg' is a
+// SpringSysParallelStep
+static void SpringSysStepIslandsJob(void *arg, int iThread,
+  int nbThread) {
+  SpringSysParallelStep *step = (SpringSysParallelStep*)arg;
+  SpringSys *sys = step->_sys;
+  SpringSysSoA *soa = sys->_soa;
+  SpringSysSpringPass pass = SpringSysGetSpringPass(sys);
+  for (int iIsland = 0; iIsland < soa->_nbIsland; ++iIsland)
+    if (nbThread == 1 || soa->_islandThread[iIsland] == iThread)
+      SpringSysStepIsland(sys, step->_dt, iIsland, pass);
+}
+
+// Step in time by 'dt' the island at position 'iIsland' of the
+// compiled snapshot of the SpringSys 'sys', unless it's asleep,
+// applying the forces of its springs with 'pass', and put it asleep if
+// it stayed under the thresholds of sleep long enough. Its observables
+// and number of ruptures are memorized, broken springs are not
+// released. The forces on fixed masses must have been reset.
+static void SpringSysStepIsland(SpringSys *sys, float dt, int iIsland,
+  SpringSysSpringPass pass) {
+  SpringSysSoA *soa = sys->_soa;
+  int nbDim = sys->_nbDim;
+  soa->_islandRupture[iIsland] = 0;
+  // If the island is asleep, its masses are at rest and its springs
+  // keep their stress
+  if (soa->_islandAsleep[iIsland])
+    return;
+  // Reset the forces applied on the unfixed masses of the island
+  int first = soa->_islandMassStart[iIsland];
+  int last = soa->_islandMassStart[iIsland + 1];
+  if (iIsland < soa->_nbIsland)
+    memset(soa->_force + first * nbDim, 0,
+      sizeof(float) * (last - first) * nbDim);
+  // Apply the forces of its springs and step its masses
+  SpringSysStats *stats = soa->_islandStats + iIsland;
+  memset(stats, 0, sizeof(SpringSysStats));
+  int nb = pass(sys, soa->_islandSpringStart[iIsland],
+    soa->_islandSpringStart[iIsland + 1], false, &(stats->_stress));
+  sys->_dimKernels->_integrate(sys, dt, first, last, stats);
+  soa->_islandRupture[iIsland] = nb;
+  // If the island can fall asleep
+  if (sys->_sleepMomentum > 0.0 && iIsland < soa->_nbIsland) {
+    // Count the consecutive steps under the thresholds
+    if (nb == 0 && stats->_momentum <= sys->_sleepMomentum &&
+      stats->_maxForce <= sys->_sleepForce)
+      ++(soa->_islandCalm[iIsland]);
+    else
+      soa->_islandCalm[iIsland] = 0;
+    // If the island stayed under the thresholds long enough
+    if (soa->_islandCalm[iIsland] >= SPRINGSYS_SLEEP_NBSTEP) {
+      // Put it asleep, its masses stop
+      soa->_islandAsleep[iIsland] = true;
+      memset(soa->_speed + first * nbDim, 0,
+        sizeof(float) * (last - first) * nbDim);
+      stats->_momentum = 0.0;
+      stats->_kineticEnergy = 0.0;
+    }
+  }
+}
+
+// Partition the masses and springs of the compiled snapshot of the 
+// SpringSys 'sys' into islands, all awake, and sort them by island
+// Return false if memory allocation failed, else return true
+static bool SpringSysSoABuildIslands(SpringSys *sys) {
+  SpringSysSoA *soa = sys->_soa;
+  // Release the current islands
+  SpringSysSoAFreeIslands(soa);
+  int nM = (soa->_nbMass > 0 ? soa->_nbMass : 1);
+  int nS = (soa->_nbSpring > 0 ? soa->_nbSpring : 1);
+  int nMax = (nM > nS ? nM : nS);
+  // Allocate memory for the islands of masses and springs, and for 
+  // the disjoint sets, the permutation and the buffer (large enough 
+  // for any of the arrays of masses and springs)
+  soa->_massIsland = (int*)malloc(sizeof(int) * nM);
+  soa->_springIsland = (int*)malloc(sizeof(int) * nS);
+  soa->_massWake = (bool*)calloc(nM, sizeof(bool));
+  int *root = (int*)malloc(sizeof(int) * nM);
+  int *perm = (int*)malloc(sizeof(int) * nMax);
+  void *tmp = malloc(nMax * 2 * sizeof(void*));
+  // If we couldn't allocate memory
+  if (soa->_massIsland == NULL || soa->_springIsland == NULL || 
+    soa->_massWake == NULL || root == NULL || perm == NULL || 
+    tmp == NULL) {
+    // Free memory
+    SpringSysSoAFreeIslands(soa);
+    free(root);
+    free(perm);
+    free(tmp);
+    // Return false
+    return false;
+  }
+  // Merge the sets of the unfixed masses connected by springs, the 
+  // representative of a set is its mass with the lowest position
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    root[iMass] = iMass;
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+    int iA = soa->_springMass[2 * iSpring];
+    int iB = soa->_springMass[2 * iSpring + 1];
+    if (soa->_fixed[iA] == false && soa->_fixed[iB] == false)
+      SpringSysUnion(root, iA, iB);
+  }
+  // Number the islands in the order of their representative, the 
+  // fixed masses are in the last island
+  int nbIsland = 0;
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+    if (soa->_fixed[iMass] == false) {
+      int iRoot = SpringSysUnionFind(root, iMass);
+      if (iRoot == iMass)
+        soa->_massIsland[iMass] = nbIsland++;
+      else
+        soa->_massIsland[iMass] = soa->_massIsland[iRoot];
+    }
+  }
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    if (soa->_fixed[iMass])
+      soa->_massIsland[iMass] = nbIsland;
+  soa->_nbIsland = nbIsland;
+  free(root);
+  // The island of a spring is the one of its unfixed masses
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+    int iA = soa->_springMass[2 * iSpring];
+    int iB = soa->_springMass[2 * iSpring + 1];
+    soa->_springIsland[iSpring] = 
+      soa->_massIsland[soa->_fixed[iA] ? iB : iA];
+  }
+  // Allocate memory for the positions and the state of islands
+  soa->_islandMassStart = (int*)malloc(sizeof(int) * (nbIsland + 2));
+  soa->_islandSpringStart = (int*)malloc(sizeof(int) * (nbIsland + 2));
+  // If we couldn't allocate memory
+  if (soa->_islandMassStart == NULL || soa->_islandSpringStart == NULL ||
+    !SpringSysSoAAllocIslandState(soa, nbIsland)) {
+    // Free memory
+    SpringSysSoAFreeIslands(soa);
+    free(perm);
+    free(tmp);
+    // Return false
+    return false;
+  }
+  // Count the masses and springs of each island and get the first 
+  // position of islands
+  SpringSysSoABuildIslandStarts(soa);
+  // Get the new position of each mass and spring (counting sort, using
+  // the first positions of islands as cursors) and move them
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    perm[iMass] = (soa->_islandMassStart[soa->_massIsland[iMass]])++;
+  SpringSysSoAPermuteMasses(sys, 0, soa->_nbMass, perm, 0,
+    soa->_nbSpring, tmp);
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring)
+    perm[iSpring] = 
+      (soa->_islandSpringStart[soa->_springIsland[iSpring]])++;
+  // The springs are not sorted by rows nor color classes anymore
+  free(soa->_rowStart);
+  soa->_rowStart = NULL;
+  free(soa->_springColor);
+  soa->_springColor = NULL;
+  free(soa->_colorStart);
+  soa->_colorStart = NULL;
+  soa->_nbColor = 0;
+  SpringSysSoAPermuteSprings(soa, 0, soa->_nbSpring, perm, tmp);
+  SpringSysSoABuildIslandStarts(soa);
+  // Free memory
+  free(perm);
+  free(tmp);
+  // All the islands are awake
+  soa->_islandDirty = false;
+  soa->_massWakeAny = false;
+  sys->_nbIslandActive = nbIsland;
+  sys->_nbIslandSleeping = 0;
+  // Return true
+  return true;
+}
+
+// Allocate the state of 'nbIsland' islands (plus the island of fixed
+// masses) of the compiled packed arrays 'soa', all awake, replacing
+// the current one, which is freed. The islands must be assigned to
+// threads again.
+// Return false if memory allocation failed, in which case the current
+// state is unchanged, else return true
+static bool SpringSysSoAAllocIslandState(SpringSysSoA *soa,
+  int nbIsland) {
+  // Allocate memory
+  int *calm = (int*)calloc(nbIsland + 1, sizeof(int));
+  bool *asleep = (bool*)calloc(nbIsland + 1, sizeof(bool));
+  SpringSysStats *stats =
+    (SpringSysStats*)calloc(nbIsland + 1, sizeof(SpringSysStats));
+  int *rupture = (int*)calloc(nbIsland + 1, sizeof(int));
+  int *thread = (int*)calloc(nbIsland + 1, sizeof(int));
+  // If we couldn't allocate memory
+  if (calm == NULL || asleep == NULL || stats == NULL ||
+    rupture == NULL || thread == NULL) {
+    // Free memory
+    free(calm);
+    free(asleep);
+    free(stats);
+    free(rupture);
+    free(thread);
+    // Return false
+    return false;
+  }
+  // Replace the current state
+  free(soa->_islandCalm);
+  free(soa->_islandAsleep);
+  free(soa->_islandStats);
+  free(soa->_islandRupture);
+  free(soa->_islandThread);
+  soa->_islandCalm = calm;
+  soa->_islandAsleep = asleep;
+  soa->_islandStats = stats;
+  soa->_islandRupture = rupture;
+  soa->_islandThread = thread;
+  soa->_islandNbThread = 0;
+  // Return true
+  return true;
+}
+
+// Release the islands of the compiled packed arrays 'soa'
+static void SpringSysSoAFreeIslands(SpringSysSoA *soa) {
+  free(soa->_massIsland);
+  free(soa->_springIsland);
+  free(soa->_islandMassStart);
+  free(soa->_islandSpringStart);
+  free(soa->_islandCalm);
+  free(soa->_islandAsleep);
+  free(soa->_islandStats);
+  free(soa->_islandRupture);
+  free(soa->_islandThread);
+  free(soa->_massWake);
+  soa->_massIsland = NULL;
+  soa->_springIsland = NULL;
+  soa->_islandMassStart = NULL;
+  soa->_islandSpringStart = NULL;
+  soa->_islandCalm = NULL;
+  soa->_islandAsleep = NULL;
+  soa->_islandStats = NULL;
+  soa->_islandRupture = NULL;
+  soa->_islandThread = NULL;
+  soa->_massWake = NULL;
+  soa->_nbIsland = 0;
+  soa->_islandNbThread = 0;
+}
+
+// Set the positions of the first mass and spring of each island of 
+// the compiled packed arrays 'soa' from the islands of masses and 
+// springs
+static void SpringSysSoABuildIslandStarts(SpringSysSoA *soa) {
+  // Count the masses and springs of each island
+  for (int iIsland = 0; iIsland <= soa->_nbIsland + 1; ++iIsland) {
+    soa->_islandMassStart[iIsland] = 0;
+    soa->_islandSpringStart[iIsland] = 0;
+  }
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    ++(soa->_islandMassStart[soa->_massIsland[iMass] + 1]);
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring)
+    ++(soa->_islandSpringStart[soa->_springIsland[iSpring] + 1]);
+  // Convert the counts into positions
+  for (int iIsland = 0; iIsland <= soa->_nbIsland; ++iIsland) {
+    soa->_islandMassStart[iIsland + 1] += soa->_islandMassStart[iIsland];
+    soa->_islandSpringStart[iIsland + 1] += 
+      soa->_islandSpringStart[iIsland];
+  }
+}
+
+// Split the islands of the compiled snapshot of the SpringSys 'sys'
+// whose springs broke at the last step into their connected parts,
+// the parts of an island follow each other and are awake. If memory
+// allocation failed, the islands are released and will be created
+// again at the next step.
+static void SpringSysSoASplitIslands(SpringSys *sys) {
+  SpringSysSoA *soa = sys->_soa;
+  int nbIsland = soa->_nbIsland;
+  int nM = (soa->_nbMass > 0 ? soa->_nbMass : 1);
+  int nS = (soa->_nbSpring > 0 ? soa->_nbSpring : 1);
+  int nMax = (nM > nS ? nM : nS);
+  // Allocate memory for the number of parts of each island, and for
+  // the buffers of SpringSysSoASplitIsland
+  int *nbPart = (int*)malloc(sizeof(int) * (nbIsland + 1));
+  int *buf = (int*)malloc(sizeof(int) * (3 * nMax + 1));
+  void *tmp = malloc(nMax * 2 * sizeof(void*));
+  // If we couldn't allocate memory
+  if (nbPart == NULL || buf == NULL || tmp == NULL) {
+    // Free memory
+    free(nbPart);
+    free(buf);
+    free(tmp);
+    // Release the islands
+    SpringSysSoAFreeIslands(soa);
+    return;
+  }
+  // Split the islands whose springs broke
+  int nbNew = nbIsland;
+  nbPart[nbIsland] = 1;
+  for (int iIsland = 0; iIsland < nbIsland; ++iIsland) {
+    nbPart[iIsland] = (soa->_islandRupture[iIsland] > 0 ?
+      SpringSysSoASplitIsland(sys, iIsland, buf, tmp) : 1);
+    nbNew += nbPart[iIsland] - 1;
+  }
+  free(buf);
+  free(tmp);
+  // If no island has been split, nothing else to do
+  if (nbNew == nbIsland) {
+    free(nbPart);
+    return;
+  }
+  // Memorize the current state of the islands before allocating the
+  // new one
+  int *calm = soa->_islandCalm;
+  bool *asleep = soa->_islandAsleep;
+  SpringSysStats *stats = soa->_islandStats;
+  soa->_islandCalm = NULL;
+  soa->_islandAsleep = NULL;
+  soa->_islandStats = NULL;
+  int *massStart = (int*)malloc(sizeof(int) * (nbNew + 2));
+  int *springStart = (int*)malloc(sizeof(int) * (nbNew + 2));
+  // If we couldn't allocate memory
+  if (massStart == NULL || springStart == NULL ||
+    !SpringSysSoAAllocIslandState(soa, nbNew)) {
+    // Free memory
+    free(nbPart);
+    free(calm);
+    free(asleep);
+    free(stats);
+    free(massStart);
+    free(springStart);
+    // Release the islands
+    SpringSysSoAFreeIslands(soa);
+    return;
+  }
+  // Number the new islands, the parts of the island i (numbered -1 - p
+  // by SpringSysSoASplitIsland) follow each other, and copy the state
+  // of the islands which haven't been split
+  int iNew = 0;
+  for (int iIsland = 0; iIsland <= nbIsland; ++iIsland) {
+    bool split = (nbPart[iIsland] > 1);
+    for (int iMass = soa->_islandMassStart[iIsland];
+      iMass < soa->_islandMassStart[iIsland + 1]; ++iMass)
+      soa->_massIsland[iMass] =
+        iNew + (split ? -1 - soa->_massIsland[iMass] : 0);
+    for (int iSpring = soa->_islandSpringStart[iIsland];
+      iSpring < soa->_islandSpringStart[iIsland + 1]; ++iSpring)
+      soa->_springIsland[iSpring] =
+        iNew + (split ? -1 - soa->_springIsland[iSpring] : 0);
+    if (split == false) {
+      soa->_islandCalm[iNew] = calm[iIsland];
+      soa->_islandAsleep[iNew] = asleep[iIsland];
+      soa->_islandStats[iNew] = stats[iIsland];
+    }
+    iNew += nbPart[iIsland];
+  }
+  // Replace the positions of islands
+  free(soa->_islandMassStart);
+  free(soa->_islandSpringStart);
+  soa->_islandMassStart = massStart;
+  soa->_islandSpringStart = springStart;
+  soa->_nbIsland = nbNew;
+  SpringSysSoABuildIslandStarts(soa);
+  // Free memory
+  free(nbPart);
+  free(calm);
+  free(asleep);
+  free(stats);
+}
+
+// Sort the masses and springs of the island at position 'iIsland' in
+// the compiled snapshot of the SpringSys 'sys' by connected part,
+// using 'buf' (3 integers per mass or spring plus one) and 'tmp' (2
+// pointers per mass or spring) as buffers. If there are several parts
+// the island of its masses and springs is set to -1 - p, where p is
+// the index of their part.
+// Return the number of parts
+static int SpringSysSoASplitIsland(SpringSys *sys, int iIsland,
+  int *buf, void *tmp) {
+  SpringSysSoA *soa = sys->_soa;
+  int nM = (soa->_nbMass > 0 ? soa->_nbMass : 1);
+  int nS = (soa->_nbSpring > 0 ? soa->_nbSpring : 1);
+  int nMax = (nM > nS ? nM : nS);
+  int firstMass = soa->_islandMassStart[iIsland];
+  int nbMass = soa->_islandMassStart[iIsland + 1] - firstMass;
+  int firstSpring = soa->_islandSpringStart[iIsland];
+  int nbSpring = soa->_islandSpringStart[iIsland + 1] - firstSpring;
+  int *root = buf;
+  int *part = buf + nMax + 1;
+  int *perm = part + nMax;
+  // Merge the sets of the masses of the island connected by springs,
+  // the masses out of the island are fixed
+  for (int iMass = 0; iMass < nbMass; ++iMass)
+    root[iMass] = iMass;
+  for (int iSpring = firstSpring; iSpring < firstSpring + nbSpring;
+    ++iSpring) {
+    unsigned int iA = soa->_springMass[2 * iSpring] - firstMass;
+    unsigned int iB = soa->_springMass[2 * iSpring + 1] - firstMass;
+    if (iA < (unsigned int)nbMass && iB < (unsigned int)nbMass)
+      SpringSysUnion(root, iA, iB);
+  }
+  // Number the parts in the order of their representative
+  int nb = 0;
+  for (int iMass = 0; iMass < nbMass; ++iMass) {
+    int iRoot = SpringSysUnionFind(root, iMass);
+    part[iMass] = (iRoot == iMass ? nb++ : part[iRoot]);
+  }
+  // If the island is still connected, nothing else to do
+  if (nb == 1)
+    return 1;
+  // The part of a spring is the one of its unfixed masses
+  for (int iSpring = firstSpring; iSpring < firstSpring + nbSpring;
+    ++iSpring) {
+    unsigned int iA = soa->_springMass[2 * iSpring] - firstMass;
+    int iMass = (iA < (unsigned int)nbMass ? (int)iA :
+      soa->_springMass[2 * iSpring + 1] - firstMass);
+    soa->_springIsland[iSpring] = -1 - part[iMass];
+  }
+  // Get the new position of each mass (counting sort, using the first
+  // positions of parts as cursors) and move them
+  SpringSysCountingSort(part, nbMass, nb, root, perm);
+  SpringSysSoAPermuteMasses(sys, firstMass, nbMass, perm, firstSpring,
+    firstSpring + nbSpring, tmp);
+  for (int iMass = 0; iMass < nbMass; ++iMass)
+    soa->_massIsland[firstMass + perm[iMass]] = -1 - part[iMass];
+  // Same for the springs
+  for (int iSpring = 0; iSpring < nbSpring; ++iSpring)
+    part[iSpring] = -1 - soa->_springIsland[firstSpring + iSpring];
+  SpringSysCountingSort(part, nbSpring, nb, root, perm);
+  SpringSysSoAPermuteSprings(soa, firstSpring, nbSpring, perm, tmp);
+  // Return the number of parts
+  return nb;
+}
+
+// Set 'perm'[i] to the position of the element i after sorting the
+// 'nb' elements by their key 'key'[i] in [0, 'nbKey'[, keeping their
+// order for equal keys, using 'count' ('nbKey' + 1 integers) as buffer
+static void SpringSysCountingSort(const int *key, int nb, int nbKey,
+  int *count, int *perm) {
+  for (int iKey = 0; iKey <= nbKey; ++iKey)
+    count[iKey] = 0;
+  for (int i = 0; i < nb; ++i)
+    ++(count[key[i] + 1]);
+  for (int iKey = 0; iKey < nbKey; ++iKey)
+    count[iKey + 1] += count[iKey];
+  for (int i = 0; i < nb; ++i)
+    perm[i] = (count[key[i]])++;
+}
+
+// Assign the islands of the compiled packed arrays 'soa' to 'nbThread'
+// threads, the islands connected through a fixed mass to the same
+// thread, sharing their masses and springs between the threads (the
+// largest groups of islands first, each to the least busy thread)
+// Return the ratio between the work of the busiest thread and the
+// average work of threads (INFINITY if memory allocation failed, in
+// which case all the islands are assigned to the first thread)
+static float SpringSysSoAAssignIslands(SpringSysSoA *soa,
+  int nbThread) {
+  int nbIsland = soa->_nbIsland;
+  int firstFixed = soa->_islandMassStart[nbIsland];
+  int nbNode = nbIsland + soa->_nbMass - firstFixed;
+  // Assign all the islands to the first thread
+  soa->_islandNbThread = nbThread;
+  for (int iIsland = 0; iIsland <= nbIsland; ++iIsland)
+    soa->_islandThread[iIsland] = 0;
+  if (nbThread == 1 || nbIsland <= 1)
+    return (nbThread == 1 ? 1.0 : (float)nbThread);
+  // Allocate memory for the disjoint sets of islands and fixed masses,
+  // the work of the groups of islands and the groups
+  int *root = (int*)malloc(sizeof(int) * nbNode);
+  long *work = (long*)malloc(sizeof(long) * nbIsland);
+  SpringSysIslandGroup *group =
+    (SpringSysIslandGroup*)malloc(sizeof(SpringSysIslandGroup) *
+    nbIsland);
+  // If we couldn't allocate memory
+  if (root == NULL || work == NULL || group == NULL) {
+    // Free memory
+    free(root);
+    free(work);
+    free(group);
+    // Return the worst balance
+    return INFINITY;
+  }
+  // Merge the sets of the islands and the fixed masses connected by
+  // springs, the representative of a group of islands is its lowest 
+  // island
+  for (int iNode = 0; iNode < nbNode; ++iNode)
+    root[iNode] = iNode;
+  for (int iSpring = 0; iSpring < soa->_islandSpringStart[nbIsland];
+    ++iSpring) {
+    for (int iEnd = 0; iEnd < 2; ++iEnd) {
+      int iMass = soa->_springMass[2 * iSpring + iEnd];
+      if (soa->_fixed[iMass])
+        SpringSysUnion(root, soa->_springIsland[iSpring],
+          nbIsland + iMass - firstFixed);
+    }
+  }
+  // Get the work (number of masses and springs) of each group
+  for (int iIsland = 0; iIsland < nbIsland; ++iIsland)
+    work[iIsland] = 0;
+  for (int iIsland = 0; iIsland < nbIsland; ++iIsland)
+    work[SpringSysUnionFind(root, iIsland)] += 
+      soa->_islandMassStart[iIsland + 1] - 
+      soa->_islandMassStart[iIsland] + 
+      soa->_islandSpringStart[iIsland + 1] - 
+      soa->_islandSpringStart[iIsland];
+  int nbGroup = 0;
+  long total = 0;
+  for (int iIsland = 0; iIsland < nbIsland; ++iIsland) {
+    if (root[iIsland] == iIsland) {
+      group[nbGroup]._root = iIsland;
+      group[nbGroup]._work = work[iIsland];
+      total += work[iIsland];
+      ++nbGroup;
+    }
+  }
+  // Give the groups, the largest first, to the least busy thread, the
+  // thread of a group replaces its work
+  qsort(group, nbGroup, sizeof(SpringSysIslandGroup), 
+    SpringSysIslandGroupCmp);
+  long load[nbThread];
+  for (int iThread = 0; iThread < nbThread; ++iThread)
+    load[iThread] = 0;
+  for (int iGroup = 0; iGroup < nbGroup; ++iGroup) {
+    int iThread = 0;
+    for (int jThread = 1; jThread < nbThread; ++jThread)
+      if (load[jThread] < load[iThread])
+        iThread = jThread;
+    load[iThread] += group[iGroup]._work;
+    work[group[iGroup]._root] = iThread;
+  }
+  for (int iIsland = 0; iIsland < nbIsland; ++iIsland)
+    soa->_islandThread[iIsland] = 
+      (int)work[SpringSysUnionFind(root, iIsland)];
+  // Free memory
+  free(root);
+  free(work);
+  free(group);
+  // Return the ratio between the busiest thread and the average
+  long maxLoad = 0;
+  for (int iThread = 0; iThread < nbThread; ++iThread)
+    if (load[iThread] > maxLoad)
+      maxLoad = load[iThread];
+  return (total > 0 ? (float)maxLoad * nbThread / (float)total : 1.0);
+}
+
+// Compare the groups of islands 'a' and 'b' to sort them by 
+// decreasing work, then increasing representative (cf qsort)
+static int SpringSysIslandGroupCmp(const void *a, const void *b) {
+  const SpringSysIslandGroup *gA = (const SpringSysIslandGroup*)a;
+  const SpringSysIslandGroup *gB = (const SpringSysIslandGroup*)b;
+  if (gA->_work != gB->_work)
+    return (gA->_work > gB->_work ? -1 : 1);
+  return (gA->_root < gB->_root ? -1 : (gA->_root > gB->_root));
+}
+
+// Move the mass at position 'first' + i in the packed arrays of the
+// SpringSys 'sys' to the position 'first' + 'perm'[i], for i in [0, 
+// 'nb'[, using 'tmp' as buffer (2 pointers per mass), and update the
+// springs at positions ['firstSpring', 'lastSpring'[, which must be 
+// the only ones attached to the moved masses. No record must be 
+// handed out.
+static void SpringSysSoAPermuteMasses(SpringSys *sys, int first, 
+  int nb, const int *perm, int firstSpring, int lastSpring, void *tmp) {
+  SpringSysSoA *soa = sys->_soa;
+  size_t size = sizeof(float) * sys->_nbDim;
+  int nbDim = sys->_nbDim;
+  SpringSysSoAMoved(soa);
+  // The masses connected by springs won't match the masses anymore
+  soa->_adjValid = false;
+  SpringSysPermute(soa->_massId + first, sizeof(int), perm, nb, tmp);
+  SpringSysPermute(soa->_pos + first * nbDim, size, perm, nb, tmp);
+  SpringSysPermute(soa->_speed + first * nbDim, size, perm, nb, tmp);
+  SpringSysPermute(soa->_stress + first * nbDim, size, perm, nb, tmp);
+  SpringSysPermute(soa->_force + first * nbDim, size, perm, nb, tmp);
+  SpringSysPermute(soa->_invMass + first, sizeof(float), perm, nb, 
+    tmp);
+  SpringSysPermute(soa->_fixed + first, sizeof(bool), perm, nb, tmp);
+  SpringSysPermute(soa->_massRec + first, sizeof(SpringSysMass*), perm,
+    nb, tmp);
+  if (soa->_massIsland != NULL)
+    SpringSysPermute(soa->_massIsland + first, sizeof(int), perm, nb, 
+      tmp);
+  // Update the positions of the masses at the extremities of springs
+  for (int i = 2 * firstSpring; i < 2 * lastSpring; ++i) {
+    unsigned int iMass = soa->_springMass[i] - first;
+    if (iMass < (unsigned int)nb)
+      soa->_springMass[i] = first + perm[iMass];
+  }
+  // Update the positions of masses in the index
+  for (int iMass = first; iMass < first + nb; ++iMass) {
+    SpringSysIndexEntry *entry = 
+      SpringSysIndexGetEntry(sys->_massIndex, soa->_massId[iMass]);
+    if (entry != NULL && entry->_elem == soa->_massRec[iMass])
+      entry->_slot = iMass;
+  }
+}
+
+// Return the representative of the set of 'i' in the disjoint sets 
+// 'root', halving the path from 'i' to the representative
+static inline int SpringSysUnionFind(int *root, int i) {
+  while (root[i] != i) {
+    root[i] = root[root[i]];
+    i = root[i];
+  }
+  return i;
+}
+
+// Merge the sets of 'a' and 'b' in the disjoint sets 'root', the 
+// representative of the union is the lowest of their representatives
+static inline void SpringSysUnion(int *root, int a, int b) {
+  a = SpringSysUnionFind(root, a);
+  b = SpringSysUnionFind(root, b);
+  if (a < b)
+    root[b] = a;
+  else if (b < a)
+    root[a] = b;
+}
+
+// Wake up the island at position 'iIsland' in the compiled packed 
+// arrays 'soa'
+static inline void SpringSysSoAWakeIsland(SpringSysSoA *soa, 
+  int iIsland) {
+  soa->_islandAsleep[iIsland] = false;
+  soa->_islandCalm[iIsland] = 0;
+}
+
+// Wake up the islands of the compiled packed arrays 'soa' affected by
+// the modification of the mass at position 'iMass', whose record 
+// hasn't been copied into the arrays yet
+static void SpringSysSoAWakeMass(SpringSysSoA *soa, int iMass) {
+  // If the mass has been fixed or unfixed, the islands must be created
+  // again
+  if (soa->_massRec[iMass]->_fixed != soa->_fixed[iMass]) {
+    soa->_islandDirty = true;
+  // Else, if the mass is fixed, the islands of its springs are woken up
+  // at the next step
+  } else if (soa->_fixed[iMass]) {
+    soa->_massWake[iMass] = true;
+    soa->_massWakeAny = true;
+  // Else, wake up its island
+  } else {
+    SpringSysSoAWakeIsland(soa, soa->_massIsland[iMass]);
+  }
+}
+
+// Step in time by 'dt' the SpringSys 'sys' on its compiled snapshot 
+static void SpringSysStepCompiled(SpringSys *sys, float dt) {
+  // The observables are calculated again by the step if it can
+  sys->_statsValid = false;
+  // The structures searching masses and springs by position won't 
+  // match the positions anymore
+  SpringSysSoAMoved(sys->_soa);
+  switch (sys->_integrator) {
+    case springSysIntegratorVerlet:
+      SpringSysStepVerlet(sys, dt);
+      break;
+    case springSysIntegratorRK4:
+      // If the buffers couldn't be allocated, fall back to Euler
+      if (!SpringSysStepRK4(sys, dt))
+        SpringSysApplyForces(sys, dt);
+      break;
+    case springSysIntegratorImplicit:
+      // If the buffers couldn't be allocated, fall back to Euler
+      if (!SpringSysStepImplicit(sys, dt))
+        SpringSysApplyForces(sys, dt);
+      break;
+    default:
+      // If islands are used (to sleep or to share the work between 
+      // threads, unless masses collide), step them, else (or if they
+      // couldn't be used) step all the masses
+      if (sys->_collideRadius > 0.0 || !SpringSysUseIslands(sys) || 
+        !SpringSysStepIslands(sys, dt))
+        SpringSysApplyForces(sys, dt);
+      break;
+  }
+}
+
+// Apply the forces of the springs of the compiled snapshot of the 
+// SpringSys 'sys' to its masses (into _force), on its threads if it 
+// has several, then if 'dt' is not null step the unfixed masses in 
+// time by 'dt' with the Euler scheme. Broken springs are removed from
+// the snapshot, or only flagged if ruptures are deferred.
+static void SpringSysApplyForces(SpringSys *sys, float dt) {
+  SpringSysSoA *soa = sys->_soa;
+  // The stress of masses won't match their positions anymore
+  soa->_stressValid = false;
+  // All the masses are stepped, wake up the islands asleep
+  if (soa->_islandAsleep != NULL && sys->_nbIslandSleeping > 0) {
+    for (int iIsland = 0; iIsland < soa->_nbIsland; ++iIsland)
+      SpringSysSoAWakeIsland(soa, iIsland);
+    sys->_nbIslandActive = soa->_nbIsland;
+    sys->_nbIslandSleeping = 0;
+  }
+  // Declare variables to memorize the number of ruptures and the 
+  // observables
+  int nbRupture = 0;
+  SpringSysStats stats = {0};
+  // If the masses collide, the forces of their contacts are added 
+  // after the ones of springs, hence the masses are moved here
+  bool collide = (sys->_collideRadius > 0.0);
+  // If the SpringSys uses several threads and they could apply the 
+  // forces, broken springs are left to this function
+  bool parallel = (sys->_nbThread > 1 && 
+    SpringSysStepParallel(sys, (collide ? 0.0 : dt), &nbRupture, 
+    &stats));
+  // Else
+  if (parallel == false) {
+    // Reset the forces applied on masses
+    memset(soa->_force, 0, sizeof(float) * soa->_nbMass * sys->_nbDim);
+    // Apply the forces of springs with the kernel of the SpringSys, 
+    // releasing the broken springs unless ruptures are deferred
+    nbRupture = SpringSysGetSpringPass(sys)(sys, 0, soa->_nbSpring, 
+      !(soa->_deferRupture), &(stats._stress));
+  }
+  // Apply the forces of contacts between masses if they collide
+  if (collide)
+    SpringSysSoACollide(sys);
+  // Apply the forces to the masses if requested and the threads 
+  // didn't
+  if (dt > 0.0 && (parallel == false || collide))
+    sys->_dimKernels->_integrate(sys, dt, 0, soa->_nbMass, &stats);
+  // If the masses have been stepped, memorize the observables of the
+  // step
+  if (dt > 0.0) {
+    sys->_stats = stats;
+    sys->_statsValid = true;
+  }
+  // If there has been ruptures
+  if (nbRupture > 0) {
+    // If the ruptures are deferred
+    if (soa->_deferRupture) {
+      // Flag the broken springs
+      for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring)
+        if (SpringSysSoAIsBroken(soa, iSpring))
+          soa->_brokenFlag[iSpring] = true;
+    } else {
+      // Release the broken springs if the threads didn't
+      if (parallel)
+        for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring)
+          if (SpringSysSoAIsBroken(soa, iSpring))
+            SpringSysSoABreakSpring(sys, iSpring);
+      // Remove the broken springs from the snapshot
+      SpringSysSoARemoveBroken(sys);
+      // Count them if the springs are sorted by color classes
+      if (soa->_springColor != NULL)
+        soa->_nbBrokenSinceColor += nbRupture;
+    }
+  }
+}
+
+// Add the forces of contacts between the masses of the compiled 
+// snapshot of the SpringSys 'sys' to their _force, on its threads if 
+// it has several and there are enough masses, and memorize the number
+// of contacts in _nbContact
+// Return false if memory allocation failed, in which case no force is
+// applied, else true
+static bool SpringSysSoACollide(SpringSys *sys) {
+  SpringSysSoA *soa = sys->_soa;
+  sys->_nbContact = 0;
+  // Get the masses connected by springs if necessary, and sort the 
+  // masses into the spatial hash, its cells are at least as large as 
+  // the distance of contact unless requested otherwise
+  float cell = (sys->_collideCell > 0.0 ? 
+    sys->_collideCell : 2.0 * sys->_collideRadius);
+  if ((soa->_adjValid == false && !SpringSysSoABuildAdjacency(soa)) ||
+    !SpringSysSoABuildHash(sys, cell))
+    return false;
+  // Apply the forces of contacts, on the threads if there are enough 
+  // masses and the threads could be created
+  int nbThread = 1;
+  if (sys->_nbThread > 1 && soa->_nbMass >= SPRINGSYS_COLLIDE_MINMASS) {
+    if (sys->_threadPool == NULL)
+      sys->_threadPool = SpringSysThreadPoolCreate(sys->_nbThread);
+    if (sys->_threadPool != NULL)
+      nbThread = sys->_nbThread;
+  }
+  int nbContact[nbThread];
+  SpringSysCollision collision = {._sys = sys, ._nbContact = nbContact};
+  if (nbThread > 1)
+    SpringSysThreadPoolRun(sys->_threadPool, 
+      sys->_dimKernels->_collide, &collision);
+  else
+    sys->_dimKernels->_collide(&collision, 0, 1);
+  // Get the number of contacts
+  for (int iThread = 0; iThread < nbThread; ++iThread)
+    sys->_nbContact += nbContact[iThread];
+  // Return true
+  return true;
+}
+
+// Sort the masses of the compiled snapshot of the SpringSys 'sys' into
+// the buckets of its spatial hash, with cells of size 'cell'
+// Return false if memory allocation failed, else true
+static bool SpringSysSoABuildHash(SpringSys *sys, float cell) {
+  SpringSysSoA *soa = sys->_soa;
+  int nbDim = sys->_nbDim;
+  int nbMass = soa->_nbMass;
+  // Allocate memory if necessary, with at least twice as many buckets
+  // as masses
+  int size = 1;
+  while (size < 2 * nbMass && size < (1 << 30))
+    size *= 2;
+  if (soa->_hashMass == NULL) {
+    soa->_hashMass = (int*)malloc(sizeof(int) * (nbMass + 1));
+    soa->_hashCoord = (int*)malloc(sizeof(int) * 3 * (nbMass + 1));
+    soa->_hashPos = (float*)malloc(sizeof(float) * nbDim * (nbMass + 1));
+  }
+  if (soa->_hashSize != size) {
+    free(soa->_hashStart);
+    soa->_hashStart = (int*)malloc(sizeof(int) * (size + 1));
+    soa->_hashSize = (soa->_hashStart != NULL ? size : 0);
+  }
+  // If we couldn't allocate memory
+  if (soa->_hashMass == NULL || soa->_hashCoord == NULL || 
+    soa->_hashPos == NULL || soa->_hashStart == NULL)
+    // Return false
+    return false;
+  // Get the box of the cells of masses, the buckets follow the cells in
+  // this box, hence neighbour cells are in neighbour buckets as long as
+  // the box doesn't have more cells than buckets
+  soa->_hashCell = cell;
+  int min[3] = {0, 0, 0};
+  int max[3] = {0, 0, 0};
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    for (int iMass = 0; iMass < nbMass; ++iMass) {
+      int x = SpringSysSoAHashCoord(soa, soa->_pos[iMass * nbDim + iDim]);
+      if (iMass == 0 || x < min[iDim])
+        min[iDim] = x;
+      if (iMass == 0 || x > max[iDim])
+        max[iDim] = x;
+    }
+  }
+  for (int iDim = 0; iDim < 3; ++iDim)
+    soa->_hashOrigin[iDim] = min[iDim];
+  soa->_hashStride[0] = 1;
+  soa->_hashStride[1] = (unsigned int)(max[0] - min[0]) + 1;
+  soa->_hashStride[2] = 
+    soa->_hashStride[1] * ((unsigned int)(max[1] - min[1]) + 1);
+  // Sort the masses by bucket (counting sort)
+  int *start = soa->_hashStart;
+  memset(start, 0, sizeof(int) * (size + 1));
+  int coord[3] = {0, 0, 0};
+  for (int iMass = 0; iMass < nbMass; ++iMass) {
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      coord[iDim] = 
+        SpringSysSoAHashCoord(soa, soa->_pos[iMass * nbDim + iDim]);
+    ++(start[SpringSysSoAHashBucket(soa, coord[0], coord[1], coord[2]) +
+      1]);
+  }
+  for (int iBucket = 0; iBucket < size; ++iBucket)
+    start[iBucket + 1] += start[iBucket];
+  for (int iMass = 0; iMass < nbMass; ++iMass) {
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      coord[iDim] = 
+        SpringSysSoAHashCoord(soa, soa->_pos[iMass * nbDim + iDim]);
+    int i = (start[SpringSysSoAHashBucket(soa, coord[0], coord[1], 
+      coord[2])])++;
+    // Copy the position and cell of the mass next to the ones of the 
+    // masses in the same bucket
+    soa->_hashMass[i] = iMass;
+    for (int iDim = 0; iDim < 3; ++iDim)
+      soa->_hashCoord[3 * i + iDim] = coord[iDim];
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      soa->_hashPos[i * nbDim + iDim] = soa->_pos[iMass * nbDim + iDim];
+  }
+  // The cursors are now at the first position of the next bucket
+  for (int iBucket = size; iBucket > 0; --iBucket)
+    start[iBucket] = start[iBucket - 1];
+  start[0] = 0;
+  // Return true
+  return true;
+}
+
+// Return the coordinate of the cell of the spatial hash of 'soa' 
+// containing the coordinate 'x', clamped to keep it in the range of 
+// integers
+static inline int SpringSysSoAHashCoord(const SpringSysSoA *soa, 
+  float x) {
+  float f = floor(x / soa->_hashCell);
+  if (!(f >= -1e9))
+    return -1000000000;
+  if (f > 1e9)
+    return 1000000000;
+  return (int)f;
+}
+
+// Return the bucket of the spatial hash of 'soa' of the cell at 
+// coordinates 'x', 'y', 'z'
+static inline int SpringSysSoAHashBucket(const SpringSysSoA *soa, 
+  int x, int y, int z) {
+  unsigned int h = 
+    (unsigned int)(x - soa->_hashOrigin[0]) * soa->_hashStride[0] + 
+    (unsigned int)(y - soa->_hashOrigin[1]) * soa->_hashStride[1] + 
+    (unsigned int)(z - soa->_hashOrigin[2]) * soa->_hashStride[2];
+  return (int)(h & (unsigned int)(soa->_hashSize - 1));
+}
+
+// Get the masses connected by a spring to each mass of the packed 
+// arrays 'soa'
+// Return false if memory allocation failed, else true
+static bool SpringSysSoABuildAdjacency(SpringSysSoA *soa) {
+  // Allocate memory
+  free(soa->_adjStart);
+  free(soa->_adjMass);
+  soa->_adjStart = (int*)malloc(sizeof(int) * (soa->_nbMass + 1));
+  soa->_adjMass = (int*)malloc(sizeof(int) * (2 * soa->_nbSpring + 1));
+  // If we couldn't allocate memory
+  if (soa->_adjStart == NULL || soa->_adjMass == NULL) {
+    // Free memory
+    free(soa->_adjStart);
+    free(soa->_adjMass);
+    soa->_adjStart = NULL;
+    soa->_adjMass = NULL;
+    // Return false
+    return false;
+  }
+  // Count the springs of each mass
+  int *start = soa->_adjStart;
+  memset(start, 0, sizeof(int) * (soa->_nbMass + 1));
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+    ++(start[soa->_springMass[2 * iSpring] + 1]);
+    ++(start[soa->_springMass[2 * iSpring + 1] + 1]);
+  }
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    start[iMass + 1] += start[iMass];
+  // Store the mass at the other extremity of each spring
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+    int iA = soa->_springMass[2 * iSpring];
+    int iB = soa->_springMass[2 * iSpring + 1];
+    soa->_adjMass[(start[iA])++] = iB;
+    soa->_adjMass[(start[iB])++] = iA;
+  }
+  // The cursors are now at the first position of the next mass
+  for (int iMass = soa->_nbMass; iMass > 0; --iMass)
+    start[iMass] = start[iMass - 1];
+  start[0] = 0;
+  soa->_adjValid = true;
+  // Return true
+  return true;
+}
+
+// Apply the forces of contacts with other masses to the unfixed masses
+// of the compiled snapshot of a SpringSys with 'nbDim' dimensions, the
+// part of the thread 'iThread' among 'nbThread', 'arg' is a 
+// SpringSysCollision
+SPRINGSYS_KERNEL void SpringSysCollideDim(void *arg, int iThread, 
+  int nbThread, int nbDim) {
+  SpringSysCollision *collision = (SpringSysCollision*)arg;
+  SpringSys *sys = collision->_sys;
+  SpringSysSoA *soa = sys->_soa;
+  float dist = 2.0 * sys->_collideRadius;
+  float k = sys->_collideK;
+  int nbContact = 0;
+  // For each unfixed mass of this thread, in the order of buckets 
+  // where the masses of a cell and of neighbour cells are close in 
+  // memory
+  int first = (int)((long)soa->_nbMass * iThread / nbThread);
+  int last = (int)((long)soa->_nbMass * (iThread + 1) / nbThread);
+  for (int iSorted = first; iSorted < last; ++iSorted) {
+    int iMass = soa->_hashMass[iSorted];
+    if (soa->_fixed[iMass])
+      continue;
+    const float *pos = soa->_hashPos + iSorted * nbDim;
+    float force[3] = {0.0, 0.0, 0.0};
+    // Get the cells overlapping the box of the masses which may be in 
+    // contact with this one
+    int lo[3] = {0, 0, 0};
+    int hi[3] = {0, 0, 0};
+    for (int iDim = 0; iDim < nbDim; ++iDim) {
+      lo[iDim] = SpringSysSoAHashCoord(soa, pos[iDim] - dist);
+      hi[iDim] = SpringSysSoAHashCoord(soa, pos[iDim] + dist);
+    }
+    // For each row of these cells along the first dimension
+    for (int z = lo[2]; z <= hi[2]; ++z) {
+      for (int y = lo[1]; y <= hi[1]; ++y) {
+        // Get the buckets of the first and last cells of the row, the 
+        // ones of the row follow each other unless they wrap around the
+        // buckets
+        int bucketLo = SpringSysSoAHashBucket(soa, lo[0], y, z);
+        int bucketHi = SpringSysSoAHashBucket(soa, hi[0], y, z);
+        bool contiguous = (bucketHi - bucketLo == hi[0] - lo[0]);
+        for (int x = lo[0]; x <= hi[0]; ++x) {
+          // For each mass in the buckets of the row (all at once if 
+          // they are contiguous) and in its cells (several cells may 
+          // share a bucket)
+          int jFirst = soa->_hashStart[contiguous ? bucketLo : 
+            SpringSysSoAHashBucket(soa, x, y, z)];
+          int jLast = soa->_hashStart[(contiguous ? bucketHi : 
+            SpringSysSoAHashBucket(soa, x, y, z)) + 1];
+          if (contiguous)
+            x = hi[0];
+          for (int j = jFirst; j < jLast; ++j) {
+            const int *coord = soa->_hashCoord + 3 * j;
+            if (j == iSorted || coord[0] < lo[0] || coord[0] > hi[0] ||
+              coord[1] != y || coord[2] != z || 
+              (!contiguous && coord[0] != x))
+              continue;
+            // If the masses are closer than the distance of contact
+            const float *posJ = soa->_hashPos + j * nbDim;
+            float v = 0.0;
+            for (int iDim = 0; iDim < nbDim; ++iDim)
+              v += (pos[iDim] - posJ[iDim]) * (pos[iDim] - posJ[iDim]);
+            if (v >= dist * dist || v <= 0.0)
+              continue;
+            // If they are not connected by a spring
+            int jMass = soa->_hashMass[j];
+            bool connected = false;
+            for (int i = soa->_adjStart[iMass]; 
+              !connected && i < soa->_adjStart[iMass + 1]; ++i)
+              connected = (soa->_adjMass[i] == jMass);
+            if (connected)
+              continue;
+            // Push the mass away from the other one
+            float d = sqrt(v);
+            float f = k * (dist - d) / d;
+            for (int iDim = 0; iDim < nbDim; ++iDim)
+              force[iDim] += f * (pos[iDim] - posJ[iDim]);
+            // Count the contact once
+            if (jMass > iMass || soa->_fixed[jMass])
+              ++nbContact;
+          }
+        }
+      }
+    }
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      soa->_force[iMass * nbDim + iDim] += force[iDim];
+  }
+  // Memorize the number of contacts
+  collision->_nbContact[iThread] = nbContact;
+}
+
+// Return true if the stress of the spring at position 'iSpring' in 
+// the compiled packed arrays 'soa' is over its limits, else false
+static inline bool SpringSysSoAIsBroken(const SpringSysSoA *soa, 
+  int iSpring) {
+  return (soa->_springStress[iSpring] <= soa->_breakMin[iSpring] ||
+    soa->_springStress[iSpring] >= soa->_breakMax[iSpring]);
+}
+
+// Set the stress of the unfixed masses of the compiled snapshot of the
+// SpringSys 'sys' to their acceleration from the forces of springs
+static void SpringSysSoAUpdateStress(SpringSys *sys) {
+  SpringSysSoA *soa = sys->_soa;
+  int nbDim = sys->_nbDim;
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    if (soa->_fixed[iMass] == false)
+      for (int iDim = 0; iDim < nbDim; ++iDim)
+        soa->_stress[iMass * nbDim + iDim] = 
+          soa->_force[iMass * nbDim + iDim] * soa->_invMass[iMass];
+}
+
+// Step in time by 'dt' the SpringSys 'sys' on its compiled snapshot 
+// with the Velocity Verlet integrator
+static void SpringSysStepVerlet(SpringSys *sys, float dt) {
+  SpringSysSoA *soa = sys->_soa;
+  int nbDim = sys->_nbDim;
+  // If the acceleration at the current positions isn't known from the
+  // previous step
+  if (soa->_stressValid == false) {
+    // Evaluate it
+    SpringSysApplyForces(sys, 0.0);
+    SpringSysSoAUpdateStress(sys);
+  }
+  // Get the dissipation over half the step, applied before and after 
+  // the step
+  float dissip = pow(1.0 - sys->_dissip, 0.5 * dt);
+  // Apply half the acceleration to the speed and the speed to the 
+  // position of unfixed masses
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+    if (soa->_fixed[iMass] == false) {
+      for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i) {
+        soa->_speed[i] = soa->_speed[i] * dissip + 
+          soa->_stress[i] * 0.5 * dt;
+        soa->_pos[i] += soa->_speed[i] * dt;
+      }
+    }
+  }
+  // Evaluate the acceleration at the new positions
+  SpringSysApplyForces(sys, 0.0);
+  SpringSysSoAUpdateStress(sys);
+  // Apply the other half of the acceleration to the speed
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    if (soa->_fixed[iMass] == false)
+      for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i)
+        soa->_speed[i] = 
+          (soa->_speed[i] + soa->_stress[i] * 0.5 * dt) * dissip;
+  // The acceleration can be reused by the next step
+  soa->_stressValid = true;
+}
+
+// Step in time by 'dt' the SpringSys 'sys' on its compiled snapshot 
+// with the RK4 integrator
+// Return false if memory allocation failed, else return true
+static bool SpringSysStepRK4(SpringSys *sys, float dt) {
+  SpringSysSoA *soa = sys->_soa;
+  int nb = soa->_nbMass * sys->_nbDim;
+  int nbDim = sys->_nbDim;
+  // Get the buffers: position and speed at the beginning of the step,
+  // weighted sums of the speeds and accelerations of the stages
+  float *pos0 = SpringSysSoAGetIntegBuf(soa, 4 * nb);
+  if (pos0 == NULL)
+    return false;
+  float *speed0 = pos0 + nb;
+  float *sumSpeed = speed0 + nb;
+  float *sumStress = sumSpeed + nb;
+  // Apply the dissipation over half the step, it is applied before and
+  // after the step
+  float dissip = pow(1.0 - sys->_dissip, 0.5 * dt);
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    if (soa->_fixed[iMass] == false)
+      for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i)
+        soa->_speed[i] *= dissip;
+  memcpy(pos0, soa->_pos, sizeof(float) * nb);
+  memcpy(speed0, soa->_speed, sizeof(float) * nb);
+  memset(sumSpeed, 0, sizeof(float) * 2 * nb);
+  // Weights of the stages and delta of time to the next stage
+  const float weight[4] = {1.0, 2.0, 2.0, 1.0};
+  const float delta[3] = {0.5 * dt, 0.5 * dt, dt};
+  // For each stage
+  for (int iStage = 0; iStage < 4; ++iStage) {
+    // Evaluate the acceleration at the positions of the stage
+    SpringSysApplyForces(sys, 0.0);
+    SpringSysSoAUpdateStress(sys);
+    // For each unfixed mass
+    for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+      if (soa->_fixed[iMass] == false) {
+        for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i) {
+          // Add the speed and acceleration of the stage to the sums
+          sumSpeed[i] += weight[iStage] * soa->_speed[i];
+          sumStress[i] += weight[iStage] * soa->_stress[i];
+          // Move to the position and speed of the next stage
+          if (iStage < 3) {
+            soa->_pos[i] = pos0[i] + delta[iStage] * soa->_speed[i];
+            soa->_speed[i] = 
+              speed0[i] + delta[iStage] * soa->_stress[i];
+          }
+        }
+      }
+    }
+  }
+  // Apply the weighted sums to the position and speed
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+    if (soa->_fixed[iMass] == false) {
+      for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i) {
+        soa->_pos[i] = pos0[i] + dt / 6.0 * sumSpeed[i];
+        soa->_speed[i] = 
+          (speed0[i] + dt / 6.0 * sumStress[i]) * dissip;
+      }
+    }
+  }
+  // Return true
+  return true;
+}
+
+// Get the buffers of the integrators of the compiled packed arrays 
+// 'soa', with at least 'size' values
+// Return NULL if memory allocation failed
+static float* SpringSysSoAGetIntegBuf(SpringSysSoA *soa, int size) {
+  // If the current buffers are too small
+  if (soa->_integBufSize < size) {
+    // Replace them
+    free(soa->_integBuf);
+    soa->_integBufSize = 0;
+    soa->_integBuf = (float*)malloc(sizeof(float) * size);
+    if (soa->_integBuf == NULL)
+      return NULL;
+    soa->_integBufSize = size;
+  }
+  // Return the buffers
+  return soa->_integBuf;
+}
+
+// Step in time the compiled SpringSys 'sys' by a step of at most 
+// 'dtMax' whose length is adapted to keep its local error, estimated
+// by step doubling, below 'tol'
+// Return the length of the step, or 0.0 if memory allocation failed
+static float SpringSysStepAdaptive(SpringSys *sys, float dtMax, 
+  float tol) {
+  SpringSysSoA *soa = sys->_soa;
+  int nbDim = sys->_nbDim;
+  int nb = soa->_nbMass * nbDim;
+  // Allocate memory for the saved state (position, speed and stress of
+  // masses at the beginning of the step, then position and speed at 
+  // the end of the single step) and the flags of ruptures
+  if (soa->_adaptBuf == NULL)
+    soa->_adaptBuf = (float*)malloc(sizeof(float) * 5 * 
+      (nb > 0 ? nb : 1));
+  if (soa->_brokenFlag == NULL)
+    soa->_brokenFlag = (bool*)calloc(
+      (soa->_nbSpring > 0 ? soa->_nbSpring : 1), sizeof(bool));
+  if (soa->_adaptBuf == NULL || soa->_brokenFlag == NULL)
+    return 0.0;
+  float *state = soa->_adaptBuf;
+  float *single = state + 3 * nb;
+  // Get the order of the integrator, the error of the two half steps 
+  // is the difference with the single step divided by (2^order - 1)
+  int order = 1;
+  if (sys->_integrator == springSysIntegratorVerlet)
+    order = 2;
+  else if (sys->_integrator == springSysIntegratorRK4)
+    order = 4;
+  float richardson = 1.0 / (float)((1 << order) - 1);
+  // Save the state at the beginning of the step
+  SpringSysSoASaveState(soa, nbDim, state, false);
+  bool stressValid = soa->_stressValid;
+  // Ruptures are applied only once the step is accepted
+  soa->_deferRupture = true;
+  // Declare a variable to memorize if a step has been rejected
+  bool rejected = false;
+  // Loop until the step is accepted
+  while (true) {
+    // Get the length of the step
+    float dt = (sys->_adaptDt < dtMax ? sys->_adaptDt : dtMax);
+    // Step once by dt and memorize the result
+    SpringSysStepCompiled(sys, dt);
+    memcpy(single, soa->_pos, sizeof(float) * nb);
+    memcpy(single + nb, soa->_speed, sizeof(float) * nb);
+    // Go back to the beginning of the step and step twice by dt / 2
+    SpringSysSoASaveState(soa, nbDim, state, true);
+    soa->_stressValid = stressValid;
+    memset(soa->_brokenFlag, 0, sizeof(bool) * soa->_nbSpring);
+    SpringSysStepCompiled(sys, 0.5 * dt);
+    SpringSysStepCompiled(sys, 0.5 * dt);
+    // Estimate the error on the position of unfixed masses (speeds are
+    // converted into positions over the step)
+    float err = 0.0;
+    for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+      if (soa->_fixed[iMass] == false) {
+        for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i) {
+          float e = fabs(soa->_pos[i] - single[i]);
+          if (!(e <= err))
+            err = e;
+          e = fabs(soa->_speed[i] - single[nb + i]) * dt;
+          if (!(e <= err))
+            err = e;
+        }
+      }
+    }
+    err *= richardson;
+    // Get the ratio to the length of the next step
+    float scale = SPRINGSYS_ADAPT_MAXSCALE;
+    if (err != err)
+      scale = SPRINGSYS_ADAPT_MINSCALE;
+    else if (err > 0.0)
+      scale = SPRINGSYS_ADAPT_SAFETY * 
+        pow(tol / err, 1.0 / (float)(order + 1));
+    if (scale < SPRINGSYS_ADAPT_MINSCALE)
+      scale = SPRINGSYS_ADAPT_MINSCALE;
+    if (scale > SPRINGSYS_ADAPT_MAXSCALE)
+      scale = SPRINGSYS_ADAPT_MAXSCALE;
+    // If the error is within the tolerance, or the step can't get 
+    // shorter
+    if (err <= tol || dt <= SPRINGSYS_EPSILON) {
+      // Apply the ruptures which occured during the step
+      soa->_deferRupture = false;
+      bool rupture = false;
+      for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+        if (soa->_brokenFlag[iSpring]) {
+          SpringSysSoABreakSpring(sys, iSpring);
+          soa->_brokenFlag[iSpring] = false;
+          rupture = true;
+        }
+      }
+      if (rupture) {
+        SpringSysSoARemoveBroken(sys);
+        soa->_stressValid = false;
+        sys->_statsValid = false;
+      }
+      // Update the length of the next step, without growing right 
+      // after a rejection, and unless this one was shortened to reach 
+      // 'dtMax' and could have been longer
+      if (rejected && scale > 1.0)
+        scale = 1.0;
+      if (dt < sys->_adaptDt && scale >= 1.0)
+        scale = sys->_adaptDt / dt;
+      sys->_adaptDt = dt * scale;
+      ++(sys->_nbStepAccepted);
+      // Return the length of the step
+      return dt;
+    }
+    // Else, the step is rejected, go back to the beginning of the step
+    // and retry with a shorter one
+    SpringSysSoASaveState(soa, nbDim, state, true);
+    soa->_stressValid = stressValid;
+    memset(soa->_brokenFlag, 0, sizeof(bool) * soa->_nbSpring);
+    sys->_adaptDt = dt * scale;
+    ++(sys->_nbStepRejected);
+    rejected = true;
+  }
+}
+
+// Save the state of the masses of the compiled packed arrays 'soa' 
+// with 'nbDim' dimensions into 'state', or restore it from 'state' 
+// if 'restore' is true
+static void SpringSysSoASaveState(SpringSysSoA *soa, int nbDim, 
+  float *state, bool restore) {
+  int nb = soa->_nbMass * nbDim;
+  float *arrays[3] = {soa->_pos, soa->_speed, soa->_stress};
+  for (int iArr = 0; iArr < 3; ++iArr) {
+    if (restore)
+      memcpy(arrays[iArr], state + iArr * nb, sizeof(float) * nb);
+    else
+      memcpy(state + iArr * nb, arrays[iArr], sizeof(float) * nb);
+  }
+}
+
+// Step in time by 'dt' the SpringSys 'sys' on its compiled snapshot 
+// with the implicit integrator
+// Return false if memory allocation failed, else return true
+static bool SpringSysStepImplicit(SpringSys *sys, float dt) {
+  SpringSysSoA *soa = sys->_soa;
+  int nbDim = sys->_nbDim;
+  int nb = soa->_nbMass * nbDim;
+  // Get the buffers: axis (_nbDim values per spring) and stiffness 
+  // coefficients (2 per spring) of springs, then right-hand side, 
+  // diagonal of the system, change of speed, residual, preconditioned
+  // residual, search direction and its product by the system 
+  float *axis = SpringSysSoAGetIntegBuf(soa, 
+    soa->_nbSpring * (nbDim + 2) + 7 * nb);
+  if (axis == NULL)
+    return false;
+  // Apply the forces of springs at the current positions, broken 
+  // springs are removed
+  SpringSysApplyForces(sys, 0.0);
+  float *coef = axis + soa->_nbSpring * nbDim;
+  float *rhs = coef + 2 * soa->_nbSpring;
+  float *diag = rhs + nb;
+  float *dv = diag + nb;
+  float *res = dv + nb;
+  float *z = res + nb;
+  float *dir = z + nb;
+  float *prod = dir + nb;
+  // Apply the dissipation to the speed of unfixed masses
+  float dissip = pow(1.0 - sys->_dissip, dt);
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    if (soa->_fixed[iMass] == false)
+      for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i)
+        soa->_speed[i] *= dissip;
+  // Get the stiffness of each spring: along its axis 'u' the spring 
+  // has stiffness k, across it k.(1 - restLength / length) clamped to
+  // 0 for compressed springs, hence H = c0.I + c1.u.u' 
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+    const float *pA = soa->_pos + soa->_springMass[2 * iSpring] * nbDim;
+    const float *pB = 
+      soa->_pos + soa->_springMass[2 * iSpring + 1] * nbDim;
+    float l = soa->_length[iSpring];
+    float k = soa->_k[iSpring];
+    float across = 0.0;
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      axis[iSpring * nbDim + iDim] = 
+        (l > SPRINGSYS_EPSILON ? (pB[iDim] - pA[iDim]) / l : 0.0);
+    if (l > SPRINGSYS_EPSILON && l > soa->_restLength[iSpring])
+      across = k * (1.0 - soa->_restLength[iSpring] / l);
+    coef[2 * iSpring] = across;
+    coef[2 * iSpring + 1] = k - across;
+  }
+  // Get the diagonal of the system, M + dt^2.H, used as preconditioner
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      diag[iMass * nbDim + iDim] = 1.0 / soa->_invMass[iMass];
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+    for (int iDim = 0; iDim < nbDim; ++iDim) {
+      float u = axis[iSpring * nbDim + iDim];
+      float h = dt * dt * (coef[2 * iSpring] + 
+        coef[2 * iSpring + 1] * u * u);
+      diag[soa->_springMass[2 * iSpring] * nbDim + iDim] += h;
+      diag[soa->_springMass[2 * iSpring + 1] * nbDim + iDim] += h;
+    }
+  }
+  // Get the right-hand side, dt.(f - dt.H.v), null for fixed masses
+  for (int i = 0; i < nb; ++i)
+    rhs[i] = dt * soa->_force[i];
+  SpringSysImplicitStiffness(sys, axis, coef, soa->_speed, -dt * dt,
+    rhs);
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    if (soa->_fixed[iMass] == true)
+      for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i)
+        rhs[i] = 0.0;
+  // Solve (M + dt^2.H).dv = rhs with the preconditioned conjugate 
+  // gradient, starting from the change of speed of the previous step
+  // (the stress of masses). Components of fixed masses stay null in 
+  // all the vectors, which holds them in place.
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i)
+      dv[i] = (soa->_fixed[iMass] ? 0.0 : soa->_stress[i] * dt);
+  SpringSysImplicitProduct(sys, axis, coef, dv, dt, res);
+  double normRhs = 0.0;
+  double rz = 0.0;
+  for (int i = 0; i < nb; ++i) {
+    res[i] = rhs[i] - res[i];
+    z[i] = res[i] / diag[i];
+    dir[i] = z[i];
+    normRhs += (double)rhs[i] * rhs[i];
+    rz += (double)res[i] * z[i];
+  }
+  normRhs = sqrt(normRhs);
+  double normRes = 0.0;
+  for (int i = 0; i < nb; ++i)
+    normRes += (double)res[i] * res[i];
+  normRes = sqrt(normRes);
+  int iIter = 0;
+  while (iIter < sys->_solverMaxIter && 
+    normRes > sys->_solverTol * normRhs) {
+    // Get the product of the search direction by the system
+    SpringSysImplicitProduct(sys, axis, coef, dir, dt, prod);
+    // Move along the search direction
+    double dirProd = 0.0;
+    for (int i = 0; i < nb; ++i)
+      dirProd += (double)dir[i] * prod[i];
+    if (dirProd <= 0.0)
+      break;
+    double alpha = rz / dirProd;
+    double rzNext = 0.0;
+    normRes = 0.0;
+    for (int i = 0; i < nb; ++i) {
+      dv[i] += alpha * dir[i];
+      res[i] -= alpha * prod[i];
+      z[i] = res[i] / diag[i];
+      rzNext += (double)res[i] * z[i];
+      normRes += (double)res[i] * res[i];
+    }
+    normRes = sqrt(normRes);
+    // Update the search direction
+    double beta = rzNext / rz;
+    rz = rzNext;
+    for (int i = 0; i < nb; ++i)
+      dir[i] = z[i] + beta * dir[i];
+    ++iIter;
+  }
+  // Memorize the statistics of the solve
+  sys->_solverNbIter = iIter;
+  sys->_solverResidual = (normRhs > 0.0 ? normRes / normRhs : 0.0);
+  // Apply the change of speed and the speed to the unfixed masses, 
+  // their stress is the resulting acceleration
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+    if (soa->_fixed[iMass] == false) {
+      for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i) {
+        soa->_speed[i] += dv[i];
+        soa->_pos[i] += soa->_speed[i] * dt;
+        soa->_stress[i] = dv[i] / dt;
+      }
+    }
+  }
+  // Return true
+  return true;
+}
+
+// Apply the system (M + dt^2.H) of the implicit integrator for the 
+// compiled snapshot of the SpringSys 'sys', whose springs' axis are in
+// 'axis' and stiffness coefficients in 'coef', to 'w' and store the 
+// result in 'out', null for fixed masses (cf SpringSysStepImplicit)
+static void SpringSysImplicitProduct(SpringSys *sys, 
+  const float *axis, const float *coef, const float *w, float dt,
+  float *out) {
+  SpringSysSoA *soa = sys->_soa;
+  int nbDim = sys->_nbDim;
+  // Apply the inertia
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i)
+      out[i] = w[i] / soa->_invMass[iMass];
+  // Apply the stiffness
+  SpringSysImplicitStiffness(sys, axis, coef, w, dt * dt, out);
+  // Hold the fixed masses
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    if (soa->_fixed[iMass] == true)
+      for (int i = iMass * nbDim; i < (iMass + 1) * nbDim; ++i)
+        out[i] = 0.0;
+}
+
+// Apply the stiffness of the springs of the compiled snapshot of the 
+// SpringSys 'sys', whose axis are in 'axis' and coefficients in 
+// 'coef', to 'w', and add the result multiplied by 'scale' to 'out'
+// (cf SpringSysStepImplicit)
+static void SpringSysImplicitStiffness(SpringSys *sys, 
+  const float *axis, const float *coef, const float *w, float scale,
+  float *out) {
+  SpringSysSoA *soa = sys->_soa;
+  int nbDim = sys->_nbDim;
+  // For each spring
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+    int iA = soa->_springMass[2 * iSpring] * nbDim;
+    int iB = soa->_springMass[2 * iSpring + 1] * nbDim;
+    const float *u = axis + iSpring * nbDim;
+    // Get the difference of 'w' at the extremities and its projection
+    // on the axis
+    float d[3];
+    float proj = 0.0;
+    for (int iDim = 0; iDim < nbDim; ++iDim) {
+      d[iDim] = w[iA + iDim] - w[iB + iDim];
+      proj += d[iDim] * u[iDim];
+    }
+    // Apply the stiffness H = c0.I + c1.u.u' to the difference
+    for (int iDim = 0; iDim < nbDim; ++iDim) {
+      float h = scale * (coef[2 * iSpring] * d[iDim] + 
+        coef[2 * iSpring + 1] * proj * u[iDim]);
+      out[iA + iDim] += h;
+      out[iB + iDim] -= h;
+    }
+  }
+}
+
+// Apply the force of the spring at position 'iSpring' in the compiled
+// snapshot of the SpringSys 'sys' with 'nbDim' dimensions to the 
+// masses at its extremities
+// Return true if the spring broke, else false
+SPRINGSYS_KERNEL bool SpringSysSpringForceDim(SpringSys *sys, 
+  int iSpring, int nbDim) {
+  SpringSysSoA *soa = sys->_soa;
+  int iA = soa->_springMass[2 * iSpring];
+  int iB = soa->_springMass[2 * iSpring + 1];
+  float *pA = soa->_pos + iA * nbDim;
+  float *pB = soa->_pos + iB * nbDim;
+  float *fA = soa->_force + iA * nbDim;
+  float *fB = soa->_force + iB * nbDim;
+  // Declare a variable to memorize if the spring breaks
+  bool rupture = false;
+  // Get the distance between the masses
+  float v[3];
+  float l = 0.0;
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    v[iDim] = pB[iDim] - pA[iDim];
+    l += v[iDim] * v[iDim];
+  }
+  l = sqrt(l);
+  soa->_length[iSpring] = l;
+  // Get the stress
+  float stress = (l - soa->_restLength[iSpring]) * soa->_k[iSpring];
+  soa->_springStress[iSpring] = stress;
+  // Get the force per unit of length
+  float f = (l > SPRINGSYS_EPSILON ? stress / l : 0.0);
+  // If the stress is over the limits
+  if (stress <= soa->_breakMin[iSpring] || 
+    stress >= soa->_breakMax[iSpring]) {
+    // The spring breaks and doesn't apply force
+    rupture = true;
+    f = 0.0;
+  }
+  // Apply the force to the masses
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    fA[iDim] += f * v[iDim];
+    fB[iDim] -= f * v[iDim];
+  }
+  // Return the rupture flag
+  return rupture;
+}
+
+// Get the spring pass of the kernel of the SpringSys 'sys'
+static SpringSysSpringPass SpringSysGetSpringPass(SpringSys *sys) {
+  switch (sys->_kernel) {
+#ifdef SPRINGSYS_X86_KERNEL
+    case springSysKernelAVX2:
+      return sys->_dimKernels->_springPassAVX2;
+    case springSysKernelAVX512:
+      return sys->_dimKernels->_springPassAVX512;
+#endif
+    default:
+      return sys->_dimKernels->_springPassScalar;
+  }
+}
+
+// Break the spring at position 'iSpring' in the packed arrays of the 
+// SpringSys 'sys' (cf SpringSysBreakSpring) and release its record, 
+// the packed arrays are updated later by SpringSysSoARemoveBroken
+static void SpringSysSoABreakSpring(SpringSys *sys, int iSpring) {
+  SpringSysSoA *soa = sys->_soa;
+  SpringSysBreakSpring(sys, soa->_springRec[iSpring], 
+    soa->_springStress[iSpring]);
+  soa->_springRec[iSpring] = NULL;
+}
+
+// Record the rupture of the spring 's' of the SpringSys 'sys' under 
+// the stress 'stress', and tombstone it (cf SpringSysTombstoneSpring)
+static void SpringSysBreakSpring(SpringSys *sys, SpringSysSpring *s, 
+  float stress) {
+  // Record the rupture, enlarging the buffer of events if necessary 
+  // (the events not drained yet are moved to its beginning)
+  if (sys->_ruptureFirst > 0 && 
+    sys->_ruptureFirst + sys->_nbRupture == sys->_ruptureSize) {
+    memmove(sys->_rupture, sys->_rupture + sys->_ruptureFirst, 
+      sizeof(SpringSysRupture) * sys->_nbRupture);
+    sys->_ruptureFirst = 0;
+  }
+  if (sys->_ruptureFirst + sys->_nbRupture == sys->_ruptureSize) {
+    int size = 2 * sys->_ruptureSize + 16;
+    SpringSysRupture *rupture = (SpringSysRupture*)realloc(
+      sys->_rupture, sizeof(SpringSysRupture) * size);
+    if (rupture != NULL) {
+      sys->_rupture = rupture;
+      sys->_ruptureSize = size;
+    }
+  }
+  if (sys->_ruptureFirst + sys->_nbRupture < sys->_ruptureSize) {
+    SpringSysRupture *event = 
+      sys->_rupture + sys->_ruptureFirst + sys->_nbRupture;
+    event->_id = s->_id;
+    event->_stress = stress;
+    ++(sys->_nbRupture);
+  } else {
+    ++(sys->_nbRuptureLost);
+  }
+  // Tombstone the spring
+  SpringSysTombstoneSpring(sys, s);
+}
+
+// Disconnect the spring 's' of the SpringSys 'sys' from its masses and
+// add it to the tombstones removed from _springs by 
+// SpringSysRemoveTombstones, or if memory allocation failed remove it
+// and release it now
+static void SpringSysTombstoneSpring(SpringSys *sys, SpringSysSpring *s) {
+  // The topology is modified
+  SpringSysTopologyModified(sys);
+  // Disconnect the spring from its masses
+  SpringSysDetachSpring(sys, s);
+  // Add the spring to the tombstones, enlarging the buffer if 
+  // necessary
+  if (sys->_nbTombstone == sys->_tombstoneSize) {
+    int size = 2 * sys->_tombstoneSize + 16;
+    SpringSysSpring **tombstone = (SpringSysSpring**)realloc(
+      sys->_tombstone, sizeof(SpringSysSpring*) * size);
+    // If we couldn't allocate memory
+    if (tombstone == NULL) {
+      // Remove the spring from the set of springs and release it now
+      GSetRemoveFirst(sys->_springs, s);
+      SpringSysPoolRelease(&(sys->_springPool), s);
+      return;
+    }
+    sys->_tombstone = tombstone;
+    sys->_tombstoneSize = size;
+  }
+  sys->_tombstone[(sys->_nbTombstone)++] = s;
+}
+
+// Remove in one pass the springs tombstoned by 
+// SpringSysTombstoneSpring from the set of springs of the SpringSys 
+// 'sys', keeping the order of the other springs, and release them
+static void SpringSysRemoveTombstones(SpringSys *sys) {
+  // If there is no tombstone, nothing to do
+  if (sys->_nbTombstone == 0)
+    return;
+  // If there are many tombstones, copy the springs which are not 
+  // tombstones into a new set
+  GSet *springs = NULL;
+  if (sys->_nbTombstone >= SPRINGSYS_REBUILD_MINREMOVE)
+    springs = GSetCreate();
+  // If we could create the set
+  if (springs != NULL) {
+    // Sort the tombstones to search them
+    qsort(sys->_tombstone, sys->_nbTombstone, sizeof(SpringSysSpring*),
+      SpringSysComparePtr);
+    for (GSetElem *e = sys->_springs->_head; e != NULL; e = e->_next)
+      if (e->_data != NULL && bsearch(&(e->_data), sys->_tombstone, 
+        sys->_nbTombstone, sizeof(SpringSysSpring*), 
+        SpringSysComparePtr) == NULL)
+        GSetAppend(springs, e->_data);
+    // Replace the set of springs
+    GSetFree(&(sys->_springs));
+    sys->_springs = springs;
+  // Else, remove the tombstones one by one
+  } else {
+    for (int i = 0; i < sys->_nbTombstone; ++i)
+      GSetRemoveFirst(sys->_springs, sys->_tombstone[i]);
+  }
+  // Release the tombstones
+  for (int i = 0; i < sys->_nbTombstone; ++i)
+    SpringSysPoolRelease(&(sys->_springPool), sys->_tombstone[i]);
+  sys->_nbTombstone = 0;
+}
+
+// Compare the pointers pointed to by 'a' and 'b' (for qsort)
+static int SpringSysComparePtr(const void *a, const void *b) {
+  uintptr_t pA = (uintptr_t)(*(void* const*)a);
+  uintptr_t pB = (uintptr_t)(*(void* const*)b);
+  return (pA < pB ? -1 : (pA > pB ? 1 : 0));
+}
+
+// Compare the ints pointed to by 'a' and 'b' (for qsort)
+static int SpringSysCompareInt(const void *a, const void *b) {
+  int iA = *(const int*)a;
+  int iB = *(const int*)b;
+  return (iA < iB ? -1 : (iA > iB ? 1 : 0));
+}
+
+// Apply the forces of the springs at positions [first, last[ in the 
+// compiled snapshot of the SpringSys 'sys' with 'nbDim' dimensions to
+// the masses with the scalar kernel. Broken springs are released if 
+// 'release' is true. The sum of the absolute stress of the other 
+// springs is added to 'stress'.
+// Return the number of ruptures
+SPRINGSYS_KERNEL int SpringSysSpringPassScalarDim(SpringSys *sys, 
+  int first, int last, bool release, float *stress, int nbDim) {
+  // Declare a variable to memorize the number of ruptures
+  int nbRupture = 0;
+  // Declare a variable to memorize the sum of stress
+  float sum = 0.0;
+  // For each spring
+  for (int iSpring = first; iSpring < last; ++iSpring) {
+    // Apply its force
+    if (SpringSysSpringForceDim(sys, iSpring, nbDim)) {
+      if (release)
+        SpringSysSoABreakSpring(sys, iSpring);
+      ++nbRupture;
+    } else {
+      sum += fabs(sys->_soa->_springStress[iSpring]);
+    }
+  }
+  // Add the sum of stress
+  *stress += sum;
+  // Return the number of ruptures
+  return nbRupture;
+}
+
+#ifdef SPRINGSYS_X86_KERNEL
+
+// Apply the forces of the springs at positions [first, last[ in the 
+// compiled snapshot of the SpringSys 'sys' with 'nbDim' dimensions to
+// the masses with the AVX2 kernel. Broken springs are released if 
+// 'release' is true. The sum of the absolute stress of the other 
+// springs is added to 'stress'.
+// Return the number of ruptures
+__attribute__((target("avx2,fma")))
+SPRINGSYS_KERNEL int SpringSysSpringPassAVX2Dim(SpringSys *sys, 
+  int first, int last, bool release, float *stress, int nbDim) {
+  SpringSysSoA *soa = sys->_soa;
+  // Declare a variable to memorize the number of ruptures
+  int nbRupture = 0;
+  // Declare the constants of the kernel
+  const __m256i evenLanes = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+  const __m256i vNbDim = _mm256_set1_epi32(nbDim);
+  const __m256 vEpsilon = _mm256_set1_ps(SPRINGSYS_EPSILON);
+  const __m256 vSign = _mm256_set1_ps(-0.0);
+  // Declare a variable to memorize the sum of stress of each lane
+  __m256 vSum = _mm256_setzero_ps();
+  // Declare a variable to memorize the components of forces of the 
+  // current springs
+  float force[3][8];
+  // For each group of 8 springs
+  int iSpring = first;
+  for (; iSpring + 8 <= last; iSpring += 8) {
+    const int *masses = soa->_springMass + 2 * iSpring;
+    // Get the positions of the masses at the extremities in _pos
+    __m256i iA = _mm256_mullo_epi32(
+      _mm256_i32gather_epi32(masses, evenLanes, 4), vNbDim);
+    __m256i iB = _mm256_mullo_epi32(
+      _mm256_i32gather_epi32(masses + 1, evenLanes, 4), vNbDim);
+    // Get the distance between the masses
+    __m256 v[3];
+    __m256 l = _mm256_setzero_ps();
+    for (int iDim = 0; iDim < nbDim; ++iDim) {
+      __m256 pA = _mm256_i32gather_ps(soa->_pos + iDim, iA, 4);
+      __m256 pB = _mm256_i32gather_ps(soa->_pos + iDim, iB, 4);
+      v[iDim] = _mm256_sub_ps(pB, pA);
+      l = _mm256_fmadd_ps(v[iDim], v[iDim], l);
+    }
+    l = _mm256_sqrt_ps(l);
+    _mm256_storeu_ps(soa->_length + iSpring, l);
+    // Get the stress
+    __m256 stress = _mm256_mul_ps(
+      _mm256_sub_ps(l, _mm256_loadu_ps(soa->_restLength + iSpring)),
+      _mm256_loadu_ps(soa->_k + iSpring));
+    _mm256_storeu_ps(soa->_springStress + iSpring, stress);
+    // Get the force per unit of length, null for springs too short
+    __m256 f = _mm256_and_ps(_mm256_div_ps(stress, l), 
+      _mm256_cmp_ps(l, vEpsilon, _CMP_GT_OQ));
+    // Get the springs whose stress is over the limits
+    __m256 broken = _mm256_or_ps(
+      _mm256_cmp_ps(stress, _mm256_loadu_ps(soa->_breakMin + iSpring), 
+        _CMP_LE_OQ),
+      _mm256_cmp_ps(stress, _mm256_loadu_ps(soa->_breakMax + iSpring), 
+        _CMP_GE_OQ));
+    int brokenMask = _mm256_movemask_ps(broken);
+    // Add the absolute stress of the springs which hold to the sum
+    vSum = _mm256_add_ps(vSum, 
+      _mm256_andnot_ps(_mm256_or_ps(broken, vSign), stress));
+    // If some springs broke
+    if (brokenMask != 0) {
+      // The broken springs don't apply force
+      f = _mm256_andnot_ps(broken, f);
+      // Remove the broken springs from the set of springs and free 
+      // their record if requested, the snapshot is updated after the
+      // step
+      for (int iLane = 0; iLane < 8; ++iLane) {
+        if (brokenMask & (1 << iLane)) {
+          if (release)
+            SpringSysSoABreakSpring(sys, iSpring + iLane);
+          ++nbRupture;
+        }
+      }
+    }
+    // Get the forces
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      _mm256_storeu_ps(force[iDim], _mm256_mul_ps(f, v[iDim]));
+    // Apply the forces to the masses (springs of a group may share 
+    // masses, hence this can't be vectorized without conflicts)
+    for (int iLane = 0; iLane < 8; ++iLane) {
+      float *fA = soa->_force + masses[2 * iLane] * nbDim;
+      float *fB = soa->_force + masses[2 * iLane + 1] * nbDim;
+      for (int iDim = 0; iDim < nbDim; ++iDim) {
+        fA[iDim] += force[iDim][iLane];
+        fB[iDim] -= force[iDim][iLane];
+      }
+    }
+  }
+  // Apply the forces of the remaining springs
+  float sum = 0.0;
+  for (; iSpring < last; ++iSpring) {
+    if (SpringSysSpringForceDim(sys, iSpring, nbDim)) {
+      if (release)
+        SpringSysSoABreakSpring(sys, iSpring);
+      ++nbRupture;
+    } else {
+      sum += fabs(soa->_springStress[iSpring]);
+    }
+  }
+  // Add the sum of stress of the lanes and remaining springs
+  float lanes[8];
+  _mm256_storeu_ps(lanes, vSum);
+  for (int iLane = 0; iLane < 8; ++iLane)
+    sum += lanes[iLane];
+  *stress += sum;
+  // Return the number of ruptures
+  return nbRupture;
+}
+
+// Apply the forces of the springs at positions [first, last[ in the 
+// compiled snapshot of the SpringSys 'sys' with 'nbDim' dimensions to
+// the masses with the AVX-512 kernel. Broken springs are released if 
+// 'release' is true. The sum of the absolute stress of the other 
+// springs is added to 'stress'.
+// Return the number of ruptures
+__attribute__((target("avx512f")))
+SPRINGSYS_KERNEL int SpringSysSpringPassAVX512Dim(SpringSys *sys, 
+  int first, int last, bool release, float *stress, int nbDim) {
+  SpringSysSoA *soa = sys->_soa;
+  // Declare a variable to memorize the number of ruptures
+  int nbRupture = 0;
+  // Declare the constants of the kernel
+  const __m512i evenLanes = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14,
+    16, 18, 20, 22, 24, 26, 28, 30);
+  const __m512i vNbDim = _mm512_set1_epi32(nbDim);
+  const __m512 vEpsilon = _mm512_set1_ps(SPRINGSYS_EPSILON);
+  // Declare a variable to memorize the sum of stress of each lane
+  __m512 vSum = _mm512_setzero_ps();
+  // Declare a variable to memorize the components of forces of the 
+  // current springs
+  float force[3][16];
+  // For each group of 16 springs
+  int iSpring = first;
+  for (; iSpring + 16 <= last; iSpring += 16) {
+    const int *masses = soa->_springMass + 2 * iSpring;
+    // Get the positions of the masses at the extremities in _pos
+    __m512i iA = _mm512_mullo_epi32(
+      _mm512_i32gather_epi32(evenLanes, masses, 4), vNbDim);
+    __m512i iB = _mm512_mullo_epi32(
+      _mm512_i32gather_epi32(evenLanes, masses + 1, 4), vNbDim);
+    // Get the distance between the masses
+    __m512 v[3];
+    __m512 l = _mm512_setzero_ps();
+    for (int iDim = 0; iDim < nbDim; ++iDim) {
+      __m512 pA = _mm512_i32gather_ps(iA, soa->_pos + iDim, 4);
+      __m512 pB = _mm512_i32gather_ps(iB, soa->_pos + iDim, 4);
+      v[iDim] = _mm512_sub_ps(pB, pA);
+      l = _mm512_fmadd_ps(v[iDim], v[iDim], l);
+    }
+    l = _mm512_sqrt_ps(l);
+    _mm512_storeu_ps(soa->_length + iSpring, l);
+    // Get the stress
+    __m512 stress = _mm512_mul_ps(
+      _mm512_sub_ps(l, _mm512_loadu_ps(soa->_restLength + iSpring)),
+      _mm512_loadu_ps(soa->_k + iSpring));
+    _mm512_storeu_ps(soa->_springStress + iSpring, stress);
+    // Get the springs whose stress is over the limits
+    __mmask16 broken = 
+      _mm512_cmp_ps_mask(stress, 
+        _mm512_loadu_ps(soa->_breakMin + iSpring), _CMP_LE_OQ) |
+      _mm512_cmp_ps_mask(stress, 
+        _mm512_loadu_ps(soa->_breakMax + iSpring), _CMP_GE_OQ);
+    // Get the force per unit of length, null for springs too short and
+    // broken springs
+    __mmask16 active = 
+      _mm512_cmp_ps_mask(l, vEpsilon, _CMP_GT_OQ) & ~broken;
+    __m512 f = _mm512_maskz_div_ps(active, stress, l);
+    // Add the absolute stress of the springs which hold to the sum
+    vSum = _mm512_mask_add_ps(vSum, ~broken, vSum, 
+      _mm512_abs_ps(stress));
+    // If some springs broke
+    if (broken != 0) {
+      // Remove the broken springs from the set of springs and free 
+      // their record if requested, the snapshot is updated after the
+      // step
+      for (int iLane = 0; iLane < 16; ++iLane) {
+        if (broken & (1 << iLane)) {
+          if (release)
+            SpringSysSoABreakSpring(sys, iSpring + iLane);
+          ++nbRupture;
+        }
+      }
+    }
+    // Get the forces
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      _mm512_storeu_ps(force[iDim], _mm512_mul_ps(f, v[iDim]));
+    // Apply the forces to the masses (springs of a group may share 
+    // masses, hence this can't be vectorized without conflicts)
+    for (int iLane = 0; iLane < 16; ++iLane) {
+      float *fA = soa->_force + masses[2 * iLane] * nbDim;
+      float *fB = soa->_force + masses[2 * iLane + 1] * nbDim;
+      for (int iDim = 0; iDim < nbDim; ++iDim) {
+        fA[iDim] += force[iDim][iLane];
+        fB[iDim] -= force[iDim][iLane];
+      }
+    }
+  }
+  // Apply the forces of the remaining springs
+  float sum = 0.0;
+  for (; iSpring < last; ++iSpring) {
+    if (SpringSysSpringForceDim(sys, iSpring, nbDim)) {
+      if (release)
+        SpringSysSoABreakSpring(sys, iSpring);
+      ++nbRupture;
+    } else {
+      sum += fabs(soa->_springStress[iSpring]);
+    }
+  }
+  // Add the sum of stress of the lanes and remaining springs
+  *stress += sum + _mm512_reduce_add_ps(vSum);
+  // Return the number of ruptures
+  return nbRupture;
+}
+
+#endif
+
+// Apply the forces to the unfixed masses at positions [first, last[ 
+// of the compiled snapshot of the SpringSys 'sys' with 'nbDim' 
+// dimensions and step them in time by 'dt'
+SPRINGSYS_KERNEL void SpringSysIntegrateDim(SpringSys *sys, float dt,
+  int first, int last, SpringSysStats *stats, int nbDim) {
+  SpringSysSoA *soa = sys->_soa;
+  // Get the dissipation over the step
+  double dissip = pow(1.0 - sys->_dissip, dt);
+  // Declare variables to memorize the observables of masses
+  float momentum = 0.0;
+  float energy = 0.0;
+  float maxForce = 0.0;
+  // For each mass
+  for (int iMass = first; iMass < last; ++iMass) {
+    float *speed = soa->_speed + iMass * nbDim;
+    // If the mass is not fixed
+    if (soa->_fixed[iMass] == false) {
+      float *pos = soa->_pos + iMass * nbDim;
+      float *stress = soa->_stress + iMass * nbDim;
+      float *force = soa->_force + iMass * nbDim;
+      float f = 0.0;
+      for (int iDim = 0; iDim < nbDim; ++iDim) {
+        // Apply the inertia to the force
+        stress[iDim] = force[iDim] * soa->_invMass[iMass];
+        // Apply the dissipation to the speed
+        speed[iDim] *= dissip;
+        // Apply the stress to the speed
+        speed[iDim] += stress[iDim] * dt;
+        // Apply the speed to the position
+        pos[iDim] += speed[iDim] * dt;
+        f += force[iDim] * force[iDim];
+      }
+      // Update the highest force
+      if (f > maxForce)
+        maxForce = f;
+    }
+    // Add the momentum and kinetic energy of the mass
+    float v = 0.0;
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      v += speed[iDim] * speed[iDim];
+    momentum += sqrt(v);
+    energy += 0.5 * v / soa->_invMass[iMass];
+  }
+  // Add the observables of masses to the statistics
+  SpringSysStatsAddMasses(stats, momentum, energy, sqrt(maxForce));
+}
+
+// Add the momentum 'momentum', kinetic energy 'energy' and highest 
+// force 'maxForce' of a set of masses to the statistics 'stats'
+static inline void SpringSysStatsAddMasses(SpringSysStats *stats,
+  float momentum, float energy, float maxForce) {
+  stats->_momentum += momentum;
+  stats->_kineticEnergy += energy;
+  if (maxForce > stats->_maxForce)
+    stats->_maxForce = maxForce;
+}
+
+// Step in time the compiled snapshot of a SpringSys with 'nbDim' 
+// dimensions, part of the thread 'iThread' among 'nbThread', 'arg' is
+// a SpringSysParallelStep
+SPRINGSYS_KERNEL void SpringSysStepParallelDim(void *arg, int iThread,
+  int nbThread, int nbDim) {
+  SpringSysParallelStep *step = (SpringSysParallelStep*)arg;
+  SpringSys *sys = step->_sys;
+  SpringSysSoA *soa = sys->_soa;
+  // Declare a variable to memorize the number of ruptures
+  int nbRupture = 0;
+  // Get the observables of this thread
+  SpringSysStats *stats = step->_stats + iThread;
+  memset(stats, 0, sizeof(SpringSysStats));
+  // Reset the forces applied on the masses of this thread
+  int first = (int)((long)soa->_nbMass * iThread / nbThread);
+  int last = (int)((long)soa->_nbMass * (iThread + 1) / nbThread);
+  memset(soa->_force + first * nbDim, 0, 
+    sizeof(float) * (last - first) * nbDim);
+  pthread_barrier_wait(&(sys->_threadPool->_barrier));
+  // For each color class
+  SpringSysSpringPass pass = SpringSysGetSpringPass(sys);
+  for (int iColor = 0; iColor < soa->_nbColor; ++iColor) {
+    // Apply the forces of the springs of this thread in the class, 
+    // they don't share masses with springs of other threads. Broken 
+    // springs are released by the calling thread after the step.
+    int start = soa->_colorStart[iColor];
+    int nb = soa->_colorStart[iColor + 1] - start;
+    first = start + (int)((long)nb * iThread / nbThread);
+    last = start + (int)((long)nb * (iThread + 1) / nbThread);
+    nbRupture += pass(sys, first, last, false, &(stats->_stress));
+    // Wait for the other threads before the next class
+    pthread_barrier_wait(&(sys->_threadPool->_barrier));
+  }
+  // Apply the forces to the masses of this thread if requested
+  first = (int)((long)soa->_nbMass * iThread / nbThread);
+  last = (int)((long)soa->_nbMass * (iThread + 1) / nbThread);
+  if (step->_dt > 0.0)
+    SpringSysIntegrateDim(sys, step->_dt, first, last, stats, nbDim);
+  // Memorize the number of ruptures
+  step->_nbRupture[iThread] = nbRupture;
+}
+
+// Apply the forces of the springs of the compiled snapshot of the 
+// SpringSys 'sys' to its masses with its thread pool, then if 'dt' is
+// not null step the masses in time by 'dt'. Broken springs apply no
+// force and are not released, their number is added to 'nbRupture'.
+// The observables calculated during the step are added to 'stats'.
+// Return false if the threads or the color classes couldn't be 
+// created, in which case the SpringSys is unchanged, else true
+static bool SpringSysStepParallel(SpringSys *sys, float dt, 
+  int *nbRupture, SpringSysStats *stats) {
+  SpringSysSoA *soa = sys->_soa;
+  // Create the threads if necessary
+  if (sys->_threadPool == NULL)
+    sys->_threadPool = SpringSysThreadPoolCreate(sys->_nbThread);
+  // Partition the springs into color classes if necessary
+  if (sys->_threadPool == NULL || 
+    (soa->_springColor == NULL && !SpringSysSoAColorSprings(soa)))
+    return false;
+  // Declare the argument of the job
+  int nbThreadRupture[sys->_nbThread];
+  SpringSysStats threadStats[sys->_nbThread];
+  SpringSysParallelStep step = {
+    ._sys = sys, ._dt = dt, ._nbRupture = nbThreadRupture,
+    ._stats = threadStats
+  };
+  // Step the SpringSys on all the threads
+  SpringSysThreadPoolRun(sys->_threadPool, 
+    sys->_dimKernels->_stepParallel, &step);
+  // Get the total number of ruptures and observables
+  int nb = 0;
+  for (int iThread = 0; iThread < sys->_nbThread; ++iThread) {
+    nb += nbThreadRupture[iThread];
+    stats->_stress += threadStats[iThread]._stress;
+    SpringSysStatsAddMasses(stats, threadStats[iThread]._momentum,
+      threadStats[iThread]._kineticEnergy, 
+      threadStats[iThread]._maxForce);
+  }
+  *nbRupture += nb;
+  // Return true
+  return true;
+}
+
+// Create a pool of 'nbThread' threads (including the calling thread)
+// Return NULL if the threads couldn't be created
+static SpringSysThreadPool* SpringSysThreadPoolCreate(int nbThread) {
+  // Allocate memory
+  SpringSysThreadPool *ret = 
+    (SpringSysThreadPool*)malloc(sizeof(SpringSysThreadPool));
+  if (ret == NULL)
+    return NULL;
+  ret->_threads = (pthread_t*)malloc(sizeof(pthread_t) * nbThread);
+  if (ret->_threads == NULL) {
+    free(ret);
+    return NULL;
+  }
+  // Initialise the synchronisation
+  ret->_nbThread = nbThread;
+  ret->_nbJob = 0;
+  ret->_nbStarted = 0;
+  ret->_nbRunning = 0;
+  ret->_quit = false;
+  ret->_job = NULL;
+  ret->_arg = NULL;
+  pthread_mutex_init(&(ret->_mutex), NULL);
+  pthread_cond_init(&(ret->_condStart), NULL);
+  pthread_cond_init(&(ret->_condDone), NULL);
+  pthread_barrier_init(&(ret->_barrier), NULL, nbThread);
+  // Start the workers
+  for (int iThread = 1; iThread < nbThread; ++iThread) {
+    // If we couldn't start the worker
+    if (pthread_create(ret->_threads + iThread, NULL, 
+      SpringSysThreadPoolWorker, ret) != 0) {
+      // Stop the workers started so far and free memory
+      ret->_nbThread = iThread;
+      SpringSysThreadPoolFree(&ret);
+      // Return NULL
+      return NULL;
+    }
+  }
+  // Return the new pool
+  return ret;  
+}
+
+// Stop the threads of the pool 'pool' and free its memory
+static void SpringSysThreadPoolFree(SpringSysThreadPool **pool) {
+  // Check arguments
+  if (pool == NULL || *pool == NULL)
+    return;
+  // Stop the workers
+  pthread_mutex_lock(&((*pool)->_mutex));
+  (*pool)->_quit = true;
+  pthread_cond_broadcast(&((*pool)->_condStart));
+  pthread_mutex_unlock(&((*pool)->_mutex));
+  for (int iThread = 1; iThread < (*pool)->_nbThread; ++iThread)
+    pthread_join((*pool)->_threads[iThread], NULL);
+  // Free memory
+  pthread_mutex_destroy(&((*pool)->_mutex));
+  pthread_cond_destroy(&((*pool)->_condStart));
+  pthread_cond_destroy(&((*pool)->_condDone));
+  pthread_barrier_destroy(&((*pool)->_barrier));
+  free((*pool)->_threads);
+  free(*pool);
+  *pool = NULL;
+}
+
+// Execute 'job' with argument 'arg' on all the threads of the pool 
+// 'pool' and wait for its completion
+static void SpringSysThreadPoolRun(SpringSysThreadPool *pool,
+  void (*job)(void *arg, int iThread, int nbThread), void *arg) {
+  // Submit the job to the workers
+  pthread_mutex_lock(&(pool->_mutex));
+  pool->_job = job;
+  pool->_arg = arg;
+  pool->_nbRunning = pool->_nbThread - 1;
+  ++(pool->_nbJob);
+  pthread_cond_broadcast(&(pool->_condStart));
+  pthread_mutex_unlock(&(pool->_mutex));
+  // Execute the part of the calling thread
+  job(arg, 0, pool->_nbThread);
+  // Wait for the workers
+  pthread_mutex_lock(&(pool->_mutex));
+  while (pool->_nbRunning > 0)
+    pthread_cond_wait(&(pool->_condDone), &(pool->_mutex));
+  pthread_mutex_unlock(&(pool->_mutex));
+}
+
+// Main function of the worker threads of a pool, 'arg' is the 
+// SpringSysThreadPool
+static void* SpringSysThreadPoolWorker(void *arg) {
+  SpringSysThreadPool *pool = (SpringSysThreadPool*)arg;
+  // Get the index of this thread
+  pthread_mutex_lock(&(pool->_mutex));
+  int iThread = ++(pool->_nbStarted);
+  // Declare a variable to memorize the number of jobs executed
+  int nbJob = 0;
+  // Loop until the pool is freed
+  while (true) {
+    // Wait for a new job
+    while (pool->_nbJob == nbJob && !pool->_quit)
+      pthread_cond_wait(&(pool->_condStart), &(pool->_mutex));
+    if (pool->_quit)
+      break;
+    nbJob = pool->_nbJob;
+    pthread_mutex_unlock(&(pool->_mutex));
+    // Execute the job
+    pool->_job(pool->_arg, iThread, pool->_nbThread);
+    // Signal the completion of the job
+    pthread_mutex_lock(&(pool->_mutex));
+    if (--(pool->_nbRunning) == 0)
+      pthread_cond_signal(&(pool->_condDone));
+  }
+  pthread_mutex_unlock(&(pool->_mutex));
+  return NULL;
+}
+
+// Partition the springs of the compiled packed arrays 'soa' into color
+// classes such as no two springs of a class share a mass, and sort 
+// them by class
+// Return false if memory allocation failed, else return true
+static bool SpringSysSoAColorSprings(SpringSysSoA *soa) {
+  int nM = (soa->_nbMass > 0 ? soa->_nbMass : 1);
+  int nS = (soa->_nbSpring > 0 ? soa->_nbSpring : 1);
+  // Allocate memory
+  int *color = (int*)malloc(sizeof(int) * nS);
+  int *lastColor = (int*)malloc(sizeof(int) * nM);
+  int *uncolored = (int*)malloc(sizeof(int) * nS);
+  void *tmp = malloc(nS * 2 * sizeof(void*));
+  // If we couldn't allocate memory
+  if (color == NULL || lastColor == NULL || uncolored == NULL || 
+    tmp == NULL) {
+    // Free memory
+    free(color);
+    free(lastColor);
+    free(uncolored);
+    free(tmp);
+    // Return false
+    return false;
+  }
+  // Greedily give the current color to the uncolored springs whose 
+  // masses don't have it yet, until all the springs are colored
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+    lastColor[iMass] = -1;
+  int nbUncolored = soa->_nbSpring;
+  for (int iSpring = 0; iSpring < nbUncolored; ++iSpring)
+    uncolored[iSpring] = iSpring;
+  int nbColor = 0;
+  while (nbUncolored > 0) {
+    int nbRemaining = 0;
+    for (int i = 0; i < nbUncolored; ++i) {
+      int iSpring = uncolored[i];
+      int iA = soa->_springMass[2 * iSpring];
+      int iB = soa->_springMass[2 * iSpring + 1];
+      if (lastColor[iA] != nbColor && lastColor[iB] != nbColor) {
+        color[iSpring] = nbColor;
+        lastColor[iA] = nbColor;
+        lastColor[iB] = nbColor;
+      } else {
+        uncolored[nbRemaining++] = iSpring;
+      }
+    }
+    nbUncolored = nbRemaining;
+    ++nbColor;
+  }
+  free(lastColor);
+  // Allocate memory for the classes
+  soa->_colorStart = (int*)malloc(sizeof(int) * (nbColor + 1));
+  // If we couldn't allocate memory
+  if (soa->_colorStart == NULL) {
+    // Free memory
+    free(color);
+    free(uncolored);
+    free(tmp);
+    // Return false
+    return false;
+  }
+  // Count the springs of each class and get the first position of 
+  // classes
+  soa->_nbColor = nbColor;
+  soa->_springColor = color;
+  SpringSysSoABuildColors(soa);
+  // Get the new position of each spring (counting sort, using the 
+  // first positions of classes as cursors) and move the springs
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring)
+    uncolored[iSpring] = (soa->_colorStart[color[iSpring]])++;
+  SpringSysSoAPermuteSprings(soa, 0, soa->_nbSpring, uncolored, tmp);
+  SpringSysSoABuildColors(soa);
+  soa->_nbBrokenSinceColor = 0;
+  // The springs are not sorted by rows nor islands anymore
+  free(soa->_rowStart);
+  soa->_rowStart = NULL;
+  SpringSysSoAFreeIslands(soa);
+  // Free memory
+  free(uncolored);
+  free(tmp);
+  // Return true
+  return true;
+}
+
+// Set the positions of the first spring of each color class of the 
+// compiled packed arrays 'soa' from the colors of the springs
+static void SpringSysSoABuildColors(SpringSysSoA *soa) {
+  // Count the springs of each class
+  for (int iColor = 0; iColor <= soa->_nbColor; ++iColor)
+    soa->_colorStart[iColor] = 0;
+  for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring)
+    ++(soa->_colorStart[soa->_springColor[iSpring] + 1]);
+  // Convert the counts into positions
+  for (int iColor = 0; iColor < soa->_nbColor; ++iColor)
+    soa->_colorStart[iColor + 1] += soa->_colorStart[iColor];
+}
+
+// Return the sum of the norm of the speed of masses in the packed 
+// arrays 'soa' with 'nbDim' dimensions
+SPRINGSYS_KERNEL float SpringSysMomentumDim(const SpringSysSoA *soa,
+  int nbDim) {
+  // Declare a variable to memorize the sum
+  float sum = 0.0;
+  // Calculate the norm of the speed of each mass and sum it
+  for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+    const float *speed = soa->_speed + iMass * nbDim;
+    float v = 0.0;
+    for (int iDim = 0; iDim < nbDim; ++iDim)
+      v += speed[iDim] * speed[iDim];
+    sum += sqrt(v);
+  }
+  // Return the sum
+  return sum;  
+}
+
+// Return the position of the nearest mass from 'pos' in the packed 
+// arrays 'soa' with 'nbDim' dimensions, or -1 if there is no mass. The
+// grid of masses is used if it's valid, else all the masses are 
+// checked. Among masses at the same distance, the first one in the 
+// packed arrays is returned.
+SPRINGSYS_KERNEL int SpringSysNearestMassDim(const SpringSysSoA *soa,
+  const float *pos, int nbDim) {
+  // Declare variables to memorize the nearest mass and its squared 
+  // distance
+  int nearest = -1;
+  float dNearest = 0.0;
+  // If the grid is not valid
+  if (soa->_gridValid == false) {
+    // Check each mass
+    for (int iMass = 0; iMass < soa->_nbMass; ++iMass)
+      SpringSysNearestMassCheckDim(soa, pos, iMass, &nearest, 
+        &dNearest, nbDim);
+    // Return the nearest mass
+    return nearest;
+  }
+  // Get the cell of the position, clamped to the grid, the number of 
+  // rings of cells around it needed to cover the grid, and the 
+  // distance from the position to the bounding box of masses along 
+  // each dimension
+  int cell[3] = {0, 0, 0};
+  int nbRing = 0;
+  float out[3] = {0.0, 0.0, 0.0};
+  float sqOut = 0.0;
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    cell[iDim] = SpringSysSoAGridCoord(soa, pos[iDim], iDim);
+    int nb = soa->_gridDim[iDim] - 1 - cell[iDim];
+    if (cell[iDim] > nb)
+      nb = cell[iDim];
+    if (nb > nbRing)
+      nbRing = nb;
+    if (pos[iDim] < soa->_gridMin[iDim])
+      out[iDim] = soa->_gridMin[iDim] - pos[iDim];
+    else if (pos[iDim] > soa->_gridMax[iDim])
+      out[iDim] = pos[iDim] - soa->_gridMax[iDim];
+    sqOut += out[iDim] * out[iDim];
+  }
+  // Check the masses of the rings of cells around the cell of the 
+  // position until the next rings can't contain a nearer mass
+  const int *dim = soa->_gridDim;
+  for (int ring = 0; ring <= nbRing; ++ring) {
+    int lo[3];
+    int hi[3];
+    for (int iDim = 0; iDim < 3; ++iDim) {
+      lo[iDim] = (cell[iDim] > ring ? cell[iDim] - ring : 0);
+      hi[iDim] = (cell[iDim] + ring < dim[iDim] ? 
+        cell[iDim] + ring : dim[iDim] - 1);
+    }
+    for (int z = lo[2]; z <= hi[2]; ++z) {
+      for (int y = lo[1]; y <= hi[1]; ++y) {
+        // Inside the ring, only the cells at its ends along the first 
+        // dimension are in the ring
+        bool edge = (ring == 0 || abs(y - cell[1]) == ring || 
+          abs(z - cell[2]) == ring);
+        int step = (edge ? 1 : 2 * ring);
+        for (int x = cell[0] - ring; x <= cell[0] + ring; x += step) {
+          if (x < 0 || x >= dim[0])
+            continue;
+          int iCell = x + dim[0] * (y + dim[1] * z);
+          for (int i = soa->_gridStart[iCell]; 
+            i < soa->_gridStart[iCell + 1]; ++i)
+            SpringSysNearestMassCheckDim(soa, pos, soa->_gridMass[i], 
+              &nearest, &dNearest, nbDim);
+        }
+      }
+    }
+    // The masses in the next rings are farther than the next ring 
+    // along one dimension (with a margin of half a cell for the 
+    // rounding of the cells of masses), and than the bounding box 
+    // along the others
+    float bound = INFINITY;
+    for (int iDim = 0; iDim < nbDim; ++iDim) {
+      float gap = out[iDim] + (ring - 0.5) * soa->_gridCell;
+      if (gap < 0.0)
+        gap = 0.0;
+      float b = gap * gap + sqOut - out[iDim] * out[iDim];
+      if (b < bound)
+        bound = b;
+    }
+    if (nearest != -1 && dNearest < bound)
+      break;
+  }
+  // Return the nearest mass
+  return nearest;
+}
+
+// Check if the mass at position 'iMass' in the packed arrays 'soa' 
+// with 'nbDim' dimensions is nearer from 'pos' than the mass 
+// 'nearest' at the squared distance 'dNearest' (the first one among 
+// masses at the same distance), and if so update them
+SPRINGSYS_KERNEL void SpringSysNearestMassCheckDim(
+  const SpringSysSoA *soa, const float *pos, int iMass, int *nearest,
+  float *dNearest, int nbDim) {
+  // Calculate the squared distance
+  const float *p = soa->_pos + iMass * nbDim;
+  float v = 0.0;
+  for (int iDim = 0; iDim < nbDim; ++iDim)
+    v += (p[iDim] - pos[iDim]) * (p[iDim] - pos[iDim]);
+  // If the distance is shorter than the current one
+  if (*nearest == -1 || *dNearest > v || 
+    (*dNearest == v && iMass < *nearest)) {
+    *dNearest = v;
+    *nearest = iMass;
+  }
+}
+
+// Return the position of the nearest spring from 'pos' in the packed 
+// arrays 'soa' with 'nbDim' dimensions, or -1 if there is no spring, 
+// the distance to a spring being the distance to the segment between 
+// its masses. The hierarchy of springs is used if it's valid, else all
+// the springs are checked. Among springs at the same distance, the 
+// first one in the packed arrays is returned.
+SPRINGSYS_KERNEL int SpringSysNearestSpringDim(const SpringSysSoA *soa,
+  const float *pos, int nbDim) {
+  // Declare variables to memorize the nearest spring and its squared 
+  // distance
+  int nearest = -1;
+  float dNearest = 0.0;
+  // If the hierarchy is not valid
+  if (soa->_bvhValid == false || soa->_bvhFit == false) {
+    // Check each spring
+    for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring)
+      SpringSysNearestSpringCheckDim(soa, pos, iSpring, &nearest, 
+        &dNearest, nbDim);
+    // Return the nearest spring
+    return nearest;
+  }
+  // Walk the hierarchy from the root, nearest child first, skipping 
+  // the nodes farther than the nearest spring (the median splits keep
+  // the depth, hence the stack, under 2 nodes per level)
+  int stack[64];
+  int nbStack = 0;
+  if (soa->_nbSpring > 0)
+    stack[nbStack++] = 0;
+  while (nbStack > 0) {
+    int iNode = stack[--nbStack];
+    const float *box = soa->_bvhBox + iNode * 2 * nbDim;
+    if (nearest != -1 && 
+      SpringSysBoxSqDistDim(box, pos, nbDim) > dNearest)
+      continue;
+    int first = soa->_bvhNode[2 * iNode];
+    int nb = soa->_bvhNode[2 * iNode + 1];
+    // If the node is a leaf, check its springs
+    if (nb > 0) {
+      for (int i = first; i < first + nb; ++i)
+        SpringSysNearestSpringCheckDim(soa, pos, soa->_bvhSpring[i], 
+          &nearest, &dNearest, nbDim);
+    // Else, push its children, the nearest one last
+    } else {
+      float dA = SpringSysBoxSqDistDim(
+        soa->_bvhBox + first * 2 * nbDim, pos, nbDim);
+      float dB = SpringSysBoxSqDistDim(
+        soa->_bvhBox + (first + 1) * 2 * nbDim, pos, nbDim);
+      stack[nbStack++] = (dA <= dB ? first + 1 : first);
+      stack[nbStack++] = (dA <= dB ? first : first + 1);
+    }
+  }
+  // Return the nearest spring
+  return nearest;
+}
+
+// Check if the spring at position 'iSpring' in the packed arrays 'soa'
+// with 'nbDim' dimensions is nearer from 'pos' than the spring 
+// 'nearest' at the squared distance 'dNearest' (the first one among 
+// springs at the same distance), and if so update them
+SPRINGSYS_KERNEL void SpringSysNearestSpringCheckDim(
+  const SpringSysSoA *soa, const float *pos, int iSpring, int *nearest,
+  float *dNearest, int nbDim) {
+  float v = SpringSysSegmentSqDistDim(pos, 
+    soa->_pos + soa->_springMass[2 * iSpring] * nbDim, 
+    soa->_pos + soa->_springMass[2 * iSpring + 1] * nbDim, nbDim);
+  if (*nearest == -1 || *dNearest > v || 
+    (*dNearest == v && iSpring < *nearest)) {
+    *dNearest = v;
+    *nearest = iSpring;
+  }
+}
+
+// Return the squared distance from 'pos' to the segment ['pA', 'pB'] 
+// with 'nbDim' dimensions
+SPRINGSYS_KERNEL float SpringSysSegmentSqDistDim(const float *pos, 
+  const float *pA, const float *pB, int nbDim) {
+  // Get the position of the projection of 'pos' on the segment
+  float dot = 0.0;
+  float sqLength = 0.0;
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    dot += (pos[iDim] - pA[iDim]) * (pB[iDim] - pA[iDim]);
+    sqLength += (pB[iDim] - pA[iDim]) * (pB[iDim] - pA[iDim]);
+  }
+  float t = (sqLength > 0.0 ? dot / sqLength : 0.0);
+  if (t < 0.0)
+    t = 0.0;
+  else if (t > 1.0)
+    t = 1.0;
+  // Return the squared distance to the projection
+  float v = 0.0;
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    float d = pA[iDim] + t * (pB[iDim] - pA[iDim]) - pos[iDim];
+    v += d * d;
+  }
+  return v;
+}
+
+// Return the squared distance from 'pos' to the box 'box' (lower 
+// corner then upper corner) with 'nbDim' dimensions
+SPRINGSYS_KERNEL float SpringSysBoxSqDistDim(const float *box, 
+  const float *pos, int nbDim) {
+  float v = 0.0;
+  for (int iDim = 0; iDim < nbDim; ++iDim) {
+    float d = 0.0;
+    if (pos[iDim] < box[iDim])
+      d = box[iDim] - pos[iDim];
+    else if (pos[iDim] > box[nbDim + iDim])
+      d = pos[iDim] - box[nbDim + iDim];
+    v += d * d;
+  }
+  return v;
+}
+
+// Define the kernels specialized for 'D' dimensions
+#define SPRINGSYS_DIM_KERNELS(D) \
+  static void SpringSysStepSoA##D(SpringSys *sys, float dt) { \
+    SpringSysStepSoADim(sys, dt, D); \
+  } \
+  static int SpringSysSpringPassScalar##D(SpringSys *sys, int first, \
+    int last, bool release, float *stress) { \
+    return SpringSysSpringPassScalarDim(sys, first, last, release, \
+      stress, D); \
+  } \
+  static void SpringSysIntegrate##D(SpringSys *sys, float dt, \
+    int first, int last, SpringSysStats *stats) { \
+    SpringSysIntegrateDim(sys, dt, first, last, stats, D); \
+  } \
+  static void SpringSysStepParallel##D(void *arg, int iThread, \
+    int nbThread) { \
+    SpringSysStepParallelDim(arg, iThread, nbThread, D); \
+  } \
+  static float SpringSysMomentum##D(const SpringSysSoA *soa) { \
+    return SpringSysMomentumDim(soa, D); \
+  } \
+  static int SpringSysNearestMass##D(const SpringSysSoA *soa, \
+    const float *pos) { \
+    return SpringSysNearestMassDim(soa, pos, D); \
+  } \
+  static int SpringSysNearestSpring##D(const SpringSysSoA *soa, \
+    const float *pos) { \
+    return SpringSysNearestSpringDim(soa, pos, D); \
+  } \
+  static void SpringSysCollide##D(void *arg, int iThread, \
+    int nbThread) { \
+    SpringSysCollideDim(arg, iThread, nbThread, D); \
+  }
+
+// Define the vectorized kernels specialized for 'D' dimensions
+#define SPRINGSYS_DIM_KERNELS_X86(D) \
+  __attribute__((target("avx2,fma"))) \
+  static int SpringSysSpringPassAVX2##D(SpringSys *sys, int first, \
+    int last, bool release, float *stress) { \
+    return SpringSysSpringPassAVX2Dim(sys, first, last, release, \
+      stress, D); \
+  } \
+  __attribute__((target("avx512f"))) \
+  static int SpringSysSpringPassAVX512##D(SpringSys *sys, int first, \
+    int last, bool release, float *stress) { \
+    return SpringSysSpringPassAVX512Dim(sys, first, last, release, \
+      stress, D); \
+  }
+
+// Initializer of the set of kernels specialized for 'D' dimensions
+#define SPRINGSYS_DIM_KERNELS_SET(D) { \
+  SpringSysStepSoA##D, \
+  SpringSysSpringPassScalar##D, \
+  SPRINGSYS_X86_ONLY(SpringSysSpringPassAVX2##D), \
+  SPRINGSYS_X86_ONLY(SpringSysSpringPassAVX512##D), \
+  SpringSysIntegrate##D, \
+  SpringSysStepParallel##D, \
+  SpringSysMomentum##D, \
+  SpringSysNearestMass##D, \
+  SpringSysNearestSpring##D, \
+  SpringSysCollide##D \
+}
+
+SPRINGSYS_DIM_KERNELS(1)
+SPRINGSYS_DIM_KERNELS(2)
+SPRINGSYS_DIM_KERNELS(3)
+#ifdef SPRINGSYS_X86_KERNEL
+SPRINGSYS_DIM_KERNELS_X86(1)
+SPRINGSYS_DIM_KERNELS_X86(2)
+SPRINGSYS_DIM_KERNELS_X86(3)
+#endif
+
+// Kernels specialized for 1, 2 and 3 dimensions
+static const SpringSysDimKernels springSysDimKernels[3] = {
+  SPRINGSYS_DIM_KERNELS_SET(1),
+  SPRINGSYS_DIM_KERNELS_SET(2),
+  SPRINGSYS_DIM_KERNELS_SET(3)
+};
+
+// Create an ensemble of 'nbInstance' instances of the SpringSys 'sys',
+// all initialized with the current state, dissipation and K 
+// coefficients of 'sys'
+// Return NULL if arguments are invalid, memory allocation failed or 
+// the springs of 'sys' refer to unknown masses
+SpringSysEnsemble* SpringSysEnsembleCreate(SpringSys *sys, 
+  int nbInstance) {
+  // Check arguments
+  if (sys == NULL || sys->_masses == NULL || sys->_springs == NULL || 
+    nbInstance < 1)
+    return NULL;
+  // Pack the SpringSys to get its topology, memorizing if it was 
+  // already packed
+  bool packed = (sys->_soa != NULL);
+  if (!SpringSysSoAPrepare(sys))
+    return NULL;
+  SpringSysSoA *soa = sys->_soa;
+  int nbDim = sys->_nbDim;
+  int nM = (soa->_nbMass > 0 ? soa->_nbMass : 1);
+  int nS = (soa->_nbSpring > 0 ? soa->_nbSpring : 1);
+  // Allocate memory
+  SpringSysEnsemble *ret = 
+    (SpringSysEnsemble*)calloc(1, sizeof(SpringSysEnsemble));
+  if (ret != NULL) {
+    ret->_nbInstance = nbInstance;
+    ret->_nbDim = nbDim;
+    ret->_nbMass = soa->_nbMass;
+    ret->_nbSpring = soa->_nbSpring;
+    ret->_nbThread = 1;
+    ret->_threadPool = NULL;
+    ret->_massId = (int*)malloc(sizeof(int) * nM);
+    ret->_springId = (int*)malloc(sizeof(int) * nS);
+    ret->_springMass = (int*)malloc(sizeof(int) * 2 * nS);
+    ret->_restLength = (float*)malloc(sizeof(float) * nS);
+    ret->_breakMin = (float*)malloc(sizeof(float) * nS);
+    ret->_breakMax = (float*)malloc(sizeof(float) * nS);
+    ret->_invMass = (float*)malloc(sizeof(float) * nM);
+    ret->_fixed = (bool*)malloc(sizeof(bool) * nM);
+    ret->_massIndex = SpringSysIndexCreate();
+    ret->_springIndex = SpringSysIndexCreate();
+    ret->_dissip = (float*)malloc(sizeof(float) * nbInstance);
+    ret->_k = (float*)malloc(sizeof(float) * nS * nbInstance);
+    ret->_pos = (float*)malloc(sizeof(float) * nM * nbDim * nbInstance);
+    ret->_speed = 
+      (float*)malloc(sizeof(float) * nM * nbDim * nbInstance);
+    ret->_stress = 
+      (float*)malloc(sizeof(float) * nM * nbDim * nbInstance);
+    ret->_length = (float*)malloc(sizeof(float) * nS * nbInstance);
+    ret->_springStress = 
+      (float*)malloc(sizeof(float) * nS * nbInstance);
+    ret->_broken = (bool*)calloc(nS * nbInstance, sizeof(bool));
+    ret->_force = (float*)malloc(sizeof(float) * nbInstance);
+    ret->_dissipStep = (float*)malloc(sizeof(float) * nbInstance);
+  }
+  // If we couldn't allocate memory
+  if (ret == NULL || ret->_massId == NULL || ret->_springId == NULL || 
+    ret->_springMass == NULL || ret->_restLength == NULL || 
+    ret->_breakMin == NULL || ret->_breakMax == NULL || 
+    ret->_invMass == NULL || ret->_fixed == NULL || 
+    ret->_massIndex == NULL || ret->_springIndex == NULL || 
+    ret->_dissip == NULL || ret->_k == NULL || ret->_pos == NULL || 
+    ret->_speed == NULL || ret->_stress == NULL || 
+    ret->_length == NULL || ret->_springStress == NULL || 
+    ret->_broken == NULL || ret->_force == NULL || 
+    ret->_dissipStep == NULL) {
+    // Free memory
+    SpringSysEnsembleFree(&ret);
+  // Else, we could allocate memory
+  } else {
+    // Copy the masses into all the instances
+    for (int iMass = 0; iMass < soa->_nbMass; ++iMass) {
+      ret->_massId[iMass] = soa->_massId[iMass];
+      ret->_invMass[iMass] = soa->_invMass[iMass];
+      ret->_fixed[iMass] = soa->_fixed[iMass];
+      for (int iDim = 0; iDim < nbDim; ++iDim) {
+        int j = iMass * nbDim + iDim;
+        for (int iInst = 0; iInst < nbInstance; ++iInst) {
+          ret->_pos[j * nbInstance + iInst] = soa->_pos[j];
+          ret->_speed[j * nbInstance + iInst] = soa->_speed[j];
+          ret->_stress[j * nbInstance + iInst] = soa->_stress[j];
+        }
+      }
+    }
+    // Copy the springs into all the instances
+    for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+      ret->_springId[iSpring] = soa->_springId[iSpring];
+      ret->_springMass[2 * iSpring] = soa->_springMass[2 * iSpring];
+      ret->_springMass[2 * iSpring + 1] = 
+        soa->_springMass[2 * iSpring + 1];
+      ret->_restLength[iSpring] = soa->_restLength[iSpring];
+      if (soa->_breakable[iSpring]) {
+        ret->_breakMin[iSpring] = soa->_maxStress[2 * iSpring];
+        ret->_breakMax[iSpring] = soa->_maxStress[2 * iSpring + 1];
+      } else {
+        ret->_breakMin[iSpring] = -INFINITY;
+        ret->_breakMax[iSpring] = INFINITY;
+      }
+      for (int iInst = 0; iInst < nbInstance; ++iInst) {
+        int j = iSpring * nbInstance + iInst;
+        ret->_k[j] = soa->_k[iSpring];
+        ret->_length[j] = soa->_length[iSpring];
+        ret->_springStress[j] = soa->_springStress[iSpring];
+      }
+    }
+    for (int iInst = 0; iInst < nbInstance; ++iInst)
+      ret->_dissip[iInst] = sys->_dissip;
+    // Index the masses and springs by id (the indexed element is the
+    // id in the ensemble, to get back its position)
+    bool ok = true;
+    for (int iMass = 0; ok && iMass < ret->_nbMass; ++iMass)
+      ok = SpringSysIndexAdd(ret->_massIndex, ret->_massId[iMass], 
+        ret->_massId + iMass);
+    for (int iSpring = 0; ok && iSpring < ret->_nbSpring; ++iSpring)
+      ok = SpringSysIndexAdd(ret->_springIndex, ret->_springId[iSpring],
+        ret->_springId + iSpring);
+    if (!ok)
+      SpringSysEnsembleFree(&ret);
+  }
+  // If the SpringSys wasn't packed, release the packed arrays
+  if (!packed)
+    SpringSysSoAUnpack(sys);
+  // Return the new ensemble
+  return ret;  
+}
+
+// Free the memory used by the ensemble 'ens'
+// Do nothing if arguments are invalid
+void SpringSysEnsembleFree(SpringSysEnsemble **ens) {
+  // Check arguments
+  if (ens == NULL || *ens == NULL)
+    return;
+  // Stop the threads
+  SpringSysThreadPoolFree(&((*ens)->_threadPool));
+  // Free memory
+  free((*ens)->_massId);
+  free((*ens)->_springId);
+  free((*ens)->_springMass);
+  free((*ens)->_restLength);
+  free((*ens)->_breakMin);
+  free((*ens)->_breakMax);
+  free((*ens)->_invMass);
+  free((*ens)->_fixed);
+  SpringSysIndexFree(&((*ens)->_massIndex));
+  SpringSysIndexFree(&((*ens)->_springIndex));
+  free((*ens)->_dissip);
+  free((*ens)->_k);
+  free((*ens)->_pos);
+  free((*ens)->_speed);
+  free((*ens)->_stress);
+  free((*ens)->_length);
+  free((*ens)->_springStress);
+  free((*ens)->_broken);
+  free((*ens)->_force);
+  free((*ens)->_dissipStep);
+  free(*ens);
+  *ens = NULL;
+}
+
+// Get the number of instances of the ensemble 'ens'
+// Return 0 if arguments are invalid
+int SpringSysEnsembleGetNbInstance(SpringSysEnsemble *ens) {
+  // Check arguments
+  if (ens == NULL)
+    return 0;
+  // Return the number of instances
+  return ens->_nbInstance;
+}
+
+// Set the number of threads used to step the ensemble 'ens' to 
+// 'nbThread'
+// Do nothing if arguments are invalid
+void SpringSysEnsembleSetNbThread(SpringSysEnsemble *ens, 
+  int nbThread) {
+  // Check arguments
+  if (ens == NULL || nbThread < 1)
+    return;
+  // If the number of threads changes
+  if (nbThread != ens->_nbThread) {
+    // Stop the current threads, the new ones are created at the next 
+    // step
+    SpringSysThreadPoolFree(&(ens->_threadPool));
+    // Set the number of threads
+    ens->_nbThread = nbThread;
+  }
+}
+
+// Set the dissipation coefficient of the instance 'iInst' of the 
+// ensemble 'ens' to 'dissip' in [0.0,1.0]
+// Do nothing if arguments are invalid
+void SpringSysEnsembleSetDissip(SpringSysEnsemble *ens, int iInst, 
+  float dissip) {
+  // Check arguments
+  if (ens == NULL || iInst < 0 || iInst >= ens->_nbInstance || 
+    dissip < 0.0 || dissip > 1.0)
+    return;
+  // Set the dissipation
+  ens->_dissip[iInst] = dissip;
+}
+
+// Set the K coefficient of the spring identified by 'id' in the 
+// instance 'iInst' of the ensemble 'ens' to 'k'
+// Return false if arguments are invalid or there is no spring with 
+// this id, else return true
+bool SpringSysEnsembleSetK(SpringSysEnsemble *ens, int iInst, int id,
+  float k) {
+  // Check arguments
+  if (ens == NULL || iInst < 0 || iInst >= ens->_nbInstance)
+    return false;
+  // Get the spring
+  int *springId = (int*)SpringSysIndexGet(ens->_springIndex, id);
+  if (springId == NULL)
+    return false;
+  // Set the K coefficient
+  ens->_k[(springId - ens->_springId) * ens->_nbInstance + iInst] = k;
+  // Return true
+  return true;
+}
+
+// Get the position of the mass identified by 'id' in the ensemble 
+// 'ens'
+// Return -1 if there is no mass with this id
+static int SpringSysEnsembleGetMassSlot(SpringSysEnsemble *ens, 
+  int id) {
+  int *massId = (int*)SpringSysIndexGet(ens->_massIndex, id);
+  return (massId == NULL ? -1 : massId - ens->_massId);
+}
+
+// Set the position of the mass identified by 'id' in the instance 
+// 'iInst' of the ensemble 'ens' to 'pos' (_nbDim values)
+// Return false if arguments are invalid or there is no mass with 
+// this id, else return true
+bool SpringSysEnsembleSetMassPos(SpringSysEnsemble *ens, int iInst, 
+  int id, const float *pos) {
+  // Check arguments
+  if (ens == NULL || pos == NULL || iInst < 0 || 
+    iInst >= ens->_nbInstance)
+    return false;
+  // Get the mass
+  int iMass = SpringSysEnsembleGetMassSlot(ens, id);
+  if (iMass == -1)
+    return false;
+  // Set the position
+  for (int iDim = 0; iDim < ens->_nbDim; ++iDim)
+    ens->_pos[(iMass * ens->_nbDim + iDim) * ens->_nbInstance + iInst] =
+      pos[iDim];
+  // Return true
+  return true;
+}
+
+// Set the speed of the mass identified by 'id' in the instance 
+// 'iInst' of the ensemble 'ens' to 'speed' (_nbDim values)
+// Return false if arguments are invalid or there is no mass with 
+// this id, else return true
+bool SpringSysEnsembleSetMassSpeed(SpringSysEnsemble *ens, int iInst, 
+  int id, const float *speed) {
+  // Check arguments
+  if (ens == NULL || speed == NULL || iInst < 0 || 
+    iInst >= ens->_nbInstance)
+    return false;
+  // Get the mass
+  int iMass = SpringSysEnsembleGetMassSlot(ens, id);
+  if (iMass == -1)
+    return false;
+  // Set the speed
+  for (int iDim = 0; iDim < ens->_nbDim; ++iDim)
+    ens->_speed[(iMass * ens->_nbDim + iDim) * ens->_nbInstance + 
+      iInst] = speed[iDim];
+  // Return true
+  return true;
+}
+
+// Get the position of the mass identified by 'id' in the instance 
+// 'iInst' of the ensemble 'ens' into 'pos' (_nbDim values)
+// Return false if arguments are invalid or there is no mass with 
+// this id, else return true
+bool SpringSysEnsembleGetMassPos(SpringSysEnsemble *ens, int iInst, 
+  int id, float *pos) {
+  // Check arguments
+  if (ens == NULL || pos == NULL || iInst < 0 || 
+    iInst >= ens->_nbInstance)
+    return false;
+  // Get the mass
+  int iMass = SpringSysEnsembleGetMassSlot(ens, id);
+  if (iMass == -1)
+    return false;
+  // Get the position
+  for (int iDim = 0; iDim < ens->_nbDim; ++iDim)
+    pos[iDim] = 
+      ens->_pos[(iMass * ens->_nbDim + iDim) * ens->_nbInstance + iInst];
+  // Return true
+  return true;
+}
+
+// Get the speed of the mass identified by 'id' in the instance 
+// 'iInst' of the ensemble 'ens' into 'speed' (_nbDim values)
+// Return false if arguments are invalid or there is no mass with 
+// this id, else return true
+bool SpringSysEnsembleGetMassSpeed(SpringSysEnsemble *ens, int iInst, 
+  int id, float *speed) {
+  // Check arguments
+  if (ens == NULL || speed == NULL || iInst < 0 || 
+    iInst >= ens->_nbInstance)
+    return false;
+  // Get the mass
+  int iMass = SpringSysEnsembleGetMassSlot(ens, id);
+  if (iMass == -1)
+    return false;
+  // Get the speed
+  for (int iDim = 0; iDim < ens->_nbDim; ++iDim)
+    speed[iDim] = ens->_speed[(iMass * ens->_nbDim + iDim) * 
+      ens->_nbInstance + iInst];
+  // Return true
+  return true;
+}
+
+// Step in time by 'dt' all the instances of the ensemble 'ens'
+// Do nothing if arguments are invalid
+void SpringSysEnsembleStep(SpringSysEnsemble *ens, float dt) {
+  // Check arguments
+  if (ens == NULL)
+    return;
+  // Declare the argument of the job
+  SpringSysEnsembleStepArg arg = {._ens = ens, ._dt = dt};
+  // If the ensemble uses several threads, create them if necessary
+  if (ens->_nbThread > 1 && ens->_threadPool == NULL)
+    ens->_threadPool = SpringSysThreadPoolCreate(ens->_nbThread);
+  // If there are threads
+  if (ens->_threadPool != NULL)
+    // Step the instances on all the threads
+    SpringSysThreadPoolRun(ens->_threadPool, SpringSysEnsembleStepJob,
+      &arg);
+  // Else, step the instances on the calling thread
+  else
+    SpringSysEnsembleStepJob(&arg, 0, 1);
+}
+
+// Step in time the ensemble, part of the thread 'iThread' among 
+// 'nbThread', 'arg' is a SpringSysEnsembleStepArg
+static void SpringSysEnsembleStepJob(void *arg, int iThread, 
+  int nbThread) {
+  SpringSysEnsembleStepArg *step = (SpringSysEnsembleStepArg*)arg;
+  SpringSysEnsemble *ens = step->_ens;
+  // Get the instances of this thread
+  int first = (int)((long)ens->_nbInstance * iThread / nbThread);
+  int last = (int)((long)ens->_nbInstance * (iThread + 1) / nbThread);
+  // Step them with the kernel specialized for the number of dimensions
+  switch (ens->_nbDim) {
+    case 1:
+      SpringSysEnsembleStepDim(ens, step->_dt, first, last, 1);
+      break;
+    case 2:
+      SpringSysEnsembleStepDim(ens, step->_dt, first, last, 2);
+      break;
+    default:
+      SpringSysEnsembleStepDim(ens, step->_dt, first, last, 3);
+      break;
+  }
+}
+
+// Step in time by 'dt' the instances at positions [first, last[ of 
+// the ensemble 'ens' with 'nbDim' dimensions
+SPRINGSYS_KERNEL void SpringSysEnsembleStepDim(SpringSysEnsemble *ens,
+  float dt, int first, int last, int nbDim) {
+  int nbInst = ens->_nbInstance;
+  float *f = ens->_force;
+  // Get the dissipation of the instances over the step
+  for (int iInst = first; iInst < last; ++iInst)
+    ens->_dissipStep[iInst] = pow(1.0 - ens->_dissip[iInst], dt);
+  // Reset the stress of unfixed masses
+  for (int iMass = 0; iMass < ens->_nbMass; ++iMass)
+    if (ens->_fixed[iMass] == false)
+      for (int iDim = 0; iDim < nbDim; ++iDim) {
+        float *stress = ens->_stress + (iMass * nbDim + iDim) * nbInst;
+        for (int iInst = first; iInst < last; ++iInst)
+          stress[iInst] = 0.0;
+      }
+  // For each spring
+  for (int iSpring = 0; iSpring < ens->_nbSpring; ++iSpring) {
+    int iA = ens->_springMass[2 * iSpring];
+    int iB = ens->_springMass[2 * iSpring + 1];
+    float *length = ens->_length + iSpring * nbInst;
+    float *springStress = ens->_springStress + iSpring * nbInst;
+    float *k = ens->_k + iSpring * nbInst;
+    bool *broken = ens->_broken + iSpring * nbInst;
+    // Get the distance between the masses in each instance
+    for (int iInst = first; iInst < last; ++iInst)
+      length[iInst] = 0.0;
+    for (int iDim = 0; iDim < nbDim; ++iDim) {
+      float *pA = ens->_pos + (iA * nbDim + iDim) * nbInst;
+      float *pB = ens->_pos + (iB * nbDim + iDim) * nbInst;
+      for (int iInst = first; iInst < last; ++iInst)
+        length[iInst] += 
+          (pB[iInst] - pA[iInst]) * (pB[iInst] - pA[iInst]);
+    }
+    // Get the stress, the rupture and the force per unit of length in
+    // each instance
+    float restLength = ens->_restLength[iSpring];
+    float breakMin = ens->_breakMin[iSpring];
+    float breakMax = ens->_breakMax[iSpring];
+    for (int iInst = first; iInst < last; ++iInst) {
+      float l = sqrtf(length[iInst]);
+      length[iInst] = l;
+      float stress = (l - restLength) * k[iInst];
+      broken[iInst] |= (stress <= breakMin || stress >= breakMax);
+      springStress[iInst] = (broken[iInst] ? 0.0 : stress);
+      f[iInst] = (broken[iInst] || l <= SPRINGSYS_EPSILON ? 
+        0.0 : stress / l);
+    }
+    // Apply the force to the masses which are not fixed
+    for (int iDim = 0; iDim < nbDim; ++iDim) {
+      float *pA = ens->_pos + (iA * nbDim + iDim) * nbInst;
+      float *pB = ens->_pos + (iB * nbDim + iDim) * nbInst;
+      if (ens->_fixed[iA] == false) {
+        float *stress = ens->_stress + (iA * nbDim + iDim) * nbInst;
+        float invMass = ens->_invMass[iA];
+        for (int iInst = first; iInst < last; ++iInst)
+          stress[iInst] += 
+            f[iInst] * invMass * (pB[iInst] - pA[iInst]);
+      }
+      if (ens->_fixed[iB] == false) {
+        float *stress = ens->_stress + (iB * nbDim + iDim) * nbInst;
+        float invMass = ens->_invMass[iB];
+        for (int iInst = first; iInst < last; ++iInst)
+          stress[iInst] -= 
+            f[iInst] * invMass * (pB[iInst] - pA[iInst]);
+      }
+    }
+  }
+  // Apply the stress to the masses which are not fixed
+  for (int iMass = 0; iMass < ens->_nbMass; ++iMass) {
+    if (ens->_fixed[iMass] == false) {
+      for (int iDim = 0; iDim < nbDim; ++iDim) {
+        int j = (iMass * nbDim + iDim) * nbInst;
+        float *pos = ens->_pos + j;
+        float *speed = ens->_speed + j;
+        float *stress = ens->_stress + j;
+        for (int iInst = first; iInst < last; ++iInst) {
+          // Apply the dissipation to the speed
+          speed[iInst] *= ens->_dissipStep[iInst];
+          // Apply the stress to the speed
+          speed[iInst] += stress[iInst] * dt;
+          // Apply the speed to the position
+          pos[iInst] += speed[iInst] * dt;
+        }
+      }
+    }
+  }
+}
+
+// Get the momentum (sum of norm(v) of masses) of the instance 'iInst' 
+// of the ensemble 'ens'
+// Return 0.0 if the arguments are invalid
+float SpringSysEnsembleGetMomentum(SpringSysEnsemble *ens, int iInst) {
+  // Check arguments
+  if (ens == NULL || iInst < 0 || iInst >= ens->_nbInstance)
+    return 0.0;
+  // Declare a variable to memorize the sum
+  float sum = 0.0;
+  // Calculate the norm of the speed of each mass and sum it
+  for (int iMass = 0; iMass < ens->_nbMass; ++iMass) {
+    float v = 0.0;
+    for (int iDim = 0; iDim < ens->_nbDim; ++iDim) {
+      float s = ens->_speed[(iMass * ens->_nbDim + iDim) * 
+        ens->_nbInstance + iInst];
+      v += s * s;
+    }
+    sum += sqrt(v);
+  }
+  // Return the sum
+  return sum;  
+}
+
+// Get the stress (sum of abs(stress) of springs not broken) of the 
+// instance 'iInst' of the ensemble 'ens'
+// Return 0.0 if the arguments are invalid
+float SpringSysEnsembleGetStress(SpringSysEnsemble *ens, int iInst) {
+  // Check arguments
+  if (ens == NULL || iInst < 0 || iInst >= ens->_nbInstance)
+    return 0.0;
+  // Declare a variable to memorize the sum
+  float sum = 0.0;
+  // Sum the absolute value of the stress of springs (null for broken
+  // springs)
+  for (int iSpring = 0; iSpring < ens->_nbSpring; ++iSpring)
+    sum += fabs(ens->_springStress[iSpring * ens->_nbInstance + iInst]);
+  // Return the sum
+  return sum;  
+}
+
+// Get the number of broken springs in the instance 'iInst' of the 
+// ensemble 'ens'
+// Return 0 if the arguments are invalid
+int SpringSysEnsembleGetNbBroken(SpringSysEnsemble *ens, int iInst) {
+  // Check arguments
+  if (ens == NULL || iInst < 0 || iInst >= ens->_nbInstance)
+    return 0;
+  // Count the broken springs
+  int nb = 0;
+  for (int iSpring = 0; iSpring < ens->_nbSpring; ++iSpring)
+    if (ens->_broken[iSpring * ens->_nbInstance + iInst])
+      ++nb;
+  // Return the number of broken springs
+  return nb;
+}
+
+// Create a recorder of the trajectory of the SpringSys 'sys' into the
+// stream 'stream', open in binary mode and left open by 
+// SpringSysRecorderFree. 'content' is a combination of SpringSysRecord
+// and a frame is recorded every 'period' calls to 
+// SpringSysRecorderRecord. Up to 'nbQueue' frames can wait to be 
+// written, frames recorded while the queue is full are dropped.
+// Default quantization steps are 1e-4 for positions and speeds, and 
+// 1e-3 for stresses. A key frame is recorded at least every 100 
+// frames.
+// 'sys' must not be freed before the recorder
+// Return NULL if arguments are invalid or memory allocation failed
+SpringSysRecorder* SpringSysRecorderCreate(SpringSys *sys, 
+  FILE *stream, int content, int period, int nbQueue) {
+  // Check arguments
+  int all = springSysRecordPos | springSysRecordSpeed | 
+    springSysRecordStress;
+  if (sys == NULL || stream == NULL || content <= 0 || 
+    (content & ~all) != 0 || period < 1 || nbQueue < 1)
+    return NULL;
+  // Allocate memory
+  SpringSysRecorder *ret = 
+    (SpringSysRecorder*)malloc(sizeof(SpringSysRecorder));
+  if (ret == NULL)
+    return NULL;
+  SpringSysRecorderQueue *queue = 
+    (SpringSysRecorderQueue*)malloc(sizeof(SpringSysRecorderQueue));
+  if (queue == NULL) {
+    free(ret);
+    return NULL;
+  }
+  queue->_slots = (SpringSysRecorderSlot*)malloc(
+    sizeof(SpringSysRecorderSlot) * nbQueue);
+  if (queue->_slots == NULL) {
+    free(queue);
+    free(ret);
+    return NULL;
+  }
+  memset(queue->_slots, 0, sizeof(SpringSysRecorderSlot) * nbQueue);
+  // Set the properties
+  ret->_sys = sys;
+  ret->_stream = stream;
+  ret->_content = content;
+  ret->_period = period;
+  ret->_keyPeriod = 100;
+  ret->_precision[0] = 1e-4;
+  ret->_precision[1] = 1e-4;
+  ret->_precision[2] = 1e-3;
+  ret->_nbCall = 0;
+  ret->_nbFrame = 0;
+  ret->_nbDropped = 0;
+  ret->_nbSinceKey = 0;
+  ret->_topology = 0;
+  ret->_queue = queue;
+  queue->_nbDim = sys->_nbDim;
+  queue->_stream = stream;
+  queue->_nbSlot = nbQueue;
+  queue->_first = 0;
+  queue->_nbWaiting = 0;
+  queue->_quit = false;
+  queue->_error = false;
+  queue->_quant = NULL;
+  queue->_nbQuant = 0;
+  queue->_buffer = NULL;
+  queue->_bufferSize = 0;
+  // Write the header of the stream
+  unsigned char header[SPRINGSYS_TRAJ_HEADER];
+  memcpy(header, SPRINGSYS_TRAJ_MAGIC, 8);
+  SpringSysPutU32(header + 8, SPRINGSYS_TRAJ_VERSION);
+  SpringSysPutU32(header + 12, sys->_nbDim);
+  bool ok = (fwrite(header, 1, SPRINGSYS_TRAJ_HEADER, stream) == 
+    SPRINGSYS_TRAJ_HEADER);
+  // Start the writing thread
+  pthread_mutex_init(&(queue->_mutex), NULL);
+  pthread_cond_init(&(queue->_condQueued), NULL);
+  pthread_cond_init(&(queue->_condWritten), NULL);
+  ok = ok && (pthread_create(&(queue->_thread), NULL, 
+    SpringSysRecorderWriter, queue) == 0);
+  // If we couldn't write the header or start the thread
+  if (!ok) {
+    // Free memory
+    pthread_mutex_destroy(&(queue->_mutex));
+    pthread_cond_destroy(&(queue->_condQueued));
+    pthread_cond_destroy(&(queue->_condWritten));
+    free(queue->_slots);
+    free(queue);
+    free(ret);
+    // Return NULL
+    return NULL;
+  }
+  // Return the new recorder
+  return ret;
+}
+
+// Write the frames waiting in the queue of the recorder 'rec', stop its
+// thread and free its memory
+void SpringSysRecorderFree(SpringSysRecorder **rec) {
+  // Check arguments
+  if (rec == NULL || *rec == NULL)
+    return;
+  SpringSysRecorderQueue *queue = (*rec)->_queue;
+  // Stop the writing thread once the queue is empty
+  pthread_mutex_lock(&(queue->_mutex));
+  queue->_quit = true;
+  pthread_cond_signal(&(queue->_condQueued));
+  pthread_mutex_unlock(&(queue->_mutex));
+  pthread_join(queue->_thread, NULL);
+  fflush(queue->_stream);
+  // Free memory
+  pthread_mutex_destroy(&(queue->_mutex));
+  pthread_cond_destroy(&(queue->_condQueued));
+  pthread_cond_destroy(&(queue->_condWritten));
+  for (int iSlot = 0; iSlot < queue->_nbSlot; ++iSlot) {
+    SpringSysRecorderSlot *slot = queue->_slots + iSlot;
+    free(slot->_massId);
+    free(slot->_springId);
+    free(slot->_pos);
+    free(slot->_speed);
+    free(slot->_stress);
+  }
+  free(queue->_slots);
+  free(queue->_quant);
+  free(queue->_buffer);
+  free(queue);
+  free(*rec);
+  *rec = NULL;
+}
+
+// Set the quantization step of the values of the kind 'what' (one of
+// SpringSysRecord) of the recorder 'rec' to 'precision'
+// Return false if arguments are invalid, else return true
+bool SpringSysRecorderSetPrecision(SpringSysRecorder *rec, 
+  SpringSysRecord what, float precision) {
+  // Check arguments
+  if (rec == NULL || !(precision > 0.0) || isinf(precision))
+    return false;
+  // Set the quantization step of the kind of values
+  switch (what) {
+    case springSysRecordPos:
+      rec->_precision[0] = precision;
+      break;
+    case springSysRecordSpeed:
+      rec->_precision[1] = precision;
+      break;
+    case springSysRecordStress:
+      rec->_precision[2] = precision;
+      break;
+    default:
+      return false;
+  }
+  // Make the next frame a key frame rather than encoding differences 
+  // between values quantized with different steps
+  rec->_topology = 0;
+  return true;
+}
+
+// Set the largest number of frames between two key frames of the 
+// recorder 'rec' to 'nb'
+void SpringSysRecorderSetKeyPeriod(SpringSysRecorder *rec, int nb) {
+  // Check arguments
+  if (rec == NULL || nb < 1)
+    return;
+  // Set the period
+  rec->_keyPeriod = nb;
+}
+
+// Count one call for the recorder 'rec', and if it is time to record a
+// frame queue a snapshot of its SpringSys, labeled with the time 't'.
+// Meant to be called after each step, it never waits for the stream.
+// Return false if the frame has been dropped (queue full or memory
+// allocation failed), else return true
+bool SpringSysRecorderRecord(SpringSysRecorder *rec, float t) {
+  // Check arguments
+  if (rec == NULL)
+    return false;
+  // Count the call, and if it's not time to record a frame stop here
+  int step = (rec->_nbCall)++;
+  if (step % rec->_period != 0)
+    return true;
+  SpringSysRecorderQueue *queue = rec->_queue;
+  SpringSys *sys = rec->_sys;
+  // Get the slot following the frames waiting in the queue, the 
+  // writing thread doesn't use it until it is queued
+  pthread_mutex_lock(&(queue->_mutex));
+  bool full = (queue->_nbWaiting == queue->_nbSlot);
+  SpringSysRecorderSlot *slot = queue->_slots + 
+    (queue->_first + queue->_nbWaiting) % queue->_nbSlot;
+  pthread_mutex_unlock(&(queue->_mutex));
+  // If the queue is full or we couldn't make room in the slot, drop 
+  // the frame
+  if (full || !SpringSysRecorderSlotReserve(slot, sys->_nbDim, 
+    rec->_content, sys->_masses->_nbElem, sys->_springs->_nbElem)) {
+    ++(rec->_nbDropped);
+    return false;
+  }
+  // The frame is a key frame if the topology has been modified since
+  // the last frame or the last key frame is too old
+  unsigned long topology = SpringSysGetTopology(sys);
+  bool key = (topology != rec->_topology || 
+    rec->_nbSinceKey >= rec->_keyPeriod);
+  // Set the properties of the frame
+  slot->_step = step;
+  slot->_time = t;
+  slot->_content = rec->_content;
+  slot->_key = key;
+  memcpy(slot->_precision, rec->_precision, sizeof(float) * 3);
+  slot->_nbMass = sys->_masses->_nbElem;
+  slot->_nbSpring = sys->_springs->_nbElem;
+  // Copy the state of the masses in the order of the GSet. If the 
+  // SpringSys is packed, its records are not all handed out and each 
+  // mass has its own id, the state is read from the packed arrays, 
+  // except for the records handed out. The packed masses may have 
+  // been reordered (cf SpringSysSoAPermuteMasses), in which case the 
+  // position of a mass in the arrays is given by the index. Else, the
+  // records are updated and the state is read from them.
+  int nbDim = sys->_nbDim;
+  bool pos = ((rec->_content & springSysRecordPos) != 0);
+  bool speed = ((rec->_content & springSysRecordSpeed) != 0);
+  SpringSysSoA *soa = sys->_soa;
+  bool packed = (soa != NULL && !soa->_allOut && 
+    sys->_massIndex->_nbElem == soa->_nbMass);
+  if (soa != NULL && !packed)
+    SpringSysSoAPullAll(sys);
+  int iMass = 0;
+  GSetElem *e = sys->_masses->_head;
+  while (e != NULL) {
+    SpringSysMass *m = (SpringSysMass*)(e->_data);
+    const float *p = m->_pos;
+    const float *v = m->_speed;
+    if (packed) {
+      int iSlot = iMass;
+      if (soa->_massRec[iSlot] != m)
+        iSlot = SpringSysIndexGetEntry(sys->_massIndex, m->_id)->_slot;
+      if (!soa->_massOut[iSlot]) {
+        p = soa->_pos + iSlot * nbDim;
+        v = soa->_speed + iSlot * nbDim;
+      }
+    }
+    if (key)
+      slot->_massId[iMass] = m->_id;
+    if (pos)
+      memcpy(slot->_pos + iMass * nbDim, p, sizeof(float) * nbDim);
+    if (speed)
+      memcpy(slot->_speed + iMass * nbDim, v, sizeof(float) * nbDim);
+    ++iMass;
+    e = e->_next;
+  }
+  // Copy the state of the springs, from their records in the order of
+  // the GSet (the order of the packed arrays may change without 
+  // modification of the topology)
+  bool stress = ((rec->_content & springSysRecordStress) != 0);
+  if (key || stress) {
+    // If the SpringSys is packed, update the stress of the records
+    if (stress && soa != NULL && !soa->_allOut) {
+      for (int iSpring = 0; iSpring < soa->_nbSpring; ++iSpring) {
+        SpringSysSpring *s = soa->_springRec[iSpring];
+        if (s != NULL && !soa->_springOut[iSpring])
+          s->_stress = soa->_springStress[iSpring];
+      }
+    }
+    int iSpring = 0;
+    e = sys->_springs->_head;
+    while (e != NULL) {
+      SpringSysSpring *s = (SpringSysSpring*)(e->_data);
+      if (key)
+        slot->_springId[iSpring] = s->_id;
+      if (stress)
+        slot->_stress[iSpring] = s->_stress;
+      ++iSpring;
+      e = e->_next;
+    }
+  }
+  // Update the state of the recorder
+  rec->_topology = topology;
+  rec->_nbSinceKey = (key ? 1 : rec->_nbSinceKey + 1);
+  ++(rec->_nbFrame);
+  // Queue the frame
+  pthread_mutex_lock(&(queue->_mutex));
+  ++(queue->_nbWaiting);
+  pthread_cond_signal(&(queue->_condQueued));
+  pthread_mutex_unlock(&(queue->_mutex));
+  // Return true
+  return true;
+}
+
+// Wait until the frames queued in the recorder 'rec' are written and 
+// flush its stream
+// Return false if an error occured while writing frames, else true
+bool SpringSysRecorderFlush(SpringSysRecorder *rec) {
+  // Check arguments
+  if (rec == NULL)
+    return false;
+  SpringSysRecorderQueue *queue = rec->_queue;
+  // Wait for the writing thread to empty the queue
+  pthread_mutex_lock(&(queue->_mutex));
+  while (queue->_nbWaiting > 0)
+    pthread_cond_wait(&(queue->_condWritten), &(queue->_mutex));
+  bool error = queue->_error;
+  pthread_mutex_unlock(&(queue->_mutex));
+  // Flush the stream
+  if (fflush(rec->_stream) != 0)
+    error = true;
+  // Return the status
+  return !error;
+}
+
+// Create a frame to read a trajectory recorded with a SpringSysRecorder
+// Return NULL if memory allocation failed
+SpringSysFrame* SpringSysFrameCreate(void) {
+  // Allocate memory
+  SpringSysFrame *ret = (SpringSysFrame*)malloc(sizeof(SpringSysFrame));
+  if (ret == NULL)
+    return NULL;
+  // Set the properties, the header of the stream hasn't been read yet
+  ret->_nbDim = 0;
+  ret->_step = 0;
+  ret->_time = 0.0;
+  ret->_content = 0;
+  ret->_key = false;
+  ret->_nbMass = 0;
+  ret->_nbSpring = 0;
+  ret->_massId = NULL;
+  ret->_springId = NULL;
+  ret->_pos = NULL;
+  ret->_speed = NULL;
+  ret->_stress = NULL;
+  ret->_quant = NULL;
+  ret->_nbQuant = -1;
+  ret->_buffer = NULL;
+  ret->_bufferSize = 0;
+  // Return the new frame
+  return ret;
+}
+
+// Free the memory used by the frame 'frame'
+void SpringSysFrameFree(SpringSysFrame **frame) {
+  // Check arguments
+  if (frame == NULL || *frame == NULL)
+    return;
+  // Free memory
+  free((*frame)->_massId);
+  free((*frame)->_springId);
+  free((*frame)->_pos);
+  free((*frame)->_speed);
+  free((*frame)->_stress);
+  free((*frame)->_quant);
+  free((*frame)->_buffer);
+  free(*frame);
+  *frame = NULL;
+}
+
+// Read the next frame of the trajectory in the stream 'stream' into 
+// 'frame', which must have read the previous frames of the stream
+// Return 0 in case of success, or:
+// 1: invalid arguments
+// 2: can't allocate memory
+// 3: invalid data
+// 4: end of the stream
+int SpringSysFrameRead(SpringSysFrame *frame, FILE *stream) {
+  // Check arguments
+  if (frame == NULL || stream == NULL)
+    return 1;
+  // If the header of the stream hasn't been read yet
+  if (frame->_nbDim == 0) {
+    // Read the header and check it
+    unsigned char header[SPRINGSYS_TRAJ_HEADER];
+    size_t nb = fread(header, 1, SPRINGSYS_TRAJ_HEADER, stream);
+    if (nb == 0)
+      return 4;
+    uint32_t version = SpringSysGetU32(header + 8);
+    uint32_t nbDim = SpringSysGetU32(header + 12);
+    if (nb != SPRINGSYS_TRAJ_HEADER || 
+      memcmp(header, SPRINGSYS_TRAJ_MAGIC, 8) != 0 || version < 1 ||
+      version > SPRINGSYS_TRAJ_VERSION || nbDim < 1 || nbDim > 3)
+      return 3;
+    frame->_nbDim = nbDim;
+  }
+  // Read the size of the frame
+  unsigned char sizeFrame[4];
+  size_t nb = fread(sizeFrame, 1, 4, stream);
+  if (nb == 0)
+    return 4;
+  uint32_t size = SpringSysGetU32(sizeFrame);
+  if (nb != 4 || size < SPRINGSYS_TRAJ_FRAME - 4 || size % 4 != 0 ||
+    size > INT_MAX)
+    return 3;
+  // Read the frame
+  if (size > frame->_bufferSize) {
+    unsigned char *buffer = (unsigned char*)realloc(frame->_buffer, size);
+    if (buffer == NULL)
+      return 2;
+    frame->_buffer = buffer;
+    frame->_bufferSize = size;
+  }
+  if (fread(frame->_buffer, 1, size, stream) != size)
+    return 3;
+  // Decode the frame
+  int ret = SpringSysFrameDecode(frame, size);
+  // If we couldn't decode it, the values of the frame are lost and the
+  // next frame must be a key frame
+  if (ret != 0)
+    frame->_nbQuant = -1;
+  // Return the code
+  return ret;
+}
+
+// Write 'v' zigzag encoded as a variable length integer at 'p' (1 to 
+// 10 bytes, 7 bits per byte, least significant first)
+// Return the position following the integer
+static inline unsigned char* SpringSysPutVarint(unsigned char *p, 
+  int64_t v) {
+  // Interleave positive and negative values so that small values of 
+  // any sign have few significant bits
+  uint64_t u = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+  while (u >= 0x80) {
+    *(p++) = (unsigned char)(u | 0x80);
+    u >>= 7;
+  }
+  *(p++) = (unsigned char)u;
+  return p;
+}
+
+// Read the variable length integer at '*p' (cf SpringSysPutVarint), 
+// which must end before 'end', into 'v' and move '*p' after it
+// Return false if the integer is invalid, else return true
+static inline bool SpringSysGetVarint(const unsigned char **p, 
+  const unsigned char *end, int64_t *v) {
+  uint64_t u = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (*p >= end)
+      return false;
+    unsigned char c = *((*p)++);
+    u |= (uint64_t)(c & 0x7F) << shift;
+    if (c < 0x80) {
+      *v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Return the value 'v' quantized with the step 'precision'
+static inline int64_t SpringSysQuantize(float v, float precision) {
+  double x = (double)v / (double)precision;
+  // Saturate the values out of range, NaN are quantized as 0
+  if (isnan(x))
+    return 0;
+  if (x > 4.0e18)
+    x = 4.0e18;
+  else if (x < -4.0e18)
+    x = -4.0e18;
+  return (int64_t)llround(x);
+}
+
+// Make room in the slot 'slot' for a frame of 'nbMass' masses with 
+// 'nbDim' dimensions and 'nbSpring' springs and the contents 'content'
+// Return false if memory allocation failed, else return true
+static bool SpringSysRecorderSlotReserve(SpringSysRecorderSlot *slot, 
+  int nbDim, int content, int nbMass, int nbSpring) {
+  // Enlarge the arrays of masses if necessary
+  if (nbMass > slot->_massSize) {
+    int *id = (int*)realloc(slot->_massId, sizeof(int) * nbMass);
+    if (id == NULL)
+      return false;
+    slot->_massId = id;
+    size_t size = sizeof(float) * nbMass * nbDim;
+    if ((content & springSysRecordPos) != 0) {
+      float *pos = (float*)realloc(slot->_pos, size);
+      if (pos == NULL)
+        return false;
+      slot->_pos = pos;
+    }
+    if ((content & springSysRecordSpeed) != 0) {
+      float *speed = (float*)realloc(slot->_speed, size);
+      if (speed == NULL)
+        return false;
+      slot->_speed = speed;
+    }
+    slot->_massSize = nbMass;
+  }
+  // Enlarge the arrays of springs if necessary
+  if (nbSpring > slot->_springSize) {
+    int *id = (int*)realloc(slot->_springId, sizeof(int) * nbSpring);
+    if (id == NULL)
+      return false;
+    slot->_springId = id;
+    if ((content & springSysRecordStress) != 0) {
+      float *stress = 
+        (float*)realloc(slot->_stress, sizeof(float) * nbSpring);
+      if (stress == NULL)
+        return false;
+      slot->_stress = stress;
+    }
+    slot->_springSize = nbSpring;
+  }
+  // Return true
+  return true;
+}
+
+// Main function of the writing thread of a recorder, 'arg' is the 
+// SpringSysRecorderQueue
+static void* SpringSysRecorderWriter(void *arg) {
+  SpringSysRecorderQueue *queue = (SpringSysRecorderQueue*)arg;
+  pthread_mutex_lock(&(queue->_mutex));
+  // Loop until the recorder is freed and the queue is empty
+  while (true) {
+    // Wait for a frame
+    while (queue->_nbWaiting == 0 && !queue->_quit)
+      pthread_cond_wait(&(queue->_condQueued), &(queue->_mutex));
+    if (queue->_nbWaiting == 0)
+      break;
+    SpringSysRecorderSlot *slot = queue->_slots + queue->_first;
+    bool error = queue->_error;
+    pthread_mutex_unlock(&(queue->_mutex));
+    // Encode and write the frame, unless a previous frame couldn't be
+    // written
+    if (!error)
+      error = !SpringSysRecorderWrite(queue, slot);
+    // Release the slot
+    pthread_mutex_lock(&(queue->_mutex));
+    queue->_error = error;
+    queue->_first = (queue->_first + 1) % queue->_nbSlot;
+    --(queue->_nbWaiting);
+    pthread_cond_broadcast(&(queue->_condWritten));
+  }
+  pthread_mutex_unlock(&(queue->_mutex));
+  return NULL;
+}
+
+// Encode the frame 'slot' of the recorder queue 'queue' and write it
+// Return false if the frame couldn't be written, else return true
+static bool SpringSysRecorderWrite(SpringSysRecorderQueue *queue, 
+  SpringSysRecorderSlot *slot) {
+  // Get the values of the frame, their quantization step and number
+  const float *values[3] = {NULL, NULL, NULL};
+  int nbValue[3] = {0, 0, 0};
+  if ((slot->_content & springSysRecordPos) != 0) {
+    values[0] = slot->_pos;
+    nbValue[0] = slot->_nbMass * queue->_nbDim;
+  }
+  if ((slot->_content & springSysRecordSpeed) != 0) {
+    values[1] = slot->_speed;
+    nbValue[1] = slot->_nbMass * queue->_nbDim;
+  }
+  if ((slot->_content & springSysRecordStress) != 0) {
+    values[2] = slot->_stress;
+    nbValue[2] = slot->_nbSpring;
+  }
+  int nbQuant = nbValue[0] + nbValue[1] + nbValue[2];
+  // The values of a key frame are quantized without reference, else 
+  // they are the differences with the values of the previous frame, 
+  // which has the same number of values
+  if (slot->_key) {
+    if (nbQuant > queue->_nbQuant) {
+      int64_t *quant = 
+        (int64_t*)realloc(queue->_quant, sizeof(int64_t) * nbQuant);
+      if (quant == NULL)
+        return false;
+      queue->_quant = quant;
+    }
+    queue->_nbQuant = nbQuant;
+  } else if (nbQuant != queue->_nbQuant) {
+    // This should never happen
+    return false;
+  }
+  // Make room for the encoded frame in the worst case
+  size_t size = SPRINGSYS_TRAJ_FRAME + (size_t)nbQuant * 10 + 3;
+  if (slot->_key)
+    size += ((size_t)slot->_nbMass + slot->_nbSpring) * 10;
+  if (size > queue->_bufferSize) {
+    unsigned char *buffer = 
+      (unsigned char*)realloc(queue->_buffer, size);
+    if (buffer == NULL)
+      return false;
+    queue->_buffer = buffer;
+    queue->_bufferSize = size;
+  }
+  unsigned char *data = queue->_buffer + SPRINGSYS_TRAJ_FRAME;
+  unsigned char *p = data;
+  // Encode the ids of masses and springs of key frames, as the 
+  // differences with the previous id
+  if (slot->_key) {
+    int64_t prev = 0;
+    for (int iMass = 0; iMass < slot->_nbMass; ++iMass) {
+      p = SpringSysPutVarint(p, slot->_massId[iMass] - prev);
+      prev = slot->_massId[iMass];
+    }
+    prev = 0;
+    for (int iSpring = 0; iSpring < slot->_nbSpring; ++iSpring) {
+      p = SpringSysPutVarint(p, slot->_springId[iSpring] - prev);
+      prev = slot->_springId[iSpring];
+    }
+  }
+  // Encode the values
+  int64_t *quant = queue->_quant;
+  for (int iKind = 0; iKind < 3; ++iKind) {
+    for (int iValue = 0; iValue < nbValue[iKind]; ++iValue) {
+      int64_t q = 
+        SpringSysQuantize(values[iKind][iValue], slot->_precision[iKind]);
+      p = SpringSysPutVarint(p, (slot->_key ? q : q - *quant));
+      *(quant++) = q;
+    }
+  }
+  // Pad the data to a multiple of 4 bytes
+  while ((p - data) % 4 != 0)
+    *(p++) = 0;
+  size_t sizeData = p - data;
+  // Encode the header of the frame
+  unsigned char *header = queue->_buffer;
+  SpringSysPutU32(header, SPRINGSYS_TRAJ_FRAME - 4 + sizeData);
+  SpringSysPutU32(header + 4, 
+    slot->_content | (slot->_key ? SPRINGSYS_TRAJ_KEY : 0));
+  SpringSysPutU32(header + 8, (uint32_t)(slot->_step));
+  SpringSysPutF32(header + 12, slot->_time);
+  SpringSysPutU32(header + 16, slot->_nbMass);
+  SpringSysPutU32(header + 20, slot->_nbSpring);
+  for (int iKind = 0; iKind < 3; ++iKind)
+    SpringSysPutF32(header + 24 + 4 * iKind, slot->_precision[iKind]);
+  uint64_t sum[2] = {0, 0};
+  SpringSysChecksumAdd(sum, header + 4, 32);
+  SpringSysChecksumAdd(sum, data, sizeData);
+  SpringSysPutU64(header + 36, (sum[1] << 32) | sum[0]);
+  // Write the frame
+  size = SPRINGSYS_TRAJ_FRAME + sizeData;
+  return (fwrite(queue->_buffer, 1, size, queue->_stream) == size);
+}
+
+// Reallocate the array '*ptr' to 'size' bytes, or free it if 'size' 
+// is null
+// Return false if memory allocation failed, else return true
+static bool SpringSysFrameResize(void **ptr, size_t size) {
+  // If the size is null
+  if (size == 0) {
+    // Free the array
+    free(*ptr);
+    *ptr = NULL;
+    return true;
+  }
+  // Reallocate the array
+  void *p = realloc(*ptr, size);
+  if (p == NULL)
+    return false;
+  *ptr = p;
+  return true;
+}
+
+// Decode the frame of 'size' bytes in the buffer of 'frame', following
+// the size of the frame in the stream
+// Return 0 in case of success, 2 if memory allocation failed or 3 if
+// the data are invalid
+static int SpringSysFrameDecode(SpringSysFrame *frame, size_t size) {
+  // Decode the header of the frame, whose offsets are those of 
+  // SpringSysRecorderWrite minus the size of the frame
+  const unsigned char *header = frame->_buffer;
+  int all = springSysRecordPos | springSysRecordSpeed | 
+    springSysRecordStress;
+  uint32_t flags = SpringSysGetU32(header);
+  int content = flags & all;
+  bool key = ((flags & SPRINGSYS_TRAJ_KEY) != 0);
+  uint64_t nbMass = SpringSysGetU32(header + 12);
+  uint64_t nbSpring = SpringSysGetU32(header + 16);
+  float precision[3];
+  for (int iKind = 0; iKind < 3; ++iKind)
+    precision[iKind] = SpringSysGetF32(header + 20 + 4 * iKind);
+  const unsigned char *data = header + SPRINGSYS_TRAJ_FRAME - 4;
+  const unsigned char *end = header + size;
+  // Get the number of values
+  uint64_t nbValue[3] = {0, 0, 0};
+  if ((content & springSysRecordPos) != 0)
+    nbValue[0] = nbMass * frame->_nbDim;
+  if ((content & springSysRecordSpeed) != 0)
+    nbValue[1] = nbMass * frame->_nbDim;
+  if ((content & springSysRecordStress) != 0)
+    nbValue[2] = nbSpring;
+  uint64_t nbQuant = nbValue[0] + nbValue[1] + nbValue[2];
+  // Check the header and the data, each id and value takes at least 
+  // one byte
+  uint64_t sizeData = end - data;
+  uint64_t sum[2] = {0, 0};
+  SpringSysChecksumAdd(sum, header, 32);
+  SpringSysChecksumAdd(sum, data, sizeData);
+  if ((flags & ~(all | SPRINGSYS_TRAJ_KEY)) != 0 || content == 0 ||
+    nbQuant > sizeData || (key && nbMass + nbSpring > sizeData) ||
+    ((sum[1] << 32) | sum[0]) != SpringSysGetU64(header + 32))
+    return 3;
+  for (int iKind = 0; iKind < 3; ++iKind)
+    if (!(precision[iKind] > 0.0) || isinf(precision[iKind]))
+      return 3;
+  // A frame which is not a key frame must follow a frame with the same
+  // contents and number of elements
+  if (!key && (frame->_nbQuant < 0 || content != frame->_content ||
+    nbMass != (uint64_t)(frame->_nbMass) || 
+    nbSpring != (uint64_t)(frame->_nbSpring)))
+    return 3;
+  // Resize the arrays of key frames and decode the ids of masses and 
+  // springs
+  if (key) {
+    size_t sizePos = (nbValue[0] > 0 ? nbValue[0] * sizeof(float) : 0);
+    size_t sizeSpeed = (nbValue[1] > 0 ? nbValue[1] * sizeof(float) : 0);
+    if (!SpringSysFrameResize((void**)&(frame->_massId), 
+        nbMass * sizeof(int)) ||
+      !SpringSysFrameResize((void**)&(frame->_springId), 
+        nbSpring * sizeof(int)) ||
+      !SpringSysFrameResize((void**)&(frame->_pos), sizePos) ||
+      !SpringSysFrameResize((void**)&(frame->_speed), sizeSpeed) ||
+      !SpringSysFrameResize((void**)&(frame->_stress), 
+        nbValue[2] * sizeof(float)) ||
+      !SpringSysFrameResize((void**)&(frame->_quant), 
+        nbQuant * sizeof(int64_t)))
+      return 2;
+    frame->_nbMass = nbMass;
+    frame->_nbSpring = nbSpring;
+    frame->_nbQuant = nbQuant;
+    int *ids[2] = {frame->_massId, frame->_springId};
+    uint64_t nbId[2] = {nbMass, nbSpring};
+    for (int iKind = 0; iKind < 2; ++iKind) {
+      int64_t prev = 0;
+      for (uint64_t iId = 0; iId < nbId[iKind]; ++iId) {
+        int64_t delta;
+        if (!SpringSysGetVarint(&data, end, &delta))
+          return 3;
+        int64_t id = (int64_t)((uint64_t)prev + (uint64_t)delta);
+        if (id < INT_MIN || id > INT_MAX)
+          return 3;
+        ids[iKind][iId] = id;
+        prev = id;
+      }
+    }
+  }
+  // Decode the values
+  float *values[3] = {frame->_pos, frame->_speed, frame->_stress};
+  int64_t *quant = frame->_quant;
+  for (int iKind = 0; iKind < 3; ++iKind) {
+    for (uint64_t iValue = 0; iValue < nbValue[iKind]; ++iValue) {
+      int64_t delta;
+      if (!SpringSysGetVarint(&data, end, &delta))
+        return 3;
+      int64_t q = (key ? delta : 
+        (int64_t)((uint64_t)(*quant) + (uint64_t)delta));
+      *(quant++) = q;
+      values[iKind][iValue] = (float)((double)q * precision[iKind]);
+    }
+  }
+  // Check the padding
+  if (end - data >= 4)
+    return 3;
+  while (data < end)
+    if (*(data++) != 0)
+      return 3;
+  // Set the properties of the frame
+  frame->_step = SpringSysGetU32(header + 4);
+  frame->_time = SpringSysGetF32(header + 8);
+  frame->_content = content;
+  frame->_key = key;
+  // Return success code
+  return 0;
+}
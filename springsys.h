@@ -10,14 +10,70 @@
 #include <math.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "gset.h"
 
 // ================= Define ==================
 
 #define SPRINGSYS_EPSILON 0.0000001
+// Number of consecutive steps under the thresholds of sleep after 
+// which an island falls asleep (cf SpringSysSetSleep)
+#define SPRINGSYS_SLEEP_NBSTEP 10
+// Highest ratio between the work of the busiest thread and the 
+// average work of threads for which a SpringSys stepped on several 
+// threads uses its islands instead of color classes (cf 
+// SpringSysSetNbThread)
+#define SPRINGSYS_ISLAND_MAXLOAD 2.0
+// Inverse of the fraction of the springs which must break before a 
+// SpringSys stepped with color classes tries its islands again
+#define SPRINGSYS_ISLAND_RETRY 64
 
 // ================= Data structure ===================
 
+typedef struct SpringSysIndexEntry {
+  // ID of the indexed element
+  int _id;
+  // Pointer to the indexed element, NULL if the entry is empty
+  void *_elem;
+  // Position of the indexed element in the packed arrays (only valid
+  // while the SpringSys is packed, cf SpringSysSoA)
+  int _slot;
+  // Springs connected to the indexed mass (cf 
+  // SpringSysGetNbSpringOfMass), in no particular order
+  struct SpringSysSpring **_incident;
+  // Number of springs connected to the indexed mass
+  int _nbIncident;
+  // Size of the array of springs connected to the indexed mass
+  int _incidentSize;
+} SpringSysIndexEntry;
+
+typedef struct SpringSysIndex {
+  // Hash table of entries (open addressing with linear probing)
+  SpringSysIndexEntry *_entries;
+  // Size of the hash table (always a power of 2)
+  int _size;
+  // Number of used entries
+  int _nbElem;
+} SpringSysIndex;
+
+// Pool of records of the same size, allocated by slabs and reused 
+// once released
+typedef struct SpringSysPool {
+  // Size of a record in bytes
+  size_t _size;
+  // Last slab allocated, the slabs are chained by their first bytes
+  void *_slab;
+  // Number of records of the next slab
+  int _slabNb;
+  // First record never used of the last slab, and number of such 
+  // records
+  char *_next;
+  int _nbNext;
+  // Records released, chained by their first bytes, and their number
+  void *_free;
+  int _nbFree;
+} SpringSysPool;
+
 typedef struct SpringSysMass {
   // ID
   int _id;
@@ -57,22 +113,503 @@ typedef struct SpringSysSpring {
   bool _breakable;
 } SpringSysSpring;
 
+// Rupture of a spring (cf SpringSysDrainRuptures)
+typedef struct SpringSysRupture {
+  // ID of the spring
+  int _id;
+  // Stress of the spring when it broke
+  float _stress;
+} SpringSysRupture;
+
+typedef enum SpringSysBackend {
+  // Masses and springs are stored only in the GSets
+  springSysBackendGSet,
+  // Masses and springs are also packed into contiguous arrays 
+  // (SpringSysSoA) on which the SpringSys is stepped
+  springSysBackendSoA
+} SpringSysBackend;
+
+// Kernels applying the forces of springs on a compiled SpringSys
+typedef enum SpringSysKernel {
+  // Portable scalar code
+  springSysKernelScalar,
+  // 8 springs at a time with AVX2 and FMA instructions
+  springSysKernelAVX2,
+  // 16 springs at a time with AVX-512 instructions
+  springSysKernelAVX512
+} SpringSysKernel;
+
+// Schemes integrating the motion of masses over a step
+typedef enum SpringSysIntegrator {
+  // Semi-implicit Euler, first order, one evaluation of the forces per
+  // step
+  springSysIntegratorEuler,
+  // Velocity Verlet, second order, one evaluation of the forces per 
+  // step (the one at the end of a step is reused by the next step)
+  springSysIntegratorVerlet,
+  // Classical Runge-Kutta, fourth order, four evaluations of the 
+  // forces per step
+  springSysIntegratorRK4,
+  // Backward Euler linearized at the beginning of the step, first 
+  // order, one evaluation of the forces and one linear solve (cf 
+  // SpringSysSetImplicitSolver) per step, stable with large steps on 
+  // stiff springs at the cost of numerical dissipation
+  springSysIntegratorImplicit
+} SpringSysIntegrator;
+
+// Topologies of the lattices built by SpringSysAddLattice, a lattice 
+// in one dimension is a chain whatever its topology
+typedef enum SpringSysLattice {
+  // Masses linked to their neighbours along each axis (grid of squares
+  // in 2D, of cubes in 3D)
+  springSysLatticeCubic,
+  // Cubic lattice with one diagonal in each square (grid of triangles
+  // in 2D), and in 3D each cube split into six tetrahedra around one of
+  // its diagonals
+  springSysLatticeTriangle,
+  // Masses linked to all their neighbours, along the axis and the 
+  // diagonals (grid of cross-braced squares in 2D, as the 2D example, 
+  // of cubes braced by the diagonals of their faces and their own 
+  // diagonals in 3D)
+  springSysLatticeBraced
+} SpringSysLattice;
+
+// Observables of a SpringSys, calculated during its steps
+typedef struct SpringSysStats {
+  // Momentum, sum of the norm of the speed of masses (cf 
+  // SpringSysGetMomentum)
+  float _momentum;
+  // Stress, sum of the absolute stress of springs (cf 
+  // SpringSysGetStress)
+  float _stress;
+  // Highest norm of the force applied by springs on an unfixed mass
+  float _maxForce;
+  // Kinetic energy, sum of 0.5.(1 + _mass).|_speed|^2 of masses
+  float _kineticEnergy;
+} SpringSysStats;
+
+typedef struct SpringSysSoA {
+  // Number of masses
+  int _nbMass;
+  // ID of masses
+  int *_massId;
+  // Position, speed and stress of masses, the _nbDim components of 
+  // the mass at position i are stored at [i * _nbDim, (i + 1) * _nbDim[
+  float *_pos;
+  float *_speed;
+  float *_stress;
+  // Inverse of the inertia of masses (1.0 / (1.0 + _mass))
+  float *_invMass;
+  // Fixed flag of masses
+  bool *_fixed;
+  // Number of springs
+  int _nbSpring;
+  // ID of springs
+  int *_springId;
+  // Position of the masses at the extremities of springs, the masses
+  // of the spring at position i are at [2 * i] and [2 * i + 1]
+  int *_springMass;
+  // K coefficient, length at rest, current length and stress of springs
+  float *_k;
+  float *_restLength;
+  float *_length;
+  float *_springStress;
+  // Limit stress (compression/extension) of springs, the limits of 
+  // the spring at position i are at [2 * i] and [2 * i + 1]
+  float *_maxStress;
+  // Breakable flag of springs
+  bool *_breakable;
+  // Records of masses and springs in the GSets, in the same order as 
+  // the arrays
+  SpringSysMass **_massRec;
+  SpringSysSpring **_springRec;
+  // Flags telling if a record has been handed out (through 
+  // SpringSysGetMass, SpringSysGetSpring, ...) since the last step, 
+  // in which case the record holds the current state of the element 
+  // and is copied back into the arrays before the next step
+  bool *_massOut;
+  bool *_springOut;
+  // List of the positions of the records handed out
+  int *_massOutList;
+  int _nbMassOut;
+  int *_springOutList;
+  int _nbSpringOut;
+  // Flag telling if all the records have been handed out
+  bool _allOut;
+  // Compiled topology (cf SpringSysCompile), pointers are null if the
+  // SpringSys is not compiled. Springs are then oriented from the mass
+  // with lowest position to the mass with highest position, and sorted
+  // by the mass at their first extremity (compressed sparse rows): the 
+  // springs whose first extremity is the mass at position i are at 
+  // positions [_rowStart[i], _rowStart[i + 1][ (_nbMass + 1 values).
+  // _rowStart is null once the springs are sorted by color classes or
+  // by islands.
+  int *_rowStart;
+  // Limits of stress out of which springs break, infinite for 
+  // unbreakable springs
+  float *_breakMin;
+  float *_breakMax;
+  // Sum of the forces applied by springs on masses (_nbMass * _nbDim 
+  // values)
+  float *_force;
+  // Color classes of the compiled topology, created at the first step 
+  // on several threads (cf SpringSysSetNbThread), pointers are null
+  // otherwise. No two springs of a class share a mass. The springs are
+  // then sorted by class (and by first mass inside a class, _rowStart
+  // is null): color of each spring, number of classes, and positions 
+  // [_colorStart[i], _colorStart[i + 1][ of the springs of the class i
+  int *_springColor;
+  int _nbColor;
+  int *_colorStart;
+  // Flag telling if the stress of unfixed masses is their acceleration
+  // at their current positions, in which case the Verlet integrator 
+  // reuses it instead of evaluating the forces again
+  bool _stressValid;
+  // Buffers of the integrators, null until the first step needing 
+  // them, and their size (in number of values)
+  float *_integBuf;
+  int _integBufSize;
+  // State of masses saved by the adaptive steps to retry a step (cf 
+  // SpringSysAdvance), null until the first adaptive step
+  float *_adaptBuf;
+  // Flag telling if ruptures are deferred until the end of an adaptive
+  // step, and flags of the springs which broke during the step (null 
+  // until the first adaptive step)
+  bool _deferRupture;
+  bool *_brokenFlag;
+  // Islands of the compiled topology, created at the first step with 
+  // sleeping islands (cf SpringSysSetSleep), pointers are null 
+  // otherwise. Two unfixed masses are in the same island if they are 
+  // connected by springs through unfixed masses. The masses and 
+  // springs are then sorted by island: island of each mass and spring,
+  // number of islands, and positions [_islandMassStart[i], 
+  // _islandMassStart[i + 1][ and [_islandSpringStart[i], 
+  // _islandSpringStart[i + 1][ of the masses and springs of the island
+  // i. The island at position _nbIsland gathers the fixed masses and 
+  // the springs between fixed masses, it never sleeps. Islands are 
+  // split when springs break.
+  int *_massIsland;
+  int *_springIsland;
+  int _nbIsland;
+  int *_islandMassStart;
+  int *_islandSpringStart;
+  // Number of consecutive steps during which each island stayed under
+  // the thresholds of sleep, flag telling if it's asleep, observables 
+  // and number of ruptures of each island at its last step
+  int *_islandCalm;
+  bool *_islandAsleep;
+  SpringSysStats *_islandStats;
+  int *_islandRupture;
+  // Thread stepping each island, islands connected through a fixed 
+  // mass are stepped by the same thread, and number of threads the 
+  // islands have been assigned to (0 if they must be assigned again)
+  int *_islandThread;
+  int _islandNbThread;
+  // Number of springs broken since the springs were sorted by color
+  // classes, after which islands are tried again
+  int _nbBrokenSinceColor;
+  // Flags of the fixed masses moved since the last step, whose springs
+  // wake their island, and flag telling if there is one
+  bool *_massWake;
+  bool _massWakeAny;
+  // Flag telling if the islands must be created again (a mass has 
+  // been fixed or unfixed)
+  bool _islandDirty;
+  // Uniform grid over the bounding box of masses, used to search masses
+  // by position (cf SpringSysGetMassByPos), null until the first search
+  // and rebuilt by the first search after masses have moved: flag 
+  // telling if it matches the current positions, size of cells, 
+  // corners of the bounding box of masses and number of cells per 
+  // dimension (1 for the dimensions over _nbDim, the last cell extends
+  // to the box), positions [_gridStart[c], _gridStart[c + 1][ in 
+  // _gridMass of the masses of the cell c (cells are ordered by first
+  // dimension first), and number of values allocated for _gridStart
+  bool _gridValid;
+  float _gridCell;
+  float _gridMin[3];
+  float _gridMax[3];
+  int _gridDim[3];
+  int *_gridStart;
+  int *_gridMass;
+  int _gridSize;
+  // Bounding volume hierarchy over the segments of springs, used to 
+  // search springs by position (cf SpringSysGetSpringByPos), null 
+  // until the first search: flag telling if it matches the current 
+  // springs, flag telling if the boxes of nodes match the current 
+  // positions (they are refit by the first search after masses have 
+  // moved) and number of refits since it was built, springs sorted by
+  // leaf, number of nodes, and for each node i the position 
+  // _bvhNode[2i] of its first child (the second one follows it) and 0,
+  // or if it's a leaf the position _bvhNode[2i] of its first spring in
+  // _bvhSpring and their number, and its box (lower corner then upper
+  // corner, _nbDim values each)
+  bool _bvhValid;
+  bool _bvhFit;
+  int _bvhNbRefit;
+  int *_bvhSpring;
+  int _bvhNbNode;
+  int *_bvhNode;
+  float *_bvhBox;
+  // Spatial hash of masses used by the collision pass (cf 
+  // SpringSysSetCollision), null until the first pass: number of 
+  // buckets (a power of 2), size of cells, coordinates of the first 
+  // cell and strides of the cells in the buckets, position 
+  // _hashStart[i] in _hashMass of the first mass of the bucket i 
+  // (_hashStart[_hashSize] is _nbMass), masses sorted by bucket, and 
+  // coordinates of the cell (3 per mass) and position of these masses
+  int _hashSize;
+  float _hashCell;
+  int _hashOrigin[3];
+  unsigned int _hashStride[3];
+  int *_hashStart;
+  int *_hashMass;
+  int *_hashCoord;
+  float *_hashPos;
+  // Masses connected by a spring to each mass, null until needed: flag
+  // telling if they match the current springs, position _adjStart[i] 
+  // in _adjMass of the first mass connected to the mass i 
+  // (_adjStart[_nbMass] is twice _nbSpring), and masses connected to 
+  // each mass
+  bool _adjValid;
+  int *_adjStart;
+  int *_adjMass;
+} SpringSysSoA;
+
 typedef struct SpringSys {
   // List of masses
   GSet *_masses;
   // List of springs
   GSet *_springs;
+  // Index of masses by id
+  SpringSysIndex *_massIndex;
+  // Pools of the records of masses and springs (cf SpringSysReserve)
+  SpringSysPool _massPool;
+  SpringSysPool _springPool;
+  // Stamp of the topology, shared with the clones of the SpringSys 
+  // until masses or springs are added to, removed from or broken in 
+  // one of them, 0 if it has not been stamped since its last 
+  // modification (cf SpringSysCopyStateInto)
+  unsigned long _topology;
   // Number of dimension of the system (in [1, 3])
   int _nbDim;
+  // Kernels specialized for the number of dimensions of the system
+  const struct SpringSysDimKernels *_dimKernels;
   // Dissipation coefficient (applied to speed of masses at each step,
   // 0.0 = no dissipation, 1.0 = total dissipation)
   float _dissip;
+  // Storage backend
+  SpringSysBackend _backend;
+  // Packed arrays of masses and springs, NULL if the SpringSys is not
+  // packed (GSet backend, or topology modified since the last step)
+  SpringSysSoA *_soa;
+  // Kernel applying the forces of springs when compiled
+  SpringSysKernel _kernel;
+  // Scheme integrating the motion of masses
+  SpringSysIntegrator _integrator;
+  // Tolerance on the relative residual and maximum number of 
+  // iterations of the linear solver of the implicit integrator
+  float _solverTol;
+  int _solverMaxIter;
+  // Number of iterations and relative residual of the last linear 
+  // solve of the implicit integrator
+  int _solverNbIter;
+  float _solverResidual;
+  // Tolerance on the local error of the adaptive steps of 
+  // SpringSysStepToRest, 0.0 for fixed steps
+  float _adaptTol;
+  // Length of the next adaptive step
+  float _adaptDt;
+  // Number of adaptive steps accepted and rejected during the last 
+  // call to SpringSysAdvance or SpringSysStepToRest
+  int _nbStepAccepted;
+  int _nbStepRejected;
+  // Observables calculated during the last step, and flag telling if 
+  // they are valid (cf SpringSysGetStats)
+  SpringSysStats _stats;
+  bool _statsValid;
+  // Ruptures of springs not drained yet (cf SpringSysDrainRuptures): 
+  // buffer of events, position of the oldest one, number of events 
+  // and size of the buffer, and number of events lost because the 
+  // buffer couldn't be enlarged
+  SpringSysRupture *_rupture;
+  int _ruptureFirst;
+  int _nbRupture;
+  int _ruptureSize;
+  int _nbRuptureLost;
+  // Records of the springs broken since the last compaction of 
+  // _springs, still in _springs until then, their number and the size
+  // of the buffer
+  SpringSysSpring **_tombstone;
+  int _nbTombstone;
+  int _tombstoneSize;
+  // Number of steps between two checks of the equilibrium in 
+  // SpringSysStepToRest
+  int _restCheckPeriod;
+  // Thresholds of momentum and force under which islands fall asleep
+  // (cf SpringSysSetSleep), 0.0 if they never sleep
+  float _sleepMomentum;
+  float _sleepForce;
+  // Number of islands active and asleep after the last step
+  int _nbIslandActive;
+  int _nbIslandSleeping;
+  // Radius of masses, stiffness of their contacts and size of the cells
+  // of the spatial hash searching the contacts (cf 
+  // SpringSysSetCollision), radius equal to 0.0 if masses don't collide
+  float _collideRadius;
+  float _collideK;
+  float _collideCell;
+  // Number of contacts between masses during the last evaluation of 
+  // forces
+  int _nbContact;
+  // Number of threads stepping the SpringSys when compiled
+  int _nbThread;
+  // Pool of threads, NULL until the first step on several threads
+  struct SpringSysThreadPool *_threadPool;
 } SpringSys;
 
+// Ensemble of instances of a SpringSys sharing the same topology, 
+// stepped together. The state of instances is interleaved: the value 
+// of the instance i for the element at position j of an array is at
+// [j * _nbInstance + i], so that consecutive instances are processed
+// by consecutive SIMD lanes.
+typedef struct SpringSysEnsemble {
+  // Number of instances
+  int _nbInstance;
+  // Number of dimension of the instances (in [1, 3])
+  int _nbDim;
+  // Number of masses and springs
+  int _nbMass;
+  int _nbSpring;
+  // Topology shared by instances: ID of masses and springs, position 
+  // of the masses at the extremities of springs (2 per spring), length
+  // at rest, limits of stress out of which springs break (infinite for
+  // unbreakable springs), inverse of inertia and fixed flag of masses
+  int *_massId;
+  int *_springId;
+  int *_springMass;
+  float *_restLength;
+  float *_breakMin;
+  float *_breakMax;
+  float *_invMass;
+  bool *_fixed;
+  // Index of masses and springs by id
+  SpringSysIndex *_massIndex;
+  SpringSysIndex *_springIndex;
+  // Parameters of instances: dissipation coefficient (_nbInstance 
+  // values) and K coefficient of springs (_nbSpring * _nbInstance 
+  // values)
+  float *_dissip;
+  float *_k;
+  // State of instances: position, speed and stress of masses 
+  // (_nbMass * _nbDim * _nbInstance values, the component k of the 
+  // mass j of the instance i is at [(j * _nbDim + k) * _nbInstance + 
+  // i]), length, stress and rupture flag of springs (_nbSpring * 
+  // _nbInstance values)
+  float *_pos;
+  float *_speed;
+  float *_stress;
+  float *_length;
+  float *_springStress;
+  bool *_broken;
+  // Buffers used during the step (_nbInstance values)
+  float *_force;
+  float *_dissipStep;
+  // Number of threads stepping the ensemble
+  int _nbThread;
+  // Pool of threads, NULL until the first step on several threads
+  struct SpringSysThreadPool *_threadPool;
+} SpringSysEnsemble;
+
+// Contents of the frames of a trajectory (cf SpringSysRecorder), to be
+// combined with |
+typedef enum SpringSysRecord {
+  // Position of masses
+  springSysRecordPos = 1,
+  // Speed of masses
+  springSysRecordSpeed = 2,
+  // Stress of springs
+  springSysRecordStress = 4
+} SpringSysRecord;
+
+// Recorder of the trajectory of a SpringSys into a binary stream (cf 
+// SpringSysRecorderCreate). The recorder takes snapshots of the 
+// SpringSys (frames) and queues them, a background thread encodes and
+// writes them. The values are quantized and encoded as the difference
+// with the previous frame, except in key frames (first frame, frames
+// following a modification of the topology or of the quantization, 
+// and periodically), in variable length integers.
+typedef struct SpringSysRecorder {
+  // Recorded SpringSys and destination stream
+  SpringSys *_sys;
+  FILE *_stream;
+  // Contents of the frames (combination of SpringSysRecord)
+  int _content;
+  // Number of calls to SpringSysRecorderRecord per frame
+  int _period;
+  // Largest number of frames between two key frames
+  int _keyPeriod;
+  // Quantization step of positions, speeds and stresses
+  float _precision[3];
+  // Number of calls to SpringSysRecorderRecord so far
+  int _nbCall;
+  // Number of frames queued, and dropped because the queue was full
+  int _nbFrame;
+  int _nbDropped;
+  // Number of frames queued since the last key frame
+  int _nbSinceKey;
+  // Stamp of the topology of the SpringSys at the last frame queued,
+  // 0 if the next frame must be a key frame
+  unsigned long _topology;
+  // Queue of frames and writing thread
+  struct SpringSysRecorderQueue *_queue;
+} SpringSysRecorder;
+
+// Frame of a trajectory read from a stream (cf SpringSysFrameRead)
+typedef struct SpringSysFrame {
+  // Number of dimensions, 0 until the header of the stream is read
+  int _nbDim;
+  // Index of the call to SpringSysRecorderRecord which recorded the 
+  // frame, and time given to it
+  int _step;
+  float _time;
+  // Contents of the frame (combination of SpringSysRecord)
+  int _content;
+  // Flag telling if the frame is a key frame
+  bool _key;
+  // Number of masses and springs, their ids, position and speed of 
+  // masses (_nbMass * _nbDim values) and stress of springs, the arrays
+  // of values which are not in _content are null
+  int _nbMass;
+  int _nbSpring;
+  int *_massId;
+  int *_springId;
+  float *_pos;
+  float *_speed;
+  float *_stress;
+  // Quantized values of the frame, used to decode the next one, and
+  // their number
+  int64_t *_quant;
+  int _nbQuant;
+  // Buffer of the encoded frame and its size in bytes
+  unsigned char *_buffer;
+  size_t _bufferSize;
+} SpringSysFrame;
+
 // ================ Functions declaration ====================
 
 // Create a new SpringSys with number of dimensions 'nbDim' (in [1,3])
 // Default dissipation coefficient _dissip = 0.1
+// Default backend _backend = springSysBackendGSet
+// Default kernel _kernel = the fastest one supported by the CPU
+// Default number of threads _nbThread = 1
+// Default integrator _integrator = springSysIntegratorEuler
+// Default tolerance of the implicit solver _solverTol = 0.0001
+// Default maximum number of iterations of the implicit solver 
+// _solverMaxIter = 200
+// Default tolerance of adaptive steps _adaptTol = 0.0 (fixed steps)
+// Default period of the checks of equilibrium _restCheckPeriod = 1
+// Default thresholds of sleep _sleepMomentum = _sleepForce = 0.0 (no
+// sleeping islands)
 // Return NULL if we couldn't create the Springsys
 SpringSys* SpringSysCreate(int nbDim);
 
@@ -82,7 +619,21 @@ SpringSys* SpringSysCreate(int nbDim);
 // Return NULL if we couldn't clone the Springsys
 SpringSys* SpringSysClone(SpringSys *sys);
 
-// Load the SpringSys 'sys' from the stream 'stream'
+// Copy the dynamic state of the SpringSys 'src' (positions, speeds and
+// stress of masses, lengths and stress of springs, observables of the
+// last step) into the SpringSys 'dst', reusing the memory of 'dst'
+// 'dst' and 'src' must have the same topology: one is a clone of the
+// other, or both are clones of the same SpringSys, and no mass or 
+// spring has been added, removed or broken in any of them since
+// Other properties of 'dst' (mass and fixed flag of masses, K 
+// coefficient and length at rest of springs, ...) are unchanged
+// Return false if arguments are invalid or the topologies are 
+// different, else return true
+bool SpringSysCopyStateInto(SpringSys *dst, SpringSys *src);
+
+// Load the SpringSys 'sys' from the stream 'stream', in text format 
+// (cf SpringSysSave) or binary format (cf SpringSysSaveBinary) 
+// automatically detected
 // If 'sys' is already allocated, it is freed before loading
 // Return 0 in case of success, or:
 // 1: invalid arguments
@@ -90,10 +641,50 @@ SpringSys* SpringSysClone(SpringSys *sys);
 // 3: invalid data
 int SpringSysLoad(SpringSys **sys, FILE *stream);
 
-// Save the SpringSys 'sys' to the stream
+// Load the SpringSys 'sys' from the file at 'path', in text format 
+// (cf SpringSysSave) or binary format (cf SpringSysSaveBinary) 
+// automatically detected
+// The binary format is decoded directly from the file mapped in 
+// memory, without intermediate copy
+// If 'sys' is already allocated, it is freed before loading
+// Return 0 in case of success, or:
+// 1: invalid arguments
+// 2: can't allocate memory
+// 3: invalid data
+// 4: can't open the file
+int SpringSysLoadFile(SpringSys **sys, const char *path);
+
+// Save the SpringSys 'sys' to the stream in text format
 // Return 0 upon success, else
+// 1: invalid argument
+// 2: invalid SpringSys
 int SpringSysSave(SpringSys *sys, FILE *stream);
 
+// Save the SpringSys 'sys' to the stream 'stream' in binary format
+// The binary format is exact, compact and fast to load. It is 
+// little-endian whatever the host and made of:
+// - a header of 48 bytes: the magic number "SPRSYSBN", the version of
+// the format, the size of the header, the number of dimensions, of 
+// masses and of springs, the size of a mass and of a spring record, 4
+// reserved bytes (unsigned integers of 32 bits) and the checksum of 
+// the previous 40 bytes (unsigned integer of 64 bits)
+// - the masses, as records of 48 bytes: id (signed integer of 32 
+// bits), position, speed and stress (3 floats of 32 bits each), mass
+// (float of 32 bits) and fixed flag (unsigned integer of 32 bits)
+// - the springs, as records of 40 bytes: id (signed integer of 32 
+// bits), length, K coefficient, length at rest, stress, compression 
+// and extension limit stresses (floats of 32 bits), ids of the masses
+// (signed integers of 32 bits) and breakable flag (unsigned integer of
+// 32 bits)
+// - a trailer of 16 bytes: the checksums of the masses and of the 
+// springs (unsigned integers of 64 bits)
+// Checksums are Fletcher-64 over the 32 bits words of the data
+// Return 0 upon success, else
+// 1: invalid argument
+// 2: invalid SpringSys
+// 3: can't allocate memory or write to the stream
+int SpringSysSaveBinary(SpringSys *sys, FILE *stream);
+
 // Create a default mass, default properties' values are:
 // _id = 0;
 // _pos[0] = _pos[1] = _pos[2] = 0.0;
@@ -151,7 +742,181 @@ void SpringSysSpringPrint(void *s, FILE *stream);
 // Do nothing if arguments are invalid
 void SpringSysSetDissip(SpringSys *sys, float dissip);
 
+// Set the storage backend of the SpringSys to 'backend'
+// With springSysBackendSoA, masses and springs are packed into 
+// contiguous arrays at the next step and the SpringSys is stepped on 
+// these arrays. The packed arrays hold the current state of the 
+// SpringSys, the records of masses and springs are updated when they 
+// are accessed through the functions of SpringSys. Hence, pointers to 
+// masses and springs must be requested again after each step, and 
+// SpringSysSync must be called before walking the GSets _masses and 
+// _springs directly. Modifications of the topology (adding/removing 
+// masses and springs) release the packed arrays, they are packed 
+// again at the next step.
+// Do nothing if arguments are invalid
+void SpringSysSetBackend(SpringSys *sys, SpringSysBackend backend);
+
+// Compile the SpringSys: freeze its current masses and springs into 
+// packed arrays (as with the SoA backend) whose springs are sorted in
+// rows by their first mass, with precomputed per-spring constants.
+// SpringSysStep and SpringSysStepToRest then run on this snapshot 
+// without resolving ids nor walking the GSets, whatever the backend.
+// Ruptures of springs are applied to the snapshot. Modifying the 
+// topology (adding/removing masses or springs) or the backend releases
+// the snapshot, SpringSysCompile must then be called again.
+// Masses and springs are accessed according to the same rules as with
+// the SoA backend (cf SpringSysSetBackend)
+// Return false if arguments are invalid or memory allocation failed,
+// else return true
+bool SpringSysCompile(SpringSys *sys);
+
+// Return true if the SpringSys is compiled (cf SpringSysCompile), 
+// else false
+bool SpringSysIsCompiled(SpringSys *sys);
+
+// Set the kernel applying the forces of springs when the SpringSys is
+// compiled to 'kernel'. Vectorized kernels give the same results as 
+// the scalar one within float tolerance.
+// Return false if arguments are invalid or the kernel is not supported
+// by the CPU, else return true
+bool SpringSysSetKernel(SpringSys *sys, SpringSysKernel kernel);
+
+// Return true if the kernel 'kernel' is supported by the CPU, else 
+// false
+bool SpringSysKernelIsSupported(SpringSysKernel kernel);
+
+// Set the number of threads used to step the SpringSys when it is 
+// compiled to 'nbThread'. With several threads, the Euler steps use 
+// the islands of the SpringSys (cf SpringSysSetSleep) if they can 
+// share the work evenly enough between the threads (the busiest one 
+// doing less than SPRINGSYS_ISLAND_MAXLOAD times the average): each 
+// thread steps its own islands, without synchronisation, islands 
+// connected through a fixed mass being stepped by the same thread. 
+// Islands are split as springs break, and are tried again when 
+// 1/SPRINGSYS_ISLAND_RETRY of the springs broke since the last try. 
+// Else, the springs are partitioned into color classes (no two 
+// springs of a class share a mass) whose forces are applied in 
+// parallel without atomics, one class after the other, then the 
+// masses are moved in parallel.
+// Do nothing if arguments are invalid
+void SpringSysSetNbThread(SpringSys *sys, int nbThread);
+
+// Set the scheme integrating the motion of masses of the SpringSys to
+// 'integrator'. springSysIntegratorVerlet (second order) and 
+// springSysIntegratorRK4 (fourth order) are more accurate than 
+// springSysIntegratorEuler for a given step, RK4 also stays stable 
+// with steps about 1.5 times larger. They run on the compiled 
+// snapshot, SpringSysStep compiles the SpringSys if necessary (cf 
+// SpringSysCompile for the access to masses and springs). The length
+// and stress of springs and masses after a step are those of the last
+// evaluation of the forces in the step.
+// springSysIntegratorImplicit solves at each step the linear system
+// (M + dt^2.H).dv = dt.(f - dt.H.v) for the change of speed dv of 
+// unfixed masses (fixed masses are held by dv = 0), where M is the 
+// inertia of masses, f the forces of springs and H their stiffness 
+// (compressed springs only contribute along their axis, to keep the 
+// system positive definite), with a conjugate gradient preconditioned
+// by the diagonal of the system. It stays stable with steps orders of 
+// magnitude larger than the explicit integrators on stiff springs.
+// Do nothing if arguments are invalid
+void SpringSysSetIntegrator(SpringSys *sys, 
+  SpringSysIntegrator integrator);
+
+// Set the tolerance on the relative residual of the linear solver of 
+// the implicit integrator to 'tol' and its maximum number of 
+// iterations per step to 'maxIter'. The number of iterations and the 
+// relative residual of the last solve are available in _solverNbIter
+// and _solverResidual.
+// Do nothing if arguments are invalid
+void SpringSysSetImplicitSolver(SpringSys *sys, float tol, 
+  int maxIter);
+
+// Set the tolerance on the local error of the steps of 
+// SpringSysStepToRest to 'tol', 0.0 for fixed steps. If 'tol' is 
+// strictly positive the SpringSys is compiled and SpringSysStepToRest 
+// adapts the length of its steps as SpringSysAdvance does, starting 
+// with the given 'dt'. 
+// Do nothing if arguments are invalid
+void SpringSysSetAdaptiveStep(SpringSys *sys, float tol);
+
+// Set the number of steps between two checks of the equilibrium in 
+// SpringSysStepToRest to 'period'
+// Do nothing if arguments are invalid
+void SpringSysSetRestCheckPeriod(SpringSys *sys, int period);
+
+// Set the thresholds under which the islands of the SpringSys fall 
+// asleep to 'momentum' and 'force', 0.0 to keep them awake. An island
+// is a set of unfixed masses connected by springs through unfixed 
+// masses (fixed masses don't link islands). An island falls asleep 
+// once its momentum (sum of norm of the speed of its masses) is below
+// 'momentum' and the force on each of its masses below 'force' during
+// SPRINGSYS_SLEEP_NBSTEP consecutive steps: the speed of its masses is
+// set to 0.0 and its masses and springs are not stepped anymore, until
+// it wakes up. An island wakes up when one of its masses or springs is
+// modified (including the speed of a mass, which is how external 
+// forces are applied), when a fixed mass connected to it is moved or 
+// unfixed, or when the integrator isn't springSysIntegratorEuler. 
+// Springs can only break in islands awake, and islands are split when
+// springs break. Sleeping islands run on the compiled snapshot (on its
+// threads, cf SpringSysSetNbThread, whatever the balance of the 
+// islands), SpringSysStep compiles the SpringSys if necessary (cf 
+// SpringSysCompile for the access to masses and springs), and the 
+// masses and springs of the snapshot are sorted by island. The 
+// numbers of islands active and asleep after a step are available in
+// _nbIslandActive and _nbIslandSleeping (islands are not used by 
+// adaptive steps).
+// Do nothing if arguments are invalid
+void SpringSysSetSleep(SpringSys *sys, float momentum, float force);
+
+// Set the radius of the masses of the SpringSys to 'radius', the 
+// stiffness of their contacts to 'k', and the size of the cells of the
+// spatial hash searching the contacts to 'cell' (0.0 for twice 
+// 'radius'), 'radius' equal to 0.0 disables the collisions. Two masses
+// not connected by a spring are in contact when they are closer than 
+// twice 'radius', then each is pushed away from the other by a force 
+// equal to 'k' times the overlap, added to the forces of springs 
+// before the masses are moved. Collisions run on the compiled snapshot
+// (on its threads, cf SpringSysSetNbThread), SpringSysStep compiles 
+// the SpringSys if necessary (cf SpringSysCompile for the access to 
+// masses and springs), and islands are not used while masses collide
+// (cf SpringSysSetSleep). The number of contacts during the last 
+// evaluation of forces is available in _nbContact.
+// Do nothing if arguments are invalid
+void SpringSysSetCollision(SpringSys *sys, float radius, float k, 
+  float cell);
+
+// Update the records of masses and springs in the GSets _masses and 
+// _springs from the packed arrays of the SpringSys. The records can
+// then be read and modified directly until the next step.
+// Do nothing if arguments are invalid or the SpringSys is not packed
+void SpringSysSync(SpringSys *sys);
+
+// Get the packed arrays of masses and springs of the SpringSys for 
+// bulk reading. The arrays are packed if necessary. The returned 
+// arrays are valid until the next modification of the topology or 
+// change of backend, and their content until the next modification
+// of a mass or spring.
+// Return NULL if arguments are invalid, the backend is not 
+// springSysBackendSoA or memory allocation failed
+const SpringSysSoA* SpringSysGetSoA(SpringSys *sys);
+
+// Copy into 'ruptures' the 'nb' oldest ruptures of springs of the 
+// SpringSys not drained yet (or all of them if there are less) and 
+// remove them from its events. Springs breaking during a step are 
+// removed from _springs in one pass at the end of the force pass, and
+// their ruptures are recorded in the order of the steps, with the id
+// of the spring and its stress when it broke, whatever the backend, 
+// integrator and number of threads. Events accumulate until they are
+// drained, _nbRupture is their number and _nbRuptureLost the number 
+// of events lost because memory couldn't be allocated.
+// Return the number of ruptures copied, 0 if arguments are invalid
+int SpringSysDrainRuptures(SpringSys *sys, SpringSysRupture *ruptures,
+  int nb);
+
 // Get the mass identified by 'id'
+// The search is done in constant time through the index of masses,
+// hence the id of a mass must not be modified once it has been added
+// to the SpringSys
 // Return NULL if arguments are invalid or if there is no mass 
 // with this id
 SpringSysMass* SpringSysGetMass(SpringSys *sys, int id);
@@ -169,8 +934,30 @@ int SpringSysGetNbMass(SpringSys *sys);
 // Return -1 if the argument are invalid
 int SpringSysGetNbSpring(SpringSys *sys);
 
+// Get the number of springs connected to the mass identified by 'id'
+// Return -1 if arguments are invalid or if there is no mass with this 
+// id
+int SpringSysGetNbSpringOfMass(SpringSys *sys, int id);
+
+// Get the id of the 'iSpring'-th spring connected to the mass 
+// identified by 'id', 'iSpring' in [0, SpringSysGetNbSpringOfMass[
+// The order of the springs changes when springs connected to the mass
+// are added or removed
+// Return -1 if arguments are invalid or if there is no mass with this 
+// id
+int SpringSysGetSpringOfMass(SpringSys *sys, int id, int iSpring);
+
+// Get the id of the mass at the other extremity of the 'iSpring'-th 
+// spring connected to the mass identified by 'id' (cf 
+// SpringSysGetSpringOfMass)
+// Return -1 if arguments are invalid or if there is no mass with this 
+// id
+int SpringSysGetNeighborOfMass(SpringSys *sys, int id, int iSpring);
+
 // Add a copy of the mass 'm' to the SpringSys
 // If _data must be cloned it's up to the calling function
+// If several masses share the same id, only the first one added 
+// is returned by SpringSysGetMass
 // Return false if the arguments are invalid or memory allocation failed
 // else return true
 bool SpringSysAddMass(SpringSys *sys, SpringSysMass *m);
@@ -180,6 +967,49 @@ bool SpringSysAddMass(SpringSys *sys, SpringSysMass *m);
 // else return true
 bool SpringSysAddSpring(SpringSys *sys, SpringSysSpring *s);
 
+// Add a copy of the 'nb' masses of the array 'masses' to the SpringSys,
+// in the order of the array, until the end of the array or the first
+// mass which couldn't be added (invalid properties or memory 
+// allocation failure)
+// If _data must be cloned it's up to the calling function
+// Return the number of masses added, or -1 if arguments are invalid
+int SpringSysAddMasses(SpringSys *sys, const SpringSysMass *masses, 
+  int nb);
+
+// Add a copy of the 'nb' springs of the array 'springs' to the 
+// SpringSys, in the order of the array, until the end of the array or
+// the first spring which couldn't be added (invalid properties, 
+// missing mass or memory allocation failure)
+// Return the number of springs added, or -1 if arguments are invalid
+int SpringSysAddSprings(SpringSys *sys, const SpringSysSpring *springs,
+  int nb);
+
+// Add to the SpringSys a lattice of 'size[0]' x ... x 
+// 'size[nbDim - 1]' masses, linked by springs according to 'lattice'
+// (cf SpringSysLattice)
+// The masses are copies of 'mass', positioned from mass->_pos by steps
+// of 'spacing' along each axis, with ids consecutive from mass->_id 
+// (the index along the first axis varying fastest)
+// The springs are copies of 'spring' whose length and length at rest
+// are the distance between their masses, with ids consecutive from 
+// spring->_id
+// If the lattice couldn't be added entirely, the masses and springs 
+// added before the failure are left in the SpringSys
+// Return false if arguments are invalid or memory allocation failed, 
+// else return true
+bool SpringSysAddLattice(SpringSys *sys, SpringSysLattice lattice, 
+  const int *size, float spacing, const SpringSysMass *mass, 
+  const SpringSysSpring *spring);
+
+// Preallocate the memory for the SpringSys to hold 'nbMass' masses and
+// 'nbSpring' springs without further allocation of their records
+// The records of masses and springs are allocated by slabs, reused 
+// when masses and springs are removed or break, and released all at 
+// once by SpringSysFree
+// Return false if arguments are invalid or memory allocation failed, 
+// else return true
+bool SpringSysReserve(SpringSys *sys, int nbMass, int nbSpring);
+
 // Remove the mass identified by 'id'
 // Springs connected to this mass are removed as well
 // Do nothing if arguments are invalids
@@ -189,6 +1019,21 @@ void SpringSysRemoveMass(SpringSys *sys, int id);
 // Do nothing if argument are invalids
 void SpringSysRemoveSpring(SpringSys *sys, int id);
 
+// Remove the 'nb' masses identified by the ids in 'ids' and the 
+// springs connected to them
+// The sets of masses and springs are updated once for all the masses,
+// hence removing many masses is faster with this function than with 
+// SpringSysRemoveMass
+// Do nothing if arguments are invalids
+void SpringSysRemoveMasses(SpringSys *sys, const int *ids, int nb);
+
+// Remove the 'nb' springs identified by the ids in 'ids'
+// The set of springs is updated once for all the springs, hence 
+// removing many springs is faster with this function than with 
+// SpringSysRemoveSpring
+// Do nothing if arguments are invalids
+void SpringSysRemoveSprings(SpringSys *sys, const int *ids, int nb);
+
 // Step in time by 'dt' the SpringSys
 // 'dt' must be carefully choosen, if too big inaccuracy of the 
 // simulation leads to divergence and then to rupture of springs,
@@ -198,14 +1043,56 @@ void SpringSysStep(SpringSys *sys, float dt);
 
 // Step in time by 'dt' the SpringSys until it is in equilibrium 
 // or 'tMax' has been reached
+// The equilibrium is checked every _restCheckPeriod steps (cf 
+// SpringSysSetRestCheckPeriod) from the observables calculated by the 
+// steps: it is reached when the momentum is null and the stress hasn't
+// changed since the previous check
 // 'dt' must be carefully choosen, if too big inaccuracy of the 
 // simulation leads to divergence and then to rupture of springs,
-// especially if springs have a high mk coefficient 
+// especially if springs have a high mk coefficient, unless the 
+// SpringSys uses adaptive steps (cf SpringSysSetAdaptiveStep) in which
+// case 'dt' is only the length of the first step
 // Return a value > tMax if the arguments are invalid or the equilibrium
 // couldn't be reached, else return the time it took to 
 // reach equilibrium 
 float SpringSysStepToRest(SpringSys *sys, float dt, float tMax);
 
+// Step in time the SpringSys by 'tTarget' with adaptive steps: each 
+// step is compared with two steps of half its length, the step is 
+// rejected and retried shorter if their difference (position of 
+// unfixed masses, and their speed times the step) is over 'tol', else
+// accepted, and the length of the next step is predicted from the 
+// difference and the order of the integrator (cf 
+// SpringSysSetIntegrator). The result of an accepted step is the one 
+// of the two half steps, ruptures are applied once it's accepted. The
+// length of steps is kept between calls in _adaptDt (the first call 
+// starts with 'tTarget'), the numbers of accepted and rejected steps 
+// during the call are available in _nbStepAccepted and 
+// _nbStepRejected. The SpringSys is compiled if necessary (cf 
+// SpringSysCompile for the access to masses and springs).
+// Return false if arguments are invalid or the SpringSys couldn't be
+// compiled, else return true
+bool SpringSysAdvance(SpringSys *sys, float tTarget, float tol);
+
+// Move the masses of the SpringSys directly to the configuration of 
+// minimum energy of its springs (sum of 0.5.k.(length - restLength)^2)
+// with the FIRE algorithm (damped dynamics following the force, with 
+// adaptive step), until the norm of the force on each unfixed mass is
+// below 'tol' or 'maxIter' iterations have been done. Fixed masses 
+// don't move. Springs break as during steps if their stress goes over
+// their limits. Masses are at rest at the end. The number of 
+// iterations (one evaluation of forces per iteration) and the highest
+// norm of the force on unfixed masses are stored in 'nbIter' and 
+// 'residual' if they are not null. Forces are computed in float, 
+// 'tol' must stay above their precision (about 1e-6 times the stress
+// of springs). The SpringSys is compiled if 
+// necessary (cf SpringSysCompile for the access to masses and 
+// springs).
+// Return false if arguments are invalid, the SpringSys couldn't be 
+// compiled or the equilibrium hasn't been reached, else return true
+bool SpringSysSolveEquilibrium(SpringSys *sys, float tol, int maxIter,
+  int *nbIter, float *residual);
+
 // Get the momentum (sum of norm(v) of masses) of the SpringSys
 // Return 0.0 if the arguments are invalid
 float SpringSysGetMomentum(SpringSys *sys);
@@ -214,12 +1101,219 @@ float SpringSysGetMomentum(SpringSys *sys);
 // Return 0.0 if the arguments are invalid
 float SpringSysGetStress(SpringSys *sys);
 
-// Get the nearest mass to 'pos' in the SpringSys 'sys'
+// Get the observables of the SpringSys calculated during its last step
+// (cf SpringSysStats): momentum and kinetic energy after the step, 
+// stress of springs and highest force on masses as applied during the
+// step (the same values as SpringSysGetMomentum and SpringSysGetStress
+// after the step, without another pass on masses and springs). They 
+// are calculated by the steps with springSysIntegratorEuler, else, or
+// before the first step, they are calculated from the current state at
+// each call. They are not updated by modifications of masses and 
+// springs after the step.
+// Return NULL if arguments are invalid
+const SpringSysStats* SpringSysGetStats(SpringSys *sys);
+
+// Get the nearest mass to 'pos' in the SpringSys 'sys'. If the 
+// SpringSys is packed (cf SpringSysSetBackend and SpringSysCompile), 
+// the masses are searched in a uniform grid, built at the first search
+// after masses have moved, else all the masses are checked.
 // Return NULL if arguments are invalids
 SpringSysMass* SpringSysGetMassByPos(SpringSys *sys, float *pos);
 
-// Get the nearest spring to 'pos' in the SpringSys 'sys'
+// Get the nearest mass to each of the 'nb' positions 'pos' ('nb' times
+// _nbDim values) in the SpringSys 'sys' and store them in 'masses' (a
+// mass is NULL if there is no mass), as SpringSysGetMassByPos. If the 
+// SpringSys is packed, large batches are shared between its threads 
+// (cf SpringSysSetNbThread).
+// Return false if arguments are invalid, else true
+bool SpringSysGetMassesByPos(SpringSys *sys, const float *pos, int nb,
+  SpringSysMass **masses);
+
+// Get the nearest spring to 'pos' in the SpringSys 'sys', the 
+// distance to a spring being the distance to the segment between its
+// masses. If the SpringSys is packed (cf SpringSysSetBackend and 
+// SpringSysCompile), the springs are searched in a bounding volume 
+// hierarchy, built at the first search and refit at the first search
+// after masses have moved, else all the springs are checked.
 // Return NULL if arguments are invalids
 SpringSysSpring* SpringSysGetSpringByPos(SpringSys *sys, float *pos);
 
+// Get the ids of the masses at a distance less than or equal to 
+// 'radius' from 'center' in the SpringSys 'sys'. Their number is 
+// stored in 'nb'. If the SpringSys is packed (cf SpringSysSetBackend 
+// and SpringSysCompile), only the masses in the cells of the grid of 
+// masses overlapping the sphere are checked (cf 
+// SpringSysGetMassByPos), else all the masses are checked.
+// Return the ids, in no particular order, in an array to be freed by 
+// the user, or NULL if arguments are invalid or memory allocation 
+// failed
+int* SpringSysGetMassesInSphere(SpringSys *sys, const float *center,
+  float radius, int *nb);
+
+// Get the ids of the masses inside the box from 'min' to 'max' 
+// (bounds included) in the SpringSys 'sys', as 
+// SpringSysGetMassesInSphere
+int* SpringSysGetMassesInBox(SpringSys *sys, const float *min, 
+  const float *max, int *nb);
+
+// Get the ids of the springs whose segment between their masses is at
+// a distance less than or equal to 'radius' from 'center' in the 
+// SpringSys 'sys'. Their number is stored in 'nb'. If the SpringSys is
+// packed (cf SpringSysSetBackend and SpringSysCompile), only the 
+// springs in the nodes of the hierarchy of springs overlapping the 
+// sphere are checked (cf SpringSysGetSpringByPos), else all the 
+// springs are checked.
+// Return the ids, in no particular order, in an array to be freed by 
+// the user, or NULL if arguments are invalid or memory allocation 
+// failed
+int* SpringSysGetSpringsInSphere(SpringSys *sys, const float *center,
+  float radius, int *nb);
+
+// Get the ids of the springs whose segment between their masses 
+// crosses the box from 'min' to 'max' (bounds included) in the 
+// SpringSys 'sys', as SpringSysGetSpringsInSphere
+int* SpringSysGetSpringsInBox(SpringSys *sys, const float *min, 
+  const float *max, int *nb);
+
+// Create an ensemble of 'nbInstance' instances of the SpringSys 'sys',
+// all initialized with the current state, dissipation and K 
+// coefficients of 'sys'. Later modifications of 'sys' don't affect 
+// the ensemble.
+// Return NULL if arguments are invalid, memory allocation failed or 
+// the springs of 'sys' refer to unknown masses
+SpringSysEnsemble* SpringSysEnsembleCreate(SpringSys *sys, 
+  int nbInstance);
+
+// Free the memory used by the ensemble 'ens'
+// Do nothing if arguments are invalid
+void SpringSysEnsembleFree(SpringSysEnsemble **ens);
+
+// Get the number of instances of the ensemble 'ens'
+// Return 0 if arguments are invalid
+int SpringSysEnsembleGetNbInstance(SpringSysEnsemble *ens);
+
+// Set the number of threads used to step the ensemble 'ens' to 
+// 'nbThread', each thread steps a subset of the instances
+// Do nothing if arguments are invalid
+void SpringSysEnsembleSetNbThread(SpringSysEnsemble *ens, 
+  int nbThread);
+
+// Set the dissipation coefficient of the instance 'iInst' of the 
+// ensemble 'ens' to 'dissip' in [0.0,1.0]
+// Do nothing if arguments are invalid
+void SpringSysEnsembleSetDissip(SpringSysEnsemble *ens, int iInst, 
+  float dissip);
+
+// Set the K coefficient of the spring identified by 'id' in the 
+// instance 'iInst' of the ensemble 'ens' to 'k'
+// Return false if arguments are invalid or there is no spring with 
+// this id, else return true
+bool SpringSysEnsembleSetK(SpringSysEnsemble *ens, int iInst, int id,
+  float k);
+
+// Set the position of the mass identified by 'id' in the instance 
+// 'iInst' of the ensemble 'ens' to 'pos' (_nbDim values)
+// Return false if arguments are invalid or there is no mass with 
+// this id, else return true
+bool SpringSysEnsembleSetMassPos(SpringSysEnsemble *ens, int iInst, 
+  int id, const float *pos);
+
+// Set the speed of the mass identified by 'id' in the instance 
+// 'iInst' of the ensemble 'ens' to 'speed' (_nbDim values)
+// Return false if arguments are invalid or there is no mass with 
+// this id, else return true
+bool SpringSysEnsembleSetMassSpeed(SpringSysEnsemble *ens, int iInst, 
+  int id, const float *speed);
+
+// Get the position of the mass identified by 'id' in the instance 
+// 'iInst' of the ensemble 'ens' into 'pos' (_nbDim values)
+// Return false if arguments are invalid or there is no mass with 
+// this id, else return true
+bool SpringSysEnsembleGetMassPos(SpringSysEnsemble *ens, int iInst, 
+  int id, float *pos);
+
+// Get the speed of the mass identified by 'id' in the instance 
+// 'iInst' of the ensemble 'ens' into 'speed' (_nbDim values)
+// Return false if arguments are invalid or there is no mass with 
+// this id, else return true
+bool SpringSysEnsembleGetMassSpeed(SpringSysEnsemble *ens, int iInst, 
+  int id, float *speed);
+
+// Step in time by 'dt' all the instances of the ensemble 'ens'
+// A spring breaking in an instance is flagged broken in this instance
+// only and doesn't apply force anymore
+// Do nothing if arguments are invalid
+void SpringSysEnsembleStep(SpringSysEnsemble *ens, float dt);
+
+// Get the momentum (sum of norm(v) of masses) of the instance 'iInst' 
+// of the ensemble 'ens'
+// Return 0.0 if the arguments are invalid
+float SpringSysEnsembleGetMomentum(SpringSysEnsemble *ens, int iInst);
+
+// Get the stress (sum of abs(stress) of springs not broken) of the 
+// instance 'iInst' of the ensemble 'ens'
+// Return 0.0 if the arguments are invalid
+float SpringSysEnsembleGetStress(SpringSysEnsemble *ens, int iInst);
+
+// Get the number of broken springs in the instance 'iInst' of the 
+// ensemble 'ens'
+// Return 0 if the arguments are invalid
+int SpringSysEnsembleGetNbBroken(SpringSysEnsemble *ens, int iInst);
+
+// Create a recorder of the trajectory of the SpringSys 'sys' into the
+// stream 'stream', open in binary mode and left open by 
+// SpringSysRecorderFree. 'content' is a combination of SpringSysRecord
+// and a frame is recorded every 'period' calls to 
+// SpringSysRecorderRecord. Up to 'nbQueue' frames can wait to be 
+// written, frames recorded while the queue is full are dropped.
+// Default quantization steps are 1e-4 for positions and speeds, and 
+// 1e-3 for stresses. A key frame is recorded at least every 100 
+// frames.
+// 'sys' must not be freed before the recorder
+// Return NULL if arguments are invalid or memory allocation failed
+SpringSysRecorder* SpringSysRecorderCreate(SpringSys *sys, 
+  FILE *stream, int content, int period, int nbQueue);
+
+// Write the frames waiting in the queue of the recorder 'rec', stop its
+// thread and free its memory
+void SpringSysRecorderFree(SpringSysRecorder **rec);
+
+// Set the quantization step of the values of the kind 'what' (one of
+// SpringSysRecord) of the recorder 'rec' to 'precision'
+// Return false if arguments are invalid, else return true
+bool SpringSysRecorderSetPrecision(SpringSysRecorder *rec, 
+  SpringSysRecord what, float precision);
+
+// Set the largest number of frames between two key frames of the 
+// recorder 'rec' to 'nb'
+void SpringSysRecorderSetKeyPeriod(SpringSysRecorder *rec, int nb);
+
+// Count one call for the recorder 'rec', and if it is time to record a
+// frame queue a snapshot of its SpringSys, labeled with the time 't'.
+// Meant to be called after each step, it never waits for the stream.
+// Return false if the frame has been dropped (queue full or memory
+// allocation failed), else return true
+bool SpringSysRecorderRecord(SpringSysRecorder *rec, float t);
+
+// Wait until the frames queued in the recorder 'rec' are written and 
+// flush its stream
+// Return false if an error occured while writing frames, else true
+bool SpringSysRecorderFlush(SpringSysRecorder *rec);
+
+// Create a frame to read a trajectory recorded with a SpringSysRecorder
+// Return NULL if memory allocation failed
+SpringSysFrame* SpringSysFrameCreate(void);
+
+// Free the memory used by the frame 'frame'
+void SpringSysFrameFree(SpringSysFrame **frame);
+
+// Read the next frame of the trajectory in the stream 'stream' into 
+// 'frame', which must have read the previous frames of the stream
+// Return 0 in case of success, or:
+// 1: invalid arguments
+// 2: can't allocate memory
+// 3: invalid data
+// 4: end of the stream
+int SpringSysFrameRead(SpringSysFrame *frame, FILE *stream);
+
 #endif